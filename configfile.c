@@ -19,6 +19,7 @@
  *  
  */
 
+#include <limits.h>
 #include <sys/stat.h>			/* for stat() */
 
 #include "repmgr.h"
@@ -291,6 +292,7 @@ _parse_config(t_configuration_options *options, ItemList *error_list, ItemList *
 	memset(options->log_facility, 0, sizeof(options->log_facility));
 	memset(options->log_file, 0, sizeof(options->log_file));
 	options->log_status_interval = DEFAULT_LOG_STATUS_INTERVAL;
+	options->log_format = LOG_FORMAT_TEXT;
 
 	/*-----------------------
 	 * standby clone settings
@@ -341,22 +343,28 @@ _parse_config(t_configuration_options *options, ItemList *error_list, ItemList *
 	memset(options->promote_command, 0, sizeof(options->promote_command));
 	memset(options->follow_command, 0, sizeof(options->follow_command));
 	options->monitor_interval_secs = DEFAULT_MONITORING_INTERVAL;
+	options->monitor_interval_ms = -1;
 	/* default to 6 reconnection attempts at intervals of 10 seconds */
 	options->reconnect_attempts = DEFAULT_RECONNECTION_ATTEMPTS;
 	options->reconnect_interval = DEFAULT_RECONNECTION_INTERVAL;
 	options->monitoring_history = false;	/* new in 4.0, replaces
 											 * --monitoring-history */
+	options->monitoring_history_flush_interval = DEFAULT_MONITORING_HISTORY_FLUSH_INTERVAL;
 	options->degraded_monitoring_timeout = -1;
 	options->async_query_timeout = DEFAULT_ASYNC_QUERY_TIMEOUT;
 	options->primary_notification_timeout = DEFAULT_PRIMARY_NOTIFICATION_TIMEOUT;
 	options->repmgrd_standby_startup_timeout = -1; /* defaults to "standby_reconnect_timeout" if not set */
 	memset(options->repmgrd_pid_file, 0, sizeof(options->repmgrd_pid_file));
+	memset(options->repmgrd_event_spool_file, 0, sizeof(options->repmgrd_event_spool_file));
 	options->standby_disconnect_on_failover = false;
 	options->sibling_nodes_disconnect_timeout = DEFAULT_SIBLING_NODES_DISCONNECT_TIMEOUT;
 	options->connection_check_type = CHECK_PING;
 	options->primary_visibility_consensus = false;
 	memset(options->failover_validation_command, 0, sizeof(options->failover_validation_command));
 	options->election_rerun_interval = DEFAULT_ELECTION_RERUN_INTERVAL;
+	options->election_poll_timeout = DEFAULT_ELECTION_POLL_TIMEOUT;
+	options->peer_connection_check_interval = DEFAULT_PEER_CONNECTION_CHECK_INTERVAL;
+	options->node_list_refresh_interval = DEFAULT_NODE_LIST_REFRESH_INTERVAL;
 
 	/*-------------
 	 * witness settings
@@ -396,6 +404,8 @@ _parse_config(t_configuration_options *options, ItemList *error_list, ItemList *
 	memset(options->event_notification_command, 0, sizeof(options->event_notification_command));
 	options->event_notifications.head = NULL;
 	options->event_notifications.tail = NULL;
+	options->event_notification_timeout = DEFAULT_EVENT_NOTIFICATION_TIMEOUT;
+	options->event_notification_retries = DEFAULT_EVENT_NOTIFICATION_RETRIES;
 
 	/*----------------
 	 * barman settings
@@ -412,6 +422,7 @@ _parse_config(t_configuration_options *options, ItemList *error_list, ItemList *
 	memset(options->rsync_options, 0, sizeof(options->rsync_options));
 	memset(options->ssh_options, 0, sizeof(options->ssh_options));
 	strncpy(options->ssh_options, "-q -o ConnectTimeout=10", sizeof(options->ssh_options));
+	memset(options->ssh_control_path, 0, sizeof(options->ssh_control_path));
 
 	/*---------------------------
 	 * undocumented test settings
@@ -432,6 +443,7 @@ _parse_config(t_configuration_options *options, ItemList *error_list, ItemList *
      */
     options->device_check_timeout = DEVICE_CHECK_TIMEOUT;
     options->device_check_times = DEVICE_CHECK_TIMES;
+    options->device_check_latency_threshold = DEVICE_CHECK_LATENCY_THRESHOLD;
 
     /*-----------------
      * highgo: Standby wait timeout
@@ -548,6 +560,22 @@ _parse_config(t_configuration_options *options, ItemList *error_list, ItemList *
 			strncpy(options->log_facility, value, MAXLEN);
 		else if (strcmp(name, "log_status_interval") == 0)
 			options->log_status_interval = repmgr_atoi(value, name, error_list, 0);
+		else if (strcmp(name, "log_format") == 0)
+		{
+			if (strcasecmp(value, "text") == 0)
+			{
+				options->log_format = LOG_FORMAT_TEXT;
+			}
+			else if (strcasecmp(value, "json") == 0)
+			{
+				options->log_format = LOG_FORMAT_JSON;
+			}
+			else
+			{
+				item_list_append(error_list,
+								 _("value for \"log_format\" must be \"text\" or \"json\"\n"));
+			}
+		}
 
 		/* standby clone settings */
 		else if (strcmp(name, "use_replication_slots") == 0)
@@ -636,8 +664,12 @@ _parse_config(t_configuration_options *options, ItemList *error_list, ItemList *
 			options->reconnect_interval = repmgr_atoi(value, name, error_list, 0);
 		else if (strcmp(name, "monitor_interval_secs") == 0)
 			options->monitor_interval_secs = repmgr_atoi(value, name, error_list, 1);
+		else if (strcmp(name, "monitor_interval") == 0)
+			options->monitor_interval_ms = parse_interval_ms(value, name, error_list, MIN_MONITORING_INTERVAL_MS);
 		else if (strcmp(name, "monitoring_history") == 0)
 			options->monitoring_history = parse_bool(value, name, error_list);
+		else if (strcmp(name, "monitoring_history_flush_interval") == 0)
+			options->monitoring_history_flush_interval = repmgr_atoi(value, name, error_list, 0);
 		else if (strcmp(name, "degraded_monitoring_timeout") == 0)
 			options->degraded_monitoring_timeout = repmgr_atoi(value, name, error_list, -1);
 		else if (strcmp(name, "async_query_timeout") == 0)
@@ -648,6 +680,8 @@ _parse_config(t_configuration_options *options, ItemList *error_list, ItemList *
 			options->repmgrd_standby_startup_timeout = repmgr_atoi(value, name, error_list, 0);
 		else if (strcmp(name, "repmgrd_pid_file") == 0)
 			strncpy(options->repmgrd_pid_file, value, MAXPGPATH);
+		else if (strcmp(name, "repmgrd_event_spool_file") == 0)
+			strncpy(options->repmgrd_event_spool_file, value, MAXPGPATH);
 		else if (strcmp(name, "standby_disconnect_on_failover") == 0)
 			options->standby_disconnect_on_failover = parse_bool(value, name, error_list);
 		else if (strcmp(name, "sibling_nodes_disconnect_timeout") == 0)
@@ -678,6 +712,12 @@ _parse_config(t_configuration_options *options, ItemList *error_list, ItemList *
 			strncpy(options->failover_validation_command, value, sizeof(options->failover_validation_command));
 		else if (strcmp(name, "election_rerun_interval") == 0)
 			options->election_rerun_interval = repmgr_atoi(value, name, error_list, 0);
+		else if (strcmp(name, "election_poll_timeout") == 0)
+			options->election_poll_timeout = repmgr_atoi(value, name, error_list, 1);
+		else if (strcmp(name, "peer_connection_check_interval") == 0)
+			options->peer_connection_check_interval = repmgr_atoi(value, name, error_list, 0);
+		else if (strcmp(name, "node_list_refresh_interval") == 0)
+			options->node_list_refresh_interval = repmgr_atoi(value, name, error_list, 0);
 
 		/* witness settings */
 		else if (strcmp(name, "witness_sync_interval") == 0)
@@ -719,6 +759,10 @@ _parse_config(t_configuration_options *options, ItemList *error_list, ItemList *
 			strncpy(options->event_notifications_orig, value, sizeof(options->event_notifications_orig));
 			parse_event_notifications_list(options, value);
 		}
+		else if (strcmp(name, "event_notification_timeout") == 0)
+			options->event_notification_timeout = repmgr_atoi(value, name, error_list, 1);
+		else if (strcmp(name, "event_notification_retries") == 0)
+			options->event_notification_retries = repmgr_atoi(value, name, error_list, 0);
 
 		/* barman settings */
 		else if (strcmp(name, "barman_host") == 0)
@@ -733,6 +777,8 @@ _parse_config(t_configuration_options *options, ItemList *error_list, ItemList *
 			strncpy(options->rsync_options, value, sizeof(options->rsync_options));
 		else if (strcmp(name, "ssh_options") == 0)
 			strncpy(options->ssh_options, value, sizeof(options->ssh_options));
+		else if (strcmp(name, "ssh_control_path") == 0)
+			strncpy(options->ssh_control_path, value, sizeof(options->ssh_control_path));
 
 		/* undocumented settings for testing */
 		else if (strcmp(name, "promote_delay") == 0)
@@ -749,6 +795,8 @@ _parse_config(t_configuration_options *options, ItemList *error_list, ItemList *
             options->device_check_timeout = repmgr_atoi(value, name, error_list, 1);
         else if (strcmp(name, "device_check_times") == 0)
             options->device_check_times = repmgr_atoi(value, name, error_list, 0);
+        else if (strcmp(name, "device_check_latency_threshold") == 0)
+            options->device_check_latency_threshold = repmgr_atoi(value, name, error_list, 0);
 
         /* highgo: standby wait timeout */
         else if (strcmp(name, "standby_wait_timeout") == 0)
@@ -896,6 +944,20 @@ _parse_config(t_configuration_options *options, ItemList *error_list, ItemList *
 		options->repmgrd_standby_startup_timeout = options->standby_reconnect_timeout;
 	}
 
+	/*
+	 * "monitor_interval" (which accepts a unit, e.g. "250ms") takes precedence
+	 * over "monitor_interval_secs"; the latter is kept in step, rounded up to
+	 * the next whole second, for settings derived from the monitoring interval
+	 */
+	if (options->monitor_interval_ms == -1)
+	{
+		options->monitor_interval_ms = options->monitor_interval_secs * 1000;
+	}
+	else
+	{
+		options->monitor_interval_secs = (options->monitor_interval_ms + 999) / 1000;
+	}
+
 	/* add warning about changed "barman_" parameter meanings */
 	if ((options->barman_host[0] == '\0' && options->barman_server[0] != '\0') ||
 		(options->barman_host[0] != '\0' && options->barman_server[0] == '\0'))
@@ -994,6 +1056,22 @@ parse_configuration_item(t_configuration_options *options, ItemList *error_list,
         strncpy(options->log_facility, value, MAXLEN);
     else if (strcmp(name, "log_status_interval") == 0)
         options->log_status_interval = repmgr_atoi(value, name, error_list, 0);
+    else if (strcmp(name, "log_format") == 0)
+    {
+        if (strcasecmp(value, "text") == 0)
+        {
+            options->log_format = LOG_FORMAT_TEXT;
+        }
+        else if (strcasecmp(value, "json") == 0)
+        {
+            options->log_format = LOG_FORMAT_JSON;
+        }
+        else
+        {
+            item_list_append(error_list,
+                             _("value for \"log_format\" must be \"text\" or \"json\"\n"));
+        }
+    }
 
     /* standby clone settings */
     else if (strcmp(name, "use_replication_slots") == 0)
@@ -1082,8 +1160,12 @@ parse_configuration_item(t_configuration_options *options, ItemList *error_list,
         options->reconnect_interval = repmgr_atoi(value, name, error_list, 0);
     else if (strcmp(name, "monitor_interval_secs") == 0)
         options->monitor_interval_secs = repmgr_atoi(value, name, error_list, 1);
+    else if (strcmp(name, "monitor_interval") == 0)
+        options->monitor_interval_ms = parse_interval_ms(value, name, error_list, MIN_MONITORING_INTERVAL_MS);
     else if (strcmp(name, "monitoring_history") == 0)
         options->monitoring_history = parse_bool(value, name, error_list);
+    else if (strcmp(name, "monitoring_history_flush_interval") == 0)
+        options->monitoring_history_flush_interval = repmgr_atoi(value, name, error_list, 0);
     else if (strcmp(name, "degraded_monitoring_timeout") == 0)
         options->degraded_monitoring_timeout = repmgr_atoi(value, name, error_list, -1);
     else if (strcmp(name, "async_query_timeout") == 0)
@@ -1094,6 +1176,8 @@ parse_configuration_item(t_configuration_options *options, ItemList *error_list,
         options->repmgrd_standby_startup_timeout = repmgr_atoi(value, name, error_list, 0);
     else if (strcmp(name, "repmgrd_pid_file") == 0)
         strncpy(options->repmgrd_pid_file, value, MAXPGPATH);
+    else if (strcmp(name, "repmgrd_event_spool_file") == 0)
+        strncpy(options->repmgrd_event_spool_file, value, MAXPGPATH);
     else if (strcmp(name, "standby_disconnect_on_failover") == 0)
         options->standby_disconnect_on_failover = parse_bool(value, name, error_list);
     else if (strcmp(name, "sibling_nodes_disconnect_timeout") == 0)
@@ -1124,6 +1208,12 @@ parse_configuration_item(t_configuration_options *options, ItemList *error_list,
         strncpy(options->failover_validation_command, value, sizeof(options->failover_validation_command));
     else if (strcmp(name, "election_rerun_interval") == 0)
         options->election_rerun_interval = repmgr_atoi(value, name, error_list, 0);
+    else if (strcmp(name, "election_poll_timeout") == 0)
+        options->election_poll_timeout = repmgr_atoi(value, name, error_list, 1);
+    else if (strcmp(name, "peer_connection_check_interval") == 0)
+        options->peer_connection_check_interval = repmgr_atoi(value, name, error_list, 0);
+    else if (strcmp(name, "node_list_refresh_interval") == 0)
+        options->node_list_refresh_interval = repmgr_atoi(value, name, error_list, 0);
 //    else if (strcmp(name, "child_nodes_check_interval") == 0)
 //        options->child_nodes_check_interval = repmgr_atoi(value, name, error_list, 1);
 //    else if (strcmp(name, "child_nodes_disconnect_command") == 0)
@@ -1177,6 +1267,10 @@ parse_configuration_item(t_configuration_options *options, ItemList *error_list,
         strncpy(options->event_notifications_orig, value, sizeof(options->event_notifications_orig));
         parse_event_notifications_list(options, value);
     }
+    else if (strcmp(name, "event_notification_timeout") == 0)
+        options->event_notification_timeout = repmgr_atoi(value, name, error_list, 1);
+    else if (strcmp(name, "event_notification_retries") == 0)
+        options->event_notification_retries = repmgr_atoi(value, name, error_list, 0);
 
     /* barman settings */
     else if (strcmp(name, "barman_host") == 0)
@@ -1191,6 +1285,8 @@ parse_configuration_item(t_configuration_options *options, ItemList *error_list,
         strncpy(options->rsync_options, value, sizeof(options->rsync_options));
     else if (strcmp(name, "ssh_options") == 0)
         strncpy(options->ssh_options, value, sizeof(options->ssh_options));
+    else if (strcmp(name, "ssh_control_path") == 0)
+        strncpy(options->ssh_control_path, value, sizeof(options->ssh_control_path));
 
     /* undocumented settings for testing */
     else if (strcmp(name, "promote_delay") == 0)
@@ -1479,17 +1575,25 @@ parse_time_unit_parameter(const char *name, const char *value, char *dest, ItemL
  * - connection_check_type
  * - conninfo
  * - degraded_monitoring_timeout
+ * - election_poll_timeout
  * - event_notification_command
+ * - event_notification_retries
+ * - event_notification_timeout
  * - event_notifications
  * - failover
  * - failover_validation_command
  * - follow_command
  * - log_facility
  * - log_file
+ * - log_format
  * - log_level
  * - log_status_interval
+ * - monitor_interval
  * - monitor_interval_secs
  * - monitoring_history
+ * - monitoring_history_flush_interval
+ * - node_list_refresh_interval
+ * - peer_connection_check_interval
  * - primary_notification_timeout
  * - primary_visibility_consensus
  * - promote_command
@@ -1675,6 +1779,24 @@ reload_config(t_configuration_options *orig_options, t_server_type server_type)
 		config_changed = true;
 	}
 
+	/* event_notification_timeout */
+	if (orig_options->event_notification_timeout != new_options.event_notification_timeout)
+	{
+		orig_options->event_notification_timeout = new_options.event_notification_timeout;
+		log_info(_("\"event_notification_timeout\" is now \"%i\""), new_options.event_notification_timeout);
+
+		config_changed = true;
+	}
+
+	/* event_notification_retries */
+	if (orig_options->event_notification_retries != new_options.event_notification_retries)
+	{
+		orig_options->event_notification_retries = new_options.event_notification_retries;
+		log_info(_("\"event_notification_retries\" is now \"%i\""), new_options.event_notification_retries);
+
+		config_changed = true;
+	}
+
 	/* failover */
 	if (orig_options->failover != new_options.failover)
 	{
@@ -1693,11 +1815,12 @@ reload_config(t_configuration_options *orig_options, t_server_type server_type)
 		config_changed = true;
 	}
 
-	/* monitor_interval_secs */
-	if (orig_options->monitor_interval_secs != new_options.monitor_interval_secs)
+	/* monitor_interval, monitor_interval_secs */
+	if (orig_options->monitor_interval_ms != new_options.monitor_interval_ms)
 	{
+		orig_options->monitor_interval_ms = new_options.monitor_interval_ms;
 		orig_options->monitor_interval_secs = new_options.monitor_interval_secs;
-		log_info(_("\"monitor_interval_secs\" is now \"%i\""), new_options.monitor_interval_secs);
+		log_info(_("\"monitor_interval\" is now \"%ims\""), new_options.monitor_interval_ms);
 
 		config_changed = true;
 	}
@@ -1711,6 +1834,15 @@ reload_config(t_configuration_options *orig_options, t_server_type server_type)
 		config_changed = true;
 	}
 
+	/* monitoring_history_flush_interval */
+	if (orig_options->monitoring_history_flush_interval != new_options.monitoring_history_flush_interval)
+	{
+		orig_options->monitoring_history_flush_interval = new_options.monitoring_history_flush_interval;
+		log_info(_("\"monitoring_history_flush_interval\" is now \"%i\""),
+				 new_options.monitoring_history_flush_interval);
+		config_changed = true;
+	}
+
 	/* primary_notification_timeout */
 	if (orig_options->primary_notification_timeout != new_options.primary_notification_timeout)
 	{
@@ -1784,6 +1916,33 @@ reload_config(t_configuration_options *orig_options, t_server_type server_type)
 		config_changed = true;
 	}
 
+	/* election_poll_timeout */
+	if (orig_options->election_poll_timeout != new_options.election_poll_timeout)
+	{
+		orig_options->election_poll_timeout = new_options.election_poll_timeout;
+		log_info(_("\"election_poll_timeout\" is now \"%i\""),
+				 new_options.election_poll_timeout);
+		config_changed = true;
+	}
+
+	/* peer_connection_check_interval */
+	if (orig_options->peer_connection_check_interval != new_options.peer_connection_check_interval)
+	{
+		orig_options->peer_connection_check_interval = new_options.peer_connection_check_interval;
+		log_info(_("\"peer_connection_check_interval\" is now \"%i\""),
+				 new_options.peer_connection_check_interval);
+		config_changed = true;
+	}
+
+	/* node_list_refresh_interval */
+	if (orig_options->node_list_refresh_interval != new_options.node_list_refresh_interval)
+	{
+		orig_options->node_list_refresh_interval = new_options.node_list_refresh_interval;
+		log_info(_("\"node_list_refresh_interval\" is now \"%i\""),
+				 new_options.node_list_refresh_interval);
+		config_changed = true;
+	}
+
 	/* connection_check_type */
 	if (orig_options->connection_check_type != new_options.connection_check_type)
 	{
@@ -1812,6 +1971,15 @@ reload_config(t_configuration_options *orig_options, t_server_type server_type)
 		config_changed = true;
 	}
 
+    /* device_check_latency_threshold */
+    if (orig_options->device_check_latency_threshold != new_options.device_check_latency_threshold)
+    {
+        orig_options->device_check_latency_threshold = new_options.device_check_latency_threshold;
+        log_info(_("\"device_check_latency_threshold\" is now \"%i\""),
+                new_options.device_check_latency_threshold);
+        config_changed = true;
+    }
+
     /* check_brain_split */
     if (orig_options->check_brain_split != new_options.check_brain_split)
     {
@@ -1845,6 +2013,16 @@ reload_config(t_configuration_options *orig_options, t_server_type server_type)
 		log_config_changed = true;
 	}
 
+	/* log_format */
+	if (orig_options->log_format != new_options.log_format)
+	{
+		orig_options->log_format = new_options.log_format;
+		log_info(_("\"log_format\" is now \"%s\""),
+				 new_options.log_format == LOG_FORMAT_JSON ? "json" : "text");
+
+		log_config_changed = true;
+	}
+
 
 	/* log_level */
 	if (strncmp(orig_options->log_level, new_options.log_level, sizeof(orig_options->log_level)) != 0)
@@ -1869,8 +2047,7 @@ reload_config(t_configuration_options *orig_options, t_server_type server_type)
 	if (log_config_changed == true)
 	{
 		log_notice(_("restarting logging with changed parameters"));
-		logger_shutdown();
-		logger_init(orig_options, progname());
+		logger_reinit(orig_options, progname());
 		log_notice(_("configuration file reloaded with changed parameters"));
 	}
 
@@ -2021,6 +2198,83 @@ repmgr_atoi(const char *value, const char *config_item, ItemList *error_list, in
 }
 
 
+/*
+ * Interpret a parameter value as a time interval, returning the value in
+ * milliseconds. The value may be followed by one of the units "ms", "s" or
+ * "min", as in postgresql.conf; a value without a unit is taken as seconds.
+ */
+int
+parse_interval_ms(const char *value, const char *config_item, ItemList *error_list, int minval_ms)
+{
+	char	   *endptr = NULL;
+	long		longval = 0;
+	int			multiplier = 1000;
+	PQExpBufferData errors;
+
+	initPQExpBuffer(&errors);
+
+	if (*value == '\0')
+	{
+		/* don't log here - empty values will be caught later */
+		return 0;
+	}
+
+	errno = 0;
+	longval = strtol(value, &endptr, 10);
+
+	while (*endptr == ' ' || *endptr == '\t')
+		endptr++;
+
+	if (*endptr == '\0' || strcmp(endptr, "s") == 0)
+		multiplier = 1000;
+	else if (strcmp(endptr, "ms") == 0)
+		multiplier = 1;
+	else if (strcmp(endptr, "min") == 0)
+		multiplier = 60 * 1000;
+	else
+		multiplier = 0;
+
+	if (value == endptr || errno || multiplier == 0)
+	{
+		appendPQExpBuffer(&errors,
+						  _("\"%s\": invalid value (provided: \"%s\"); valid units are \"ms\", \"s\" and \"min\""),
+						  config_item, value);
+	}
+	else if (longval > INT_MAX / multiplier)
+	{
+		appendPQExpBuffer(&errors,
+						  _("\"%s\": value is too large (provided: \"%s\")"),
+						  config_item, value);
+	}
+	else if (longval * multiplier < minval_ms)
+	{
+		appendPQExpBuffer(&errors,
+						  _("\"%s\": must be %ims or greater (provided: \"%s\")"),
+						  config_item,
+						  minval_ms,
+						  value);
+	}
+
+	if (errors.data[0] != '\0')
+	{
+		if (error_list == NULL)
+		{
+			log_error("%s", errors.data);
+			termPQExpBuffer(&errors);
+			exit(ERR_BAD_CONFIG);
+		}
+
+		item_list_append(error_list, errors.data);
+		termPQExpBuffer(&errors);
+
+		return minval_ms;
+	}
+
+	termPQExpBuffer(&errors);
+	return (int) (longval * multiplier);
+}
+
+
 /*
  * Interpret a parameter value as a boolean. Currently accepts:
  *
@@ -2456,6 +2710,7 @@ parse_pg_basebackup_options(const char *pg_basebackup_options, t_basebackup_opti
 	{
 		{"slot", required_argument, NULL, 'S'},
 		{"xlog-method", required_argument, NULL, 'X'},
+		{"compress", required_argument, NULL, 'Z'},
 		{NULL, 0, NULL, 0}
 	};
 
@@ -2468,6 +2723,7 @@ parse_pg_basebackup_options(const char *pg_basebackup_options, t_basebackup_opti
 		{"slot", required_argument, NULL, 'S'},
 		{"wal-method", required_argument, NULL, 'X'},
 		{"no-slot", no_argument, NULL, 1},
+		{"compress", required_argument, NULL, 'Z'},
 		{NULL, 0, NULL, 0}
 	};
 
@@ -2488,7 +2744,7 @@ parse_pg_basebackup_options(const char *pg_basebackup_options, t_basebackup_opti
 	/* Prevent getopt from emitting errors */
 	opterr = 0;
 
-	while ((c = getopt_long(argc_item, argv_array, "S:X:", long_options,
+	while ((c = getopt_long(argc_item, argv_array, "S:X:Z:", long_options,
 							&optindex)) != -1)
 	{
 		switch (c)
@@ -2499,6 +2755,9 @@ parse_pg_basebackup_options(const char *pg_basebackup_options, t_basebackup_opti
 			case 'X':
 				strncpy(backup_options->xlog_method, optarg, MAXLEN);
 				break;
+			case 'Z':
+				strncpy(backup_options->compress, optarg, MAXLEN);
+				break;
 			case 1:
 				backup_options->no_slot = true;
 				break;
@@ -51,6 +51,12 @@ typedef enum
 	CHECK_CONNECTION
 } ConnectionCheckType;
 
+typedef enum
+{
+	LOG_FORMAT_TEXT,
+	LOG_FORMAT_JSON
+} LogFormat;
+
 typedef struct EventNotificationListCell
 {
 	struct EventNotificationListCell *next;
@@ -97,6 +103,7 @@ typedef struct
 	char		log_facility[MAXLEN];
 	char		log_file[MAXPGPATH];
 	int			log_status_interval;
+	LogFormat	log_format;
 
 	/* standby clone settings */
 	bool		use_replication_slots;
@@ -141,20 +148,26 @@ typedef struct
 	char		promote_command[MAXLEN];
 	char		follow_command[MAXLEN];
 	int			monitor_interval_secs;
+	int			monitor_interval_ms;
 	int			reconnect_attempts;
 	int			reconnect_interval;
 	bool		monitoring_history;
+	int			monitoring_history_flush_interval;
 	int			degraded_monitoring_timeout;
 	int			async_query_timeout;
 	int			primary_notification_timeout;
 	int			repmgrd_standby_startup_timeout;
 	char		repmgrd_pid_file[MAXPGPATH];
+	char		repmgrd_event_spool_file[MAXPGPATH];
 	bool		standby_disconnect_on_failover;
 	int			sibling_nodes_disconnect_timeout;
 	ConnectionCheckType connection_check_type;
 	bool		primary_visibility_consensus;
 	char		failover_validation_command[MAXPGPATH];
 	int			election_rerun_interval;
+	int			election_poll_timeout;
+	int			peer_connection_check_interval;
+	int			node_list_refresh_interval;
 
 	/* BDR settings */
 	bool		bdr_local_monitoring_only;
@@ -176,6 +189,8 @@ typedef struct
 	char		event_notification_command[MAXPGPATH];
 	char		event_notifications_orig[MAXLEN];
 	EventNotificationList event_notifications;
+	int			event_notification_timeout;
+	int			event_notification_retries;
 
 	/* barman settings */
 	char		barman_host[MAXLEN];
@@ -185,6 +200,7 @@ typedef struct
 	/* rsync/ssh settings */
 	char		rsync_options[MAXLEN];
 	char		ssh_options[MAXLEN];
+	char		ssh_control_path[MAXPGPATH];
 
 	/* undocumented test settings */
 	int			promote_delay;
@@ -196,6 +212,7 @@ typedef struct
     /* highgo: disk checking settings */
     int         device_check_timeout;
     int         device_check_times;
+    int         device_check_latency_threshold;
 
     /* highgo: standby wait timeout */
     int         standby_wait_timeout;
@@ -212,7 +229,7 @@ typedef struct
 		/* node information */ \
 		UNKNOWN_NODE_ID, "", "", "", "", "", "", "", REPLICATION_TYPE_PHYSICAL,	\
 		/* log settings */ \
-		"", "", "", DEFAULT_LOG_STATUS_INTERVAL, \
+		"", "", "", DEFAULT_LOG_STATUS_INTERVAL, LOG_FORMAT_TEXT, \
 		/* standby clone settings */ \
 		false, "", "", { NULL, NULL }, "", false, "", false, "", \
 		/* standby promote settings */ \
@@ -233,14 +250,16 @@ typedef struct
 		DEFAULT_WITNESS_SYNC_INTERVAL, \
 		/* repmgrd settings */ \
 		FAILOVER_MANUAL, DEFAULT_LOCATION, DEFAULT_PRIORITY, "", "", \
-		DEFAULT_MONITORING_INTERVAL, \
+		DEFAULT_MONITORING_INTERVAL, -1, \
 		DEFAULT_RECONNECTION_ATTEMPTS, \
         DEFAULT_RECONNECTION_INTERVAL, \
-        false, -1, \
+        false, DEFAULT_MONITORING_HISTORY_FLUSH_INTERVAL, -1, \
 		DEFAULT_ASYNC_QUERY_TIMEOUT, \
 		DEFAULT_PRIMARY_NOTIFICATION_TIMEOUT, \
-		-1, "", false, DEFAULT_SIBLING_NODES_DISCONNECT_TIMEOUT, \
+		-1, "", "", false, DEFAULT_SIBLING_NODES_DISCONNECT_TIMEOUT, \
 		CHECK_PING, true, "", DEFAULT_ELECTION_RERUN_INTERVAL, \
+		DEFAULT_ELECTION_POLL_TIMEOUT, DEFAULT_PEER_CONNECTION_CHECK_INTERVAL, \
+		DEFAULT_NODE_LIST_REFRESH_INTERVAL, \
 		/* BDR settings */ \
 		false, DEFAULT_BDR_RECOVERY_TIMEOUT, \
 		/* service settings */ \
@@ -249,16 +268,17 @@ typedef struct
 		"", "",  \
 		/* event notification settings */ \
 		"", "", { NULL, NULL }, \
+		DEFAULT_EVENT_NOTIFICATION_TIMEOUT, DEFAULT_EVENT_NOTIFICATION_RETRIES, \
 		/* barman settings */ \
 		"", "", "",	 \
 		/* rsync/ssh settings */ \
-		 "", "", \
+		 "", "", "", \
 		/* undocumented test settings */ \
 		0, \
         /* highgo: virtual ip settings */ \
         "", "", \
         /* highgo: disk check settings */ \
-        DEVICE_CHECK_TIMEOUT, DEVICE_CHECK_TIMES, \
+        DEVICE_CHECK_TIMEOUT, DEVICE_CHECK_TIMES, DEVICE_CHECK_LATENCY_THRESHOLD, \
         /* highgo: standby wait timeout */\
         DEFAULT_STANDBY_WAIT_TIMEOUT, \
         /* check brain split */\
@@ -272,9 +292,10 @@ typedef struct
 	char		slot[MAXLEN];
 	char		xlog_method[MAXLEN];
 	bool		no_slot;		/* from PostgreSQL 10 */
+	char		compress[MAXLEN];
 } t_basebackup_options;
 
-#define T_BASEBACKUP_OPTIONS_INITIALIZER { "", "", false }
+#define T_BASEBACKUP_OPTIONS_INITIALIZER { "", "", false, "" }
 
 
 typedef enum
@@ -347,6 +368,11 @@ int repmgr_atoi(const char *s,
 			ItemList *error_list,
 			int minval);
 
+int			parse_interval_ms(const char *value,
+							  const char *config_item,
+							  ItemList *error_list,
+							  int minval_ms);
+
 bool parse_pg_basebackup_options(const char *pg_basebackup_options,
 							t_basebackup_options *backup_options,
 							int server_version_num,
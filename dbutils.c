@@ -19,12 +19,14 @@
  *
  */
 
+#include <fcntl.h>
 #include <unistd.h>
 #include <time.h>
 #include <sys/time.h>
 #include <sys/stat.h>
 #include <dirent.h>
 #include <arpa/inet.h>
+#include <poll.h>
 
 #include "repmgr.h"
 #include "dbutils.h"
@@ -41,6 +43,22 @@
  */
 int			bdr_version_num = UNKNOWN_BDR_VERSION_NUM;
 
+/*
+ * Connection on which node records were modified inside a transaction
+ * block; the node record version is bumped once that transaction commits.
+ */
+static PGconn *node_records_changed_conn = NULL;
+
+/*
+ * Local spool for events which could not be written to the primary; only
+ * opened by repmgrd (see open_event_spool()).
+ */
+static int	event_spool_fd = -1;
+static char event_spool_path[MAXPGPATH] = "";
+static int	event_spool_records = 0;
+static int	event_spool_unsynced = 0;
+static time_t event_spool_last_sync = 0;
+
 static void log_db_error(PGconn *conn, const char *query_text, const char *fmt,...)
 __attribute__((format(PG_PRINTF_ATTRIBUTE, 3, 4)));
 
@@ -51,6 +69,7 @@ static PGconn *_establish_db_connection(const char *conninfo,
 						 const bool log_notice,
 						 const bool verbose_only);
 
+static void _establish_db_connections_concurrently(NodeInfoList *node_list, int timeout_ms, bool quiet);
 static PGconn *_get_primary_connection(PGconn *standby_conn, int *primary_id, char *primary_conninfo_out, bool quiet);
 
 static bool _set_config(PGconn *conn, const char *config_param, const char *sqlquery);
@@ -61,11 +80,37 @@ static void _populate_node_records(PGresult *res, NodeInfoList *node_list);
 
 static bool _create_update_node_record(PGconn *conn, char *action, t_node_info *node_info);
 static bool _create_event(PGconn *conn, t_configuration_options *options, int node_id, char *event, bool successful, char *details, t_event_info *event_info, bool send_notification);
+static bool _spool_event(int node_id, const char *event, bool successful, const char *details);
+static void _append_copy_text(PQExpBufferData *buf, const char *str);
+static void _sync_event_spool(bool force);
+static bool _replay_event_spool(PGconn *conn);
+static bool _replay_event_spool_by_record(PGconn *conn, const char *contents, size_t len);
+static bool _copy_event_records(PGconn *conn, const char *data, size_t len, char *sqlstate);
+static bool _rewrite_event_spool(const char *data, size_t len);
 
 static bool _is_bdr_db(PGconn *conn, PQExpBufferData *output, bool quiet);
 static void _populate_bdr_node_record(PGresult *res, t_bdr_node_info *node_info, int row);
 static void _populate_bdr_node_records(PGresult *res, BdrNodeInfoList *node_list);
 
+static void _build_replication_info_query(PGconn *conn, t_server_type node_type, PQExpBufferData *query);
+static void _populate_replication_info(PGresult *res, ReplInfo *replication_info);
+
+static void _build_election_state_query(t_server_type node_type, PQExpBufferData *query);
+static void _populate_election_state(PGresult *res, t_election_state *election_state);
+static void _build_election_state_cell_query(NodeInfoListCell *cell, PQExpBufferData *query);
+static void _populate_election_state_cell(NodeInfoListCell *cell, PGresult *res);
+static void _build_replication_info_cell_query(NodeInfoListCell *cell, PQExpBufferData *query);
+static void _populate_replication_info_cell(NodeInfoListCell *cell, PGresult *res);
+static void _build_ping_cell_query(NodeInfoListCell *cell, PQExpBufferData *query);
+static void _populate_ping_cell(NodeInfoListCell *cell, PGresult *res);
+static void _query_nodes_concurrently(NodeInfoList *node_list, int timeout_ms,
+									  const char *caller, const char *description,
+									  void (*build_query) (NodeInfoListCell *cell, PQExpBufferData *query),
+									  void (*populate) (NodeInfoListCell *cell, PGresult *res));
+
+static void _node_records_changed(PGconn *conn);
+static void _bump_node_records_version(PGconn *conn);
+
 void
 log_db_error(PGconn *conn, const char *query_text, const char *fmt,...)
 {
@@ -332,6 +377,225 @@ establish_db_connection_by_params(t_conninfo_param_list *param_list,
 }
 
 
+/*
+ * Establish connections to all nodes in the provided list concurrently,
+ * using libpq's non-blocking connection API. This ensures the time spent
+ * is bounded by the slowest responsive node (or "timeout_ms" in total),
+ * rather than the sum of all "connect_timeout" values.
+ *
+ * Nodes which already have a usable connection are left untouched. On
+ * return, each node's "conn" is either a usable connection or NULL.
+ *
+ * "synchronous_commit" is set to "local" via the "options" parameter (if
+ * not already provided), as set_config() would require an additional
+ * round trip to each node.
+ */
+void
+establish_db_connections_concurrently(NodeInfoList *node_list, int timeout_ms)
+{
+	_establish_db_connections_concurrently(node_list, timeout_ms, false);
+}
+
+
+/*
+ * As establish_db_connections_concurrently(), but nothing is logged, and
+ * a failed connection is left in place so the caller can retrieve the
+ * error with PQerrorMessage(). "conn" is NULL only if the connection
+ * attempt could not be initiated, or was abandoned at the timeout.
+ */
+void
+establish_db_connections_concurrently_quiet(NodeInfoList *node_list, int timeout_ms)
+{
+	_establish_db_connections_concurrently(node_list, timeout_ms, true);
+}
+
+
+static void
+_establish_db_connections_concurrently(NodeInfoList *node_list, int timeout_ms, bool quiet)
+{
+	NodeInfoListCell *cell = NULL;
+	t_node_info **nodes = NULL;
+	PostgresPollingStatusType *poll_status = NULL;
+	struct pollfd *poll_fds = NULL;
+	int		   *poll_index = NULL;
+	instr_time	start_time;
+	int			pending = 0;
+	int			i;
+	char		connect_timeout[MAXLEN] = "";
+
+	if (node_list->node_count == 0)
+		return;
+
+	/*
+	 * Derive "connect_timeout" from the caller's deadline (which is itself
+	 * taken from the applicable configuration option), rounded up to whole
+	 * seconds; libpq treats any value below 2 seconds as 2 seconds.
+	 */
+	maxlen_snprintf(connect_timeout, "%i",
+					timeout_ms < 2000 ? 2 : (timeout_ms + 999) / 1000);
+
+	nodes = pg_malloc0(sizeof(t_node_info *) * node_list->node_count);
+	poll_status = pg_malloc0(sizeof(PostgresPollingStatusType) * node_list->node_count);
+	poll_fds = pg_malloc0(sizeof(struct pollfd) * node_list->node_count);
+	poll_index = pg_malloc0(sizeof(int) * node_list->node_count);
+
+	INSTR_TIME_SET_CURRENT(start_time);
+
+	for (cell = node_list->head, i = 0; cell; cell = cell->next, i++)
+	{
+		t_conninfo_param_list conninfo_params = T_CONNINFO_PARAM_LIST_INITIALIZER;
+		char	   *errmsg = NULL;
+
+		nodes[i] = cell->node_info;
+		poll_status[i] = PGRES_POLLING_FAILED;
+
+		if (PQstatus(cell->node_info->conn) == CONNECTION_OK)
+			continue;
+
+		close_connection(&cell->node_info->conn);
+
+		initialize_conninfo_params(&conninfo_params, false);
+
+		if (parse_conninfo_string(cell->node_info->conninfo, &conninfo_params, &errmsg, false) == false)
+		{
+			if (quiet == false)
+			{
+				log_error(_("unable to parse conninfo string \"%s\" for node %i"),
+						  cell->node_info->conninfo,
+						  cell->node_info->node_id);
+				log_detail("%s", errmsg);
+			}
+			free_conninfo_params(&conninfo_params);
+			continue;
+		}
+
+		param_set_ine(&conninfo_params, "connect_timeout", connect_timeout);
+		param_set_ine(&conninfo_params, "fallback_application_name", "repmgr");
+		param_set_ine(&conninfo_params, "options", "-c synchronous_commit=local");
+
+		log_debug("establish_db_connections_concurrently(): connecting to node %i",
+				  cell->node_info->node_id);
+
+		cell->node_info->conn = PQconnectStartParams((const char **) conninfo_params.keywords,
+													 (const char **) conninfo_params.values,
+													 true);
+		free_conninfo_params(&conninfo_params);
+
+		if (cell->node_info->conn == NULL)
+			continue;
+
+		if (PQstatus(cell->node_info->conn) == CONNECTION_BAD)
+		{
+			if (quiet == false)
+			{
+				log_warning(_("unable to initiate connection to node \"%s\" (ID: %i)"),
+							cell->node_info->node_name,
+							cell->node_info->node_id);
+				log_detail("\n%s", PQerrorMessage(cell->node_info->conn));
+				close_connection(&cell->node_info->conn);
+			}
+			continue;
+		}
+
+		/* as per libpq documentation, behave as if the last poll returned PGRES_POLLING_WRITING */
+		poll_status[i] = PGRES_POLLING_WRITING;
+		pending++;
+	}
+
+	while (pending > 0)
+	{
+		instr_time	cur_time;
+		int			remaining_ms;
+		int			nfds = 0;
+		int			ret;
+
+		INSTR_TIME_SET_CURRENT(cur_time);
+		INSTR_TIME_SUBTRACT(cur_time, start_time);
+		remaining_ms = timeout_ms - (int) INSTR_TIME_GET_MILLISEC(cur_time);
+
+		if (remaining_ms <= 0)
+			break;
+
+		for (i = 0; i < node_list->node_count; i++)
+		{
+			if (poll_status[i] != PGRES_POLLING_READING && poll_status[i] != PGRES_POLLING_WRITING)
+				continue;
+
+			poll_fds[nfds].fd = PQsocket(nodes[i]->conn);
+			poll_fds[nfds].events = poll_status[i] == PGRES_POLLING_READING ? POLLIN : POLLOUT;
+			poll_fds[nfds].revents = 0;
+			poll_index[nfds] = i;
+			nfds++;
+		}
+
+		ret = poll(poll_fds, nfds, remaining_ms);
+
+		if (ret < 0)
+		{
+			if (errno == EINTR)
+				continue;
+
+			if (quiet == false)
+			{
+				log_warning(_("establish_db_connections_concurrently(): poll() returned with error"));
+				log_detail("%s", strerror(errno));
+			}
+			break;
+		}
+
+		for (i = 0; i < nfds; i++)
+		{
+			t_node_info *node_info = nodes[poll_index[i]];
+
+			if (poll_fds[i].revents == 0)
+				continue;
+
+			poll_status[poll_index[i]] = PQconnectPoll(node_info->conn);
+
+			if (poll_status[poll_index[i]] == PGRES_POLLING_OK)
+			{
+				log_debug("establish_db_connections_concurrently(): connected to node %i",
+						  node_info->node_id);
+				pending--;
+			}
+			else if (poll_status[poll_index[i]] == PGRES_POLLING_FAILED)
+			{
+				if (quiet == false)
+				{
+					log_warning(_("unable to connect to node \"%s\" (ID: %i)"),
+								node_info->node_name,
+								node_info->node_id);
+					log_detail("\n%s", PQerrorMessage(node_info->conn));
+					close_connection(&node_info->conn);
+				}
+				pending--;
+			}
+		}
+	}
+
+	/* abandon any connection attempts which did not complete in time */
+	for (i = 0; i < node_list->node_count; i++)
+	{
+		if (poll_status[i] != PGRES_POLLING_READING && poll_status[i] != PGRES_POLLING_WRITING)
+			continue;
+
+		if (quiet == false)
+		{
+			log_warning(_("connection to node \"%s\" (ID: %i) not established within %i milliseconds"),
+						nodes[i]->node_name,
+						nodes[i]->node_id,
+						timeout_ms);
+		}
+		close_connection(&nodes[i]->conn);
+	}
+
+	pfree(nodes);
+	pfree(poll_status);
+	pfree(poll_fds);
+	pfree(poll_index);
+}
+
+
 bool
 is_superuser_connection(PGconn *conn, t_connection_user *userinfo)
 {
@@ -901,11 +1165,20 @@ commit_transaction(PGconn *conn)
 		log_detail("%s", PQerrorMessage(conn));
 		PQclear(res);
 
+		if (node_records_changed_conn == conn)
+			node_records_changed_conn = NULL;
+
 		return false;
 	}
 
 	PQclear(res);
 
+	if (node_records_changed_conn == conn)
+	{
+		node_records_changed_conn = NULL;
+		_bump_node_records_version(conn);
+	}
+
 	return true;
 }
 
@@ -917,6 +1190,9 @@ rollback_transaction(PGconn *conn)
 
 	log_verbose(LOG_DEBUG, "rollback_transaction()");
 
+	if (node_records_changed_conn == conn)
+		node_records_changed_conn = NULL;
+
 	res = PQexec(conn, "ROLLBACK");
 
 	if (PQresultStatus(res) != PGRES_COMMAND_OK)
@@ -1893,157 +2169,664 @@ repmgrd_get_pid(PGconn *conn)
 }
 
 
-bool
-repmgrd_is_running(PGconn *conn)
+static void
+_build_election_state_query(t_server_type node_type, PQExpBufferData *query)
 {
-	PGresult   *res = NULL;
-	bool		is_running = false;
-
-	res = PQexec(conn, "SELECT repmgr.repmgrd_is_running()");
+	appendPQExpBufferStr(query,
+						 " SELECT repmgrd_pid, "
+						 "        repmgrd_paused, "
+						 "        in_recovery, "
+						 "        last_wal_receive_lsn, "
+						 "        last_wal_replay_lsn, "
+						 "        wal_replay_paused, ");
 
-	if (PQresultStatus(res) != PGRES_TUPLES_OK)
+	if (node_type == WITNESS)
 	{
-		log_error(_("unable to execute \"SELECT repmgr.repmgrd_is_running()\""));
-		log_detail("%s", PQerrorMessage(conn));
+		appendPQExpBufferStr(query,
+							 "        upstream_last_seen, ");
 	}
-	else if (!PQgetisnull(res, 0, 0))
+	else
 	{
-		is_running = atobool(PQgetvalue(res, 0, 0));
+		appendPQExpBufferStr(query,
+							 "        CASE WHEN in_recovery IS FALSE "
+							 "          THEN -1 "
+							 "          ELSE upstream_last_seen "
+							 "        END AS upstream_last_seen, ");
 	}
 
-	PQclear(res);
+	appendPQExpBufferStr(query,
+						 "        current_electoral_term, "
+						 "        priority "
+						 "   FROM repmgr.get_election_state() ");
+}
 
-	return is_running;
+
+static void
+_populate_election_state(PGresult *res, t_election_state *election_state)
+{
+	/* all columns will be NULL if the shared library is not loaded */
+	election_state->repmgrd_pid = PQgetisnull(res, 0, 0)
+		? UNKNOWN_PID
+		: atoi(PQgetvalue(res, 0, 0));
+	election_state->repmgrd_paused = atobool(PQgetvalue(res, 0, 1));
+	election_state->in_recovery = atobool(PQgetvalue(res, 0, 2));
+	election_state->last_wal_receive_lsn = PQgetisnull(res, 0, 3)
+		? InvalidXLogRecPtr
+		: parse_lsn(PQgetvalue(res, 0, 3));
+	election_state->last_wal_replay_lsn = PQgetisnull(res, 0, 4)
+		? InvalidXLogRecPtr
+		: parse_lsn(PQgetvalue(res, 0, 4));
+	election_state->wal_replay_paused = atobool(PQgetvalue(res, 0, 5));
+	election_state->upstream_last_seen = PQgetisnull(res, 0, 6)
+		? -1
+		: atoi(PQgetvalue(res, 0, 6));
+	election_state->current_electoral_term = PQgetisnull(res, 0, 7)
+		? VOTING_TERM_NOT_SET
+		: atoi(PQgetvalue(res, 0, 7));
+	election_state->priority = PQgetisnull(res, 0, 8)
+		? -1
+		: atoi(PQgetvalue(res, 0, 8));
 }
 
 
-bool
-repmgrd_is_paused(PGconn *conn)
+/*
+ * Store the local node's current electoral term and priority in shared
+ * memory, for retrieval by other nodes via repmgr.get_election_state().
+ */
+void
+repmgrd_set_election_state(PGconn *conn, int priority)
 {
+	PQExpBufferData query;
 	PGresult   *res = NULL;
-	bool		is_paused = false;
 
-	res = PQexec(conn, "SELECT repmgr.repmgrd_is_paused()");
+	initPQExpBuffer(&query);
+
+	appendPQExpBuffer(&query,
+					  "SELECT repmgr.set_election_state( "
+					  "  COALESCE((SELECT term FROM repmgr.voting_term), %i), "
+					  "  %i)",
+					  VOTING_TERM_NOT_SET,
+					  priority);
+
+	res = PQexec(conn, query.data);
 
 	if (PQresultStatus(res) != PGRES_TUPLES_OK)
 	{
-		log_error(_("unable to execute \"SELECT repmgr.repmgrd_is_paused()\""));
-		log_detail("%s", PQerrorMessage(conn));
-	}
-	else if (!PQgetisnull(res, 0, 0))
-	{
-		is_paused = atobool(PQgetvalue(res, 0, 0));
+		log_db_error(conn, query.data, _("unable to execute repmgr.set_election_state()"));
 	}
 
+	termPQExpBuffer(&query);
 	PQclear(res);
-
-	return is_paused;
 }
 
 
+/*
+ * Publish a storage latency histogram collected by repmgrd's disk check,
+ * so it can be retrieved with repmgr.get_storage_latency().
+ */
 bool
-repmgrd_pause(PGconn *conn, bool pause)
+repmgrd_set_storage_latency(PGconn *conn, StorageProbeType probe, StorageLatencyHistogram *histogram, bool degraded)
 {
 	PQExpBufferData query;
 	PGresult   *res = NULL;
 	bool		success = true;
+	int			i;
 
 	initPQExpBuffer(&query);
 
 	appendPQExpBuffer(&query,
-					  "SELECT repmgr.repmgrd_pause(%s)",
-					  pause == true ? "TRUE" : "FALSE");
+					  "SELECT repmgr.set_storage_latency(%i, " INT64_FORMAT ", " INT64_FORMAT ", '{",
+					  (int) probe,
+					  histogram->samples,
+					  histogram->max_us);
+
+	for (i = 0; i < STORAGE_LATENCY_BUCKETS; i++)
+	{
+		appendPQExpBuffer(&query, "%s" INT64_FORMAT,
+						  i > 0 ? "," : "",
+						  histogram->counts[i]);
+	}
+
+	appendPQExpBuffer(&query,
+					  "}'::BIGINT[], %s)",
+					  degraded == true ? "TRUE" : "FALSE");
+
 	res = PQexec(conn, query.data);
-	termPQExpBuffer(&query);
 
 	if (PQresultStatus(res) != PGRES_TUPLES_OK)
 	{
-		log_error(_("unable to execute \"SELECT repmgr.repmgrd_pause()\""));
-		log_detail("%s", PQerrorMessage(conn));
-
+		log_db_error(conn, query.data, _("unable to execute repmgr.set_storage_latency()"));
 		success = false;
 	}
 
+	termPQExpBuffer(&query);
 	PQclear(res);
 
 	return success;
 }
 
-pid_t
-get_wal_receiver_pid(PGconn *conn)
+
+/*
+ * Retrieve the storage latency reported by repmgrd on the node "conn" is
+ * connected to; "storage_latency" must be an array of STORAGE_PROBE_TYPES
+ * elements. Returns false if no latency information is available, e.g.
+ * because repmgrd is not running or the extension is an earlier version.
+ */
+bool
+get_storage_latency(PGconn *conn, t_storage_latency *storage_latency)
 {
 	PGresult   *res = NULL;
-	pid_t		wal_receiver_pid = UNKNOWN_PID;
+	bool		found = false;
+	int			i;
 
-	res = PQexec(conn, "SELECT repmgr.get_wal_receiver_pid()");
+	res = PQexec(conn,
+				 "SELECT probe, samples, p50_us, p99_us, max_us, degraded "
+				 "  FROM repmgr.get_storage_latency()");
 
 	if (PQresultStatus(res) != PGRES_TUPLES_OK)
 	{
-		log_error(_("unable to execute \"SELECT repmgr.get_wal_receiver_pid()\""));
-		log_detail("%s", PQerrorMessage(conn));
+		log_verbose(LOG_DEBUG, "get_storage_latency(): unable to execute query:\n  %s",
+					PQerrorMessage(conn));
+		PQclear(res);
+		return false;
 	}
-	else if (!PQgetisnull(res, 0, 0))
+
+	for (i = 0; i < PQntuples(res); i++)
 	{
-		wal_receiver_pid = atoi(PQgetvalue(res, 0, 0));
+		int			probe;
+
+		for (probe = 0; probe < STORAGE_PROBE_TYPES; probe++)
+		{
+			t_storage_latency *latency = &storage_latency[probe];
+
+			if (strcmp(PQgetvalue(res, i, 0), storage_probe_name(probe)) != 0)
+				continue;
+
+			latency->valid = true;
+			latency->samples = atoll(PQgetvalue(res, i, 1));
+			latency->p50_us = PQgetisnull(res, i, 2) ? -1 : atoll(PQgetvalue(res, i, 2));
+			latency->p99_us = PQgetisnull(res, i, 3) ? -1 : atoll(PQgetvalue(res, i, 3));
+			latency->max_us = PQgetisnull(res, i, 4) ? -1 : atoll(PQgetvalue(res, i, 4));
+			latency->degraded = atobool(PQgetvalue(res, i, 5));
+			found = true;
+		}
 	}
 
 	PQclear(res);
 
-	return wal_receiver_pid;
+	return found;
 }
 
-/* ================ */
-/* result functions */
-/* ================ */
 
-bool
-atobool(const char *value)
+/*
+ * Retrieve the election state (see repmgr.get_election_state()) from all
+ * connected nodes in the provided list concurrently, waiting at most
+ * "timeout_ms" in total.
+ *
+ * On return, each cell's "election_state" is populated and
+ * "election_state_valid" set for nodes which responded; connections to
+ * nodes which did not respond in time are closed.
+ */
+void
+get_election_state_concurrently(NodeInfoList *node_list, int timeout_ms)
 {
-	return (strcmp(value, "t") == 0)
-		? true
-		: false;
-}
+	NodeInfoListCell *cell = NULL;
 
+	for (cell = node_list->head; cell; cell = cell->next)
+		cell->election_state_valid = false;
 
-/* =================== */
-/* extension functions */
-/* =================== */
+	_query_nodes_concurrently(node_list, timeout_ms,
+							  "get_election_state_concurrently()",
+							  _("election state"),
+							  _build_election_state_cell_query,
+							  _populate_election_state_cell);
+}
 
-ExtensionStatus
-get_repmgr_extension_status(PGconn *conn, t_extension_versions *extversions)
-{
-	PQExpBufferData query;
-	PGresult   *res = NULL;
-	ExtensionStatus status = REPMGR_UNKNOWN;
 
-	/* TODO: check version */
+/*
+ * Retrieve the election state from a node using the individual queries
+ * executed before repmgr.get_election_state() was available; used for
+ * nodes whose repmgr extension has not yet been upgraded.
+ *
+ * Values not available via these queries are set to "unknown".
+ */
+bool
+get_election_state_by_node_queries(PGconn *conn, t_server_type node_type, t_election_state *election_state)
+{
+	ReplInfo	replication_info;
 
-	initPQExpBuffer(&query);
+	init_replication_info(&replication_info);
 
-	appendPQExpBufferStr(&query,
-						 "	  SELECT ae.name, e.extname, "
-						 "           ae.default_version, "
-						 "           (((ae.default_version::NUMERIC::INT) * 10000) + (ae.default_version::NUMERIC - ae.default_version::NUMERIC::INT) * 1000)::INT AS available, "
-						 "           ae.installed_version, "
-						 "           (((ae.installed_version::NUMERIC::INT) * 10000) + (ae.installed_version::NUMERIC - ae.installed_version::NUMERIC::INT) * 1000)::INT AS installed "
-						 "     FROM pg_catalog.pg_available_extensions ae "
-						 "LEFT JOIN pg_catalog.pg_extension e "
-						 "       ON e.extname=ae.name "
-						 "	   WHERE ae.name='repmgr' ");
+	if (get_replication_info(conn, node_type, &replication_info) == false)
+		return false;
 
-	res = PQexec(conn, query.data);
+	election_state->repmgrd_pid = repmgrd_get_pid(conn);
+	election_state->repmgrd_paused = false;
+	election_state->in_recovery = replication_info.in_recovery;
+	election_state->last_wal_receive_lsn = replication_info.last_wal_receive_lsn;
+	election_state->last_wal_replay_lsn = replication_info.last_wal_replay_lsn;
+	election_state->wal_replay_paused = replication_info.wal_replay_paused;
+	election_state->upstream_last_seen = replication_info.upstream_last_seen;
+	election_state->current_electoral_term = VOTING_TERM_NOT_SET;
+	election_state->priority = -1;
 
-	if (PQresultStatus(res) != PGRES_TUPLES_OK)
-	{
-		log_db_error(conn, query.data, _("get_repmgr_extension_status(): unable to execute extension query"));
-		status = REPMGR_UNKNOWN;
-	}
+	return true;
+}
 
-	/* 1. Check extension is actually available */
-	else if (PQntuples(res) == 0)
-	{
-		status = REPMGR_UNAVAILABLE;
-	}
+
+/*
+ * As get_replication_info(), but for all connected nodes in the provided
+ * list concurrently, waiting at most "timeout_ms" in total.
+ *
+ * On return, each cell's "replinfo" is populated and "replinfo_valid" set
+ * for nodes which responded; connections to nodes which did not respond
+ * in time are closed.
+ */
+void
+get_replication_info_concurrently(NodeInfoList *node_list, int timeout_ms)
+{
+	NodeInfoListCell *cell = NULL;
+
+	for (cell = node_list->head; cell; cell = cell->next)
+		cell->replinfo_valid = false;
+
+	_query_nodes_concurrently(node_list, timeout_ms,
+							  "get_replication_info_concurrently()",
+							  _("replication info"),
+							  _build_replication_info_cell_query,
+							  _populate_replication_info_cell);
+}
+
+
+/*
+ * As connection_ping(), but for all connected nodes in the provided list
+ * concurrently, waiting at most "timeout_ms" in total.
+ *
+ * On return, "ping_ok" is set for nodes which responded; connections to
+ * nodes which did not respond in time are closed.
+ */
+void
+ping_nodes_concurrently(NodeInfoList *node_list, int timeout_ms)
+{
+	NodeInfoListCell *cell = NULL;
+
+	for (cell = node_list->head; cell; cell = cell->next)
+		cell->ping_ok = false;
+
+	_query_nodes_concurrently(node_list, timeout_ms,
+							  "ping_nodes_concurrently()",
+							  _("ping result"),
+							  _build_ping_cell_query,
+							  _populate_ping_cell);
+}
+
+
+static void
+_build_election_state_cell_query(NodeInfoListCell *cell, PQExpBufferData *query)
+{
+	_build_election_state_query(cell->node_info->type, query);
+}
+
+
+static void
+_populate_election_state_cell(NodeInfoListCell *cell, PGresult *res)
+{
+	_populate_election_state(res, &cell->election_state);
+	cell->election_state_valid = true;
+}
+
+
+static void
+_build_replication_info_cell_query(NodeInfoListCell *cell, PQExpBufferData *query)
+{
+	_build_replication_info_query(cell->node_info->conn, cell->node_info->type, query);
+}
+
+
+static void
+_populate_replication_info_cell(NodeInfoListCell *cell, PGresult *res)
+{
+	_populate_replication_info(res, &cell->replinfo);
+	cell->replinfo_valid = true;
+}
+
+
+static void
+_build_ping_cell_query(NodeInfoListCell *cell, PQExpBufferData *query)
+{
+	appendPQExpBufferStr(query, "SELECT TRUE");
+}
+
+
+static void
+_populate_ping_cell(NodeInfoListCell *cell, PGresult *res)
+{
+	cell->ping_ok = true;
+}
+
+
+/*
+ * Execute a single-row query on all connected nodes in the provided list
+ * concurrently, waiting at most "timeout_ms" in total; "build_query" is
+ * called for every node, "populate" for each node which returned a row.
+ * Connections to nodes which did not respond in time are closed.
+ *
+ * "caller" and "description" are used in log messages only.
+ */
+static void
+_query_nodes_concurrently(NodeInfoList *node_list, int timeout_ms,
+						  const char *caller, const char *description,
+						  void (*build_query) (NodeInfoListCell *cell, PQExpBufferData *query),
+						  void (*populate) (NodeInfoListCell *cell, PGresult *res))
+{
+	NodeInfoListCell *cell = NULL;
+	NodeInfoListCell **cells = NULL;
+	struct pollfd *poll_fds = NULL;
+	int		   *poll_index = NULL;
+	bool	   *awaiting_result = NULL;
+	instr_time	start_time;
+	int			pending = 0;
+	int			i;
+
+	if (node_list->node_count == 0)
+		return;
+
+	cells = pg_malloc0(sizeof(NodeInfoListCell *) * node_list->node_count);
+	poll_fds = pg_malloc0(sizeof(struct pollfd) * node_list->node_count);
+	poll_index = pg_malloc0(sizeof(int) * node_list->node_count);
+	awaiting_result = pg_malloc0(sizeof(bool) * node_list->node_count);
+
+	INSTR_TIME_SET_CURRENT(start_time);
+
+	for (cell = node_list->head, i = 0; cell; cell = cell->next, i++)
+	{
+		PQExpBufferData query;
+
+		cells[i] = cell;
+
+		if (PQstatus(cell->node_info->conn) != CONNECTION_OK)
+			continue;
+
+		initPQExpBuffer(&query);
+		build_query(cell, &query);
+
+		log_verbose(LOG_DEBUG, "%s: node %i:\n%s",
+					caller, cell->node_info->node_id, query.data);
+
+		if (PQsendQuery(cell->node_info->conn, query.data) == 0)
+		{
+			log_warning(_("unable to send query to node \"%s\" (ID: %i)"),
+						cell->node_info->node_name,
+						cell->node_info->node_id);
+			log_detail("%s", PQerrorMessage(cell->node_info->conn));
+		}
+		else
+		{
+			awaiting_result[i] = true;
+			pending++;
+		}
+
+		termPQExpBuffer(&query);
+	}
+
+	while (pending > 0)
+	{
+		instr_time	cur_time;
+		int			remaining_ms;
+		int			nfds = 0;
+		int			ret;
+
+		INSTR_TIME_SET_CURRENT(cur_time);
+		INSTR_TIME_SUBTRACT(cur_time, start_time);
+		remaining_ms = timeout_ms - (int) INSTR_TIME_GET_MILLISEC(cur_time);
+
+		if (remaining_ms <= 0)
+			break;
+
+		for (i = 0; i < node_list->node_count; i++)
+		{
+			if (awaiting_result[i] == false)
+				continue;
+
+			poll_fds[nfds].fd = PQsocket(cells[i]->node_info->conn);
+			poll_fds[nfds].events = POLLIN;
+			poll_fds[nfds].revents = 0;
+			poll_index[nfds] = i;
+			nfds++;
+		}
+
+		ret = poll(poll_fds, nfds, remaining_ms);
+
+		if (ret < 0)
+		{
+			if (errno == EINTR)
+				continue;
+
+			log_warning(_("%s: poll() returned with error"), caller);
+			log_detail("%s", strerror(errno));
+			break;
+		}
+
+		for (i = 0; i < nfds; i++)
+		{
+			NodeInfoListCell *node_cell = cells[poll_index[i]];
+			PGconn	   *conn = node_cell->node_info->conn;
+			PGresult   *res = NULL;
+
+			if (poll_fds[i].revents == 0)
+				continue;
+
+			if (PQconsumeInput(conn) == 0)
+			{
+				log_warning(_("unable to receive data from node \"%s\" (ID: %i)"),
+							node_cell->node_info->node_name,
+							node_cell->node_info->node_id);
+				log_detail("%s", PQerrorMessage(conn));
+				awaiting_result[poll_index[i]] = false;
+				pending--;
+				continue;
+			}
+
+			if (PQisBusy(conn) == 1)
+				continue;
+
+			res = PQgetResult(conn);
+
+			if (PQresultStatus(res) != PGRES_TUPLES_OK || !PQntuples(res))
+			{
+				log_warning(_("unable to retrieve %s for node \"%s\" (ID: %i)"),
+							description,
+							node_cell->node_info->node_name,
+							node_cell->node_info->node_id);
+				log_detail("%s", PQerrorMessage(conn));
+			}
+			else
+			{
+				populate(node_cell, res);
+			}
+
+			PQclear(res);
+
+			/* consume the terminating NULL result */
+			while ((res = PQgetResult(conn)) != NULL)
+				PQclear(res);
+
+			awaiting_result[poll_index[i]] = false;
+			pending--;
+		}
+	}
+
+	/* close connections to any nodes which did not respond in time */
+	for (i = 0; i < node_list->node_count; i++)
+	{
+		if (awaiting_result[i] == false)
+			continue;
+
+		log_warning(_("node \"%s\" (ID: %i) did not respond within %i milliseconds"),
+					cells[i]->node_info->node_name,
+					cells[i]->node_info->node_id,
+					timeout_ms);
+		close_connection(&cells[i]->node_info->conn);
+	}
+
+	pfree(cells);
+	pfree(poll_fds);
+	pfree(poll_index);
+	pfree(awaiting_result);
+}
+
+
+bool
+repmgrd_is_running(PGconn *conn)
+{
+	PGresult   *res = NULL;
+	bool		is_running = false;
+
+	res = PQexec(conn, "SELECT repmgr.repmgrd_is_running()");
+
+	if (PQresultStatus(res) != PGRES_TUPLES_OK)
+	{
+		log_error(_("unable to execute \"SELECT repmgr.repmgrd_is_running()\""));
+		log_detail("%s", PQerrorMessage(conn));
+	}
+	else if (!PQgetisnull(res, 0, 0))
+	{
+		is_running = atobool(PQgetvalue(res, 0, 0));
+	}
+
+	PQclear(res);
+
+	return is_running;
+}
+
+
+bool
+repmgrd_is_paused(PGconn *conn)
+{
+	PGresult   *res = NULL;
+	bool		is_paused = false;
+
+	res = PQexec(conn, "SELECT repmgr.repmgrd_is_paused()");
+
+	if (PQresultStatus(res) != PGRES_TUPLES_OK)
+	{
+		log_error(_("unable to execute \"SELECT repmgr.repmgrd_is_paused()\""));
+		log_detail("%s", PQerrorMessage(conn));
+	}
+	else if (!PQgetisnull(res, 0, 0))
+	{
+		is_paused = atobool(PQgetvalue(res, 0, 0));
+	}
+
+	PQclear(res);
+
+	return is_paused;
+}
+
+
+bool
+repmgrd_pause(PGconn *conn, bool pause)
+{
+	PQExpBufferData query;
+	PGresult   *res = NULL;
+	bool		success = true;
+
+	initPQExpBuffer(&query);
+
+	appendPQExpBuffer(&query,
+					  "SELECT repmgr.repmgrd_pause(%s)",
+					  pause == true ? "TRUE" : "FALSE");
+	res = PQexec(conn, query.data);
+	termPQExpBuffer(&query);
+
+	if (PQresultStatus(res) != PGRES_TUPLES_OK)
+	{
+		log_error(_("unable to execute \"SELECT repmgr.repmgrd_pause()\""));
+		log_detail("%s", PQerrorMessage(conn));
+
+		success = false;
+	}
+
+	PQclear(res);
+
+	return success;
+}
+
+pid_t
+get_wal_receiver_pid(PGconn *conn)
+{
+	PGresult   *res = NULL;
+	pid_t		wal_receiver_pid = UNKNOWN_PID;
+
+	res = PQexec(conn, "SELECT repmgr.get_wal_receiver_pid()");
+
+	if (PQresultStatus(res) != PGRES_TUPLES_OK)
+	{
+		log_error(_("unable to execute \"SELECT repmgr.get_wal_receiver_pid()\""));
+		log_detail("%s", PQerrorMessage(conn));
+	}
+	else if (!PQgetisnull(res, 0, 0))
+	{
+		wal_receiver_pid = atoi(PQgetvalue(res, 0, 0));
+	}
+
+	PQclear(res);
+
+	return wal_receiver_pid;
+}
+
+/* ================ */
+/* result functions */
+/* ================ */
+
+bool
+atobool(const char *value)
+{
+	return (strcmp(value, "t") == 0)
+		? true
+		: false;
+}
+
+
+/* =================== */
+/* extension functions */
+/* =================== */
+
+ExtensionStatus
+get_repmgr_extension_status(PGconn *conn, t_extension_versions *extversions)
+{
+	PQExpBufferData query;
+	PGresult   *res = NULL;
+	ExtensionStatus status = REPMGR_UNKNOWN;
+
+	/* TODO: check version */
+
+	initPQExpBuffer(&query);
+
+	appendPQExpBufferStr(&query,
+						 "	  SELECT ae.name, e.extname, "
+						 "           ae.default_version, "
+						 "           (((ae.default_version::NUMERIC::INT) * 10000) + (ae.default_version::NUMERIC - ae.default_version::NUMERIC::INT) * 1000)::INT AS available, "
+						 "           ae.installed_version, "
+						 "           (((ae.installed_version::NUMERIC::INT) * 10000) + (ae.installed_version::NUMERIC - ae.installed_version::NUMERIC::INT) * 1000)::INT AS installed "
+						 "     FROM pg_catalog.pg_available_extensions ae "
+						 "LEFT JOIN pg_catalog.pg_extension e "
+						 "       ON e.extname=ae.name "
+						 "	   WHERE ae.name='repmgr' ");
+
+	res = PQexec(conn, query.data);
+
+	if (PQresultStatus(res) != PGRES_TUPLES_OK)
+	{
+		log_db_error(conn, query.data, _("get_repmgr_extension_status(): unable to execute extension query"));
+		status = REPMGR_UNKNOWN;
+	}
+
+	/* 1. Check extension is actually available */
+	else if (PQntuples(res) == 0)
+	{
+		status = REPMGR_UNAVAILABLE;
+	}
 
 	/* 2. Check if extension installed */
 	else if (PQgetisnull(res, 0, 1) == 0)
@@ -2924,6 +3707,10 @@ _create_update_node_record(PGconn *conn, char *action, t_node_info *node_info)
 
 		success = false;
 	}
+	else
+	{
+		_node_records_changed(conn);
+	}
 
 	termPQExpBuffer(&query);
 	PQclear(res);
@@ -2957,6 +3744,10 @@ update_node_record_set_active(PGconn *conn, int this_node_id, bool active)
 					 _("update_node_record_set_active(): unable to update node record"));
 		success = false;
 	}
+	else
+	{
+		_node_records_changed(conn);
+	}
 
 	termPQExpBuffer(&query);
 	PQclear(res);
@@ -2990,6 +3781,10 @@ update_node_record_set_active_standby(PGconn *conn, int this_node_id)
 		log_db_error(conn, query.data, _("update_node_record_set_active_standby(): unable to update node record"));
 		success = false;
 	}
+	else
+	{
+		_node_records_changed(conn);
+	}
 
 	termPQExpBuffer(&query);
 	PQclear(res);
@@ -3066,6 +3861,8 @@ update_node_record_set_primary(PGconn *conn, int this_node_id)
 	termPQExpBuffer(&query);
 	PQclear(res);
 
+	_node_records_changed(conn);
+
 	return commit_transaction(conn);
 }
 
@@ -3099,6 +3896,10 @@ update_node_record_set_upstream(PGconn *conn, int this_node_id, int new_upstream
 
 		success = false;
 	}
+	else
+	{
+		_node_records_changed(conn);
+	}
 
 	termPQExpBuffer(&query);
 	PQclear(res);
@@ -3143,6 +3944,10 @@ update_node_record_status(PGconn *conn, int this_node_id, char *type, int upstre
 
 		success = false;
 	}
+	else
+	{
+		_node_records_changed(conn);
+	}
 
 	termPQExpBuffer(&query);
 	PQclear(res);
@@ -3180,6 +3985,10 @@ update_node_record_conn_priority(PGconn *conn, t_configuration_options *options)
 		log_db_error(conn, query.data, _("update_node_record_conn_priority(): unable to execute query"));
 		success = false;
 	}
+	else
+	{
+		_node_records_changed(conn);
+	}
 
 	termPQExpBuffer(&query);
 
@@ -3270,6 +4079,10 @@ delete_node_record(PGconn *conn, int node)
 
 		success = false;
 	}
+	else
+	{
+		_node_records_changed(conn);
+	}
 
 	termPQExpBuffer(&query);
 	PQclear(res);
@@ -3291,6 +4104,10 @@ truncate_node_records(PGconn *conn)
 
 		success = false;
 	}
+	else
+	{
+		_node_records_changed(conn);
+	}
 
 	PQclear(res);
 
@@ -3322,6 +4139,10 @@ update_node_record_slot_name(PGconn *primary_conn, int node_id, char *slot_name)
 
 		success = false;
 	}
+	else
+	{
+		_node_records_changed(primary_conn);
+	}
 
 	termPQExpBuffer(&query);
 	PQclear(res);
@@ -3330,6 +4151,80 @@ update_node_record_slot_name(PGconn *primary_conn, int node_id, char *slot_name)
 }
 
 
+/*
+ * Return the node record version counter maintained in shared memory on
+ * the node "conn" is connected to, or -1 if it could not be retrieved
+ * (e.g. the repmgr extension is not loaded via shared_preload_libraries).
+ *
+ * The counter changes whenever node records are modified via this node,
+ * so a caller which has cached the node records from this node need only
+ * reread them when the returned value differs from the one seen when the
+ * records were last read.
+ */
+int64
+get_node_records_version(PGconn *conn)
+{
+	PGresult   *res = NULL;
+	int64		version = -1;
+
+	res = PQexec(conn, "SELECT repmgr.get_node_records_version()");
+
+	if (PQresultStatus(res) != PGRES_TUPLES_OK)
+	{
+		log_verbose(LOG_DEBUG, "get_node_records_version(): unable to execute query:\n  %s",
+					PQerrorMessage(conn));
+	}
+	else if (PQntuples(res) == 1 && PQgetisnull(res, 0, 0) == false)
+	{
+		version = atoll(PQgetvalue(res, 0, 0));
+	}
+
+	PQclear(res);
+
+	return version;
+}
+
+
+/*
+ * Called after node records were successfully modified; if a transaction
+ * is in progress the version bump is deferred until it commits, so
+ * readers never see the new version before the new records.
+ */
+static void
+_node_records_changed(PGconn *conn)
+{
+	if (PQtransactionStatus(conn) == PQTRANS_INTRANS)
+	{
+		node_records_changed_conn = conn;
+		return;
+	}
+
+	_bump_node_records_version(conn);
+}
+
+
+/*
+ * Failure here is not an error as such - the extension may not be loaded
+ * via shared_preload_libraries, or may be an older version - and merely
+ * means cached node records will be refreshed at the next interval.
+ */
+static void
+_bump_node_records_version(PGconn *conn)
+{
+	PGresult   *res = NULL;
+
+	res = PQexec(conn, "SELECT repmgr.bump_node_records_version()");
+
+	if (PQresultStatus(res) != PGRES_TUPLES_OK)
+	{
+		log_verbose(LOG_DEBUG, "_bump_node_records_version(): unable to bump node record version:\n  %s",
+					PQerrorMessage(conn));
+	}
+
+	PQclear(res);
+}
+
+
 
 
 void
@@ -3647,10 +4542,22 @@ _create_event(PGconn *conn, t_configuration_options *options, int node_id, char
 	PQExpBufferData query;
 	PGresult   *res = NULL;
 	char		event_timestamp[MAXLEN] = "";
+	bool		event_recorded = false;
 	bool		success = true;
 
 	log_verbose(LOG_DEBUG, "_create_event(): event is \"%s\" for node %i", event, node_id);
 
+	logger_set_event(event);
+	logger_add_event_field_int("event_node_id", node_id);
+	logger_add_event_field_bool("event_successful", successful);
+
+	if (event_info->node_name != NULL)
+		logger_add_event_field("event_node_name", event_info->node_name);
+
+	/* the upstream or (former) primary node, depending on the event */
+	if (event_info->node_id != UNKNOWN_NODE_ID)
+		logger_add_event_field_int("event_upstream_node_id", event_info->node_id);
+
 	/*
 	 * Only attempt to write a record if a connection handle was provided,
 	 * and the connection handle points to a node which is not in recovery.
@@ -3674,6 +4581,10 @@ _create_event(PGconn *conn, t_configuration_options *options, int node_id, char
 
 		int			binary[4] = {1, 0, 0, 0};
 
+		/* write any spooled events first, so they precede this one */
+		if (event_spool_records > 0)
+			_replay_event_spool(conn);
+
 		initPQExpBuffer(&query);
 		appendPQExpBufferStr(&query,
 							 " INSERT INTO repmgr.events ( "
@@ -3696,7 +4607,6 @@ _create_event(PGconn *conn, t_configuration_options *options, int node_id, char
 						   binary,
 						   0);
 
-
 		if (PQresultStatus(res) != PGRES_TUPLES_OK)
 		{
 			/* we don't treat this as a fatal error */
@@ -3710,12 +4620,17 @@ _create_event(PGconn *conn, t_configuration_options *options, int node_id, char
 		{
 			/* Store timestamp to send to the notification command */
 			snprintf(event_timestamp, MAXLEN, "%s", PQgetvalue(res, 0, 0));
+			event_recorded = true;
 		}
 
 		termPQExpBuffer(&query);
 		PQclear(res);
 	}
 
+	/* keep the event until it can be written to the primary */
+	if (event_recorded == false && event_spool_fd >= 0)
+		_spool_event(node_id, event, successful, details);
+
 	/*
 	 * If no database connection provided, or the query failed, generate a
 	 * current timestamp ourselves. This isn't quite the same format as
@@ -3740,7 +4655,6 @@ _create_event(PGconn *conn, t_configuration_options *options, int node_id, char
 		const char *src_ptr = NULL;
 		char	   *dst_ptr = NULL;
 		char	   *end_ptr = NULL;
-		int			r = 0;
 
 		log_verbose(LOG_DEBUG, "_create_event(): command is '%s'", options->event_notification_command);
 		/*
@@ -3772,6 +4686,7 @@ _create_event(PGconn *conn, t_configuration_options *options, int node_id, char
 			if (notify_ok == false)
 			{
 				log_debug(_("not executing notification script for event type \"%s\""), event);
+				logger_set_event(NULL);
 				return success;
 			}
 		}
@@ -3882,25 +4797,520 @@ _create_event(PGconn *conn, t_configuration_options *options, int node_id, char
 			}
 		}
 
-		*dst_ptr = '\0';
+		*dst_ptr = '\0';
+
+		log_info(_("executing notification command for event \"%s\""),
+				 event);
+
+		log_detail(_("command is:\n  %s"), parsed_command);
+
+		/* in repmgrd, this queues the command for the notification worker */
+		if (event_notification_dispatch(parsed_command,
+										options->event_notification_timeout,
+										options->event_notification_retries) == false)
+		{
+			log_warning(_("unable to execute event notification command"));
+			log_detail(_("parsed event notification command was:\n  %s"), parsed_command);
+			success = false;
+		}
+	}
+
+	logger_set_event(NULL);
+
+	return success;
+}
+
+
+/*
+ * open_event_spool()
+ *
+ * Open (creating if necessary) the file in which events are kept if they
+ * cannot be written to the primary, e.g. during a failover. Any events
+ * left by a previous run are retained for replay.
+ *
+ * Each event is appended as one line in COPY text format, so the file can
+ * be replayed into "repmgr.events" with a single COPY, preserving the
+ * original event timestamps. A partially written final line (e.g. after
+ * a crash) is discarded. Events the primary rejects as malformed are moved
+ * to "<path>.bad", so they cannot prevent later events being written.
+ */
+bool
+open_event_spool(const char *path)
+{
+	struct stat st;
+	char	   *contents = NULL;
+	off_t		valid_len = 0;
+	off_t		i;
+	int			fd;
+	int			records = 0;
+
+	close_event_spool();
+
+	fd = open(path, O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC, S_IRUSR | S_IWUSR);
+
+	if (fd < 0)
+	{
+		log_warning(_("unable to open event spool file \"%s\""), path);
+		log_detail("%s", strerror(errno));
+		return false;
+	}
+
+	if (fstat(fd, &st) != 0)
+	{
+		log_warning(_("unable to stat event spool file \"%s\""), path);
+		log_detail("%s", strerror(errno));
+		close(fd);
+		return false;
+	}
+
+	if (st.st_size > 0)
+	{
+		contents = pg_malloc(st.st_size);
+
+		if (pread(fd, contents, st.st_size, 0) != st.st_size)
+		{
+			log_warning(_("unable to read event spool file \"%s\""), path);
+			log_detail("%s", strerror(errno));
+			pfree(contents);
+			close(fd);
+			return false;
+		}
+
+		for (i = 0; i < st.st_size; i++)
+		{
+			if (contents[i] == '\n')
+			{
+				records++;
+				valid_len = i + 1;
+			}
+		}
+
+		pfree(contents);
+
+		if (valid_len < st.st_size)
+		{
+			log_warning(_("discarding incomplete record at end of event spool file \"%s\""), path);
+
+			if (ftruncate(fd, valid_len) != 0 || fsync(fd) != 0)
+			{
+				log_warning(_("unable to truncate event spool file \"%s\""), path);
+				log_detail("%s", strerror(errno));
+				close(fd);
+				return false;
+			}
+		}
+	}
+
+	event_spool_fd = fd;
+	strncpy(event_spool_path, path, MAXPGPATH - 1);
+	event_spool_records = records;
+	event_spool_unsynced = 0;
+	event_spool_last_sync = time(NULL);
+
+	if (records > 0)
+		log_notice(_("%i event(s) in event spool file \"%s\" waiting to be written to the primary"),
+				   records, path);
+
+	return true;
+}
+
+
+void
+close_event_spool(void)
+{
+	if (event_spool_fd < 0)
+		return;
+
+	_sync_event_spool(true);
+
+	close(event_spool_fd);
+	event_spool_fd = -1;
+	event_spool_records = 0;
+}
+
+
+/*
+ * replay_event_spool()
+ *
+ * Write any spooled events to "repmgr.events" if "conn" is a usable
+ * connection to the primary. Called in each monitoring cycle, so also
+ * ensures recently spooled events are synced to disk.
+ *
+ * Returns false if spooled events remain.
+ */
+bool
+replay_event_spool(PGconn *conn)
+{
+	if (event_spool_fd < 0)
+		return true;
+
+	_sync_event_spool(false);
+
+	if (event_spool_records == 0)
+		return true;
+
+	if (conn == NULL || PQstatus(conn) != CONNECTION_OK)
+		return false;
+
+	if (get_recovery_type(conn) != RECTYPE_PRIMARY)
+		return false;
+
+	return _replay_event_spool(conn);
+}
+
+
+static bool
+_spool_event(int node_id, const char *event, bool successful, const char *details)
+{
+	PQExpBufferData record;
+	struct timeval tv;
+	struct tm	ts;
+	char		timestamp[MAXLEN] = "";
+	char		tz_offset[16] = "";
+	ssize_t		written;
+
+	/* microsecond precision keeps events in order when sorted by timestamp */
+	gettimeofday(&tv, NULL);
+	ts = *localtime(&tv.tv_sec);
+	strftime(timestamp, sizeof(timestamp), "%Y-%m-%d %H:%M:%S", &ts);
+	strftime(tz_offset, sizeof(tz_offset), "%z", &ts);
+
+	initPQExpBuffer(&record);
+
+	appendPQExpBuffer(&record, "%i\t", node_id);
+	_append_copy_text(&record, event);
+	appendPQExpBuffer(&record, "\t%s\t%s.%06li%s\t",
+					  successful ? "t" : "f",
+					  timestamp,
+					  (long) tv.tv_usec,
+					  tz_offset);
+
+	if (details == NULL)
+		appendPQExpBufferStr(&record, "\\N");
+	else
+		_append_copy_text(&record, details);
+
+	appendPQExpBufferChar(&record, '\n');
+
+	/* a single write, so an interrupted append leaves at most one partial line */
+	written = write(event_spool_fd, record.data, record.len);
+
+	if (written != (ssize_t) record.len)
+	{
+		log_warning(_("unable to write event \"%s\" to event spool file"), event);
+
+		if (written < 0)
+			log_detail("%s", strerror(errno));
+
+		termPQExpBuffer(&record);
+		return false;
+	}
+
+	termPQExpBuffer(&record);
+
+	log_info(_("event \"%s\" spooled until the primary is available"), event);
+
+	event_spool_records++;
+	event_spool_unsynced++;
+
+	_sync_event_spool(false);
+
+	return true;
+}
+
+
+/*
+ * Append a string escaped for COPY text format.
+ */
+static void
+_append_copy_text(PQExpBufferData *buf, const char *str)
+{
+	const char *ptr;
+
+	for (ptr = str; *ptr; ptr++)
+	{
+		switch (*ptr)
+		{
+			case '\\':
+				appendPQExpBufferStr(buf, "\\\\");
+				break;
+			case '\n':
+				appendPQExpBufferStr(buf, "\\n");
+				break;
+			case '\r':
+				appendPQExpBufferStr(buf, "\\r");
+				break;
+			case '\t':
+				appendPQExpBufferStr(buf, "\\t");
+				break;
+			default:
+				appendPQExpBufferChar(buf, *ptr);
+		}
+	}
+}
+
+
+/*
+ * Sync spooled events to disk; unless "force" is set, this is only done
+ * once EVENT_SPOOL_SYNC_BATCH events are waiting, or EVENT_SPOOL_SYNC_INTERVAL
+ * seconds have passed since the last sync, so a burst of events during a
+ * failover costs a single fsync.
+ */
+static void
+_sync_event_spool(bool force)
+{
+	time_t		now;
+
+	if (event_spool_fd < 0 || event_spool_unsynced == 0)
+		return;
+
+	now = time(NULL);
+
+	if (force == false &&
+		event_spool_unsynced < EVENT_SPOOL_SYNC_BATCH &&
+		now - event_spool_last_sync < EVENT_SPOOL_SYNC_INTERVAL)
+		return;
+
+	if (fsync(event_spool_fd) != 0)
+	{
+		log_warning(_("unable to sync event spool file"));
+		log_detail("%s", strerror(errno));
+		return;
+	}
+
+	event_spool_unsynced = 0;
+	event_spool_last_sync = now;
+}
+
+
+static bool
+_replay_event_spool(PGconn *conn)
+{
+	struct stat st;
+	char	   *contents = NULL;
+	char		sqlstate[6] = "";
+	int			records = event_spool_records;
+
+	if (fstat(event_spool_fd, &st) != 0)
+	{
+		log_warning(_("unable to stat event spool file"));
+		log_detail("%s", strerror(errno));
+		return false;
+	}
+
+	if (st.st_size == 0)
+	{
+		event_spool_records = 0;
+		return true;
+	}
+
+	contents = pg_malloc(st.st_size);
+
+	if (pread(event_spool_fd, contents, st.st_size, 0) != st.st_size)
+	{
+		log_warning(_("unable to read event spool file"));
+		log_detail("%s", strerror(errno));
+		pfree(contents);
+		return false;
+	}
+
+	if (_copy_event_records(conn, contents, st.st_size, sqlstate) == false)
+	{
+		bool		success = false;
+
+		log_db_error(conn, NULL, _("unable to write spooled events to the primary"));
+
+		/*
+		 * If the server rejected the data itself, find out which records are
+		 * at fault; otherwise just try again later.
+		 */
+		if (PQstatus(conn) == CONNECTION_OK &&
+			(strncmp(sqlstate, "22", 2) == 0 || strncmp(sqlstate, "23", 2) == 0))
+			success = _replay_event_spool_by_record(conn, contents, st.st_size);
+
+		pfree(contents);
+		return success;
+	}
+
+	pfree(contents);
+
+	if (_rewrite_event_spool(NULL, 0) == false)
+		return false;
+
+	log_notice(_("%i spooled event(s) written to the primary"), records);
+
+	return true;
+}
+
+
+/*
+ * Write spooled events to the primary one at a time, after the primary
+ * rejected them as a whole. Records rejected as malformed are appended
+ * to "<spool file>.bad" rather than being retried indefinitely.
+ */
+static bool
+_replay_event_spool_by_record(PGconn *conn, const char *contents, size_t len)
+{
+	const char *record = contents;
+	const char *end = contents + len;
+	PQExpBufferData bad_path;
+	int			bad_fd = -1;
+	int			written = 0;
+	int			rejected = 0;
+	bool		success = true;
+
+	initPQExpBuffer(&bad_path);
+	appendPQExpBuffer(&bad_path, "%s.bad", event_spool_path);
+
+	while (record < end)
+	{
+		const char *eol = memchr(record, '\n', end - record);
+		size_t		record_len = eol == NULL ? (size_t) (end - record) : (size_t) (eol - record + 1);
+		char		sqlstate[6] = "";
+
+		if (_copy_event_records(conn, record, record_len, sqlstate) == true)
+		{
+			written++;
+			record += record_len;
+			continue;
+		}
+
+		if (PQstatus(conn) != CONNECTION_OK ||
+			(strncmp(sqlstate, "22", 2) != 0 && strncmp(sqlstate, "23", 2) != 0))
+		{
+			success = false;
+			break;
+		}
+
+		if (bad_fd < 0)
+		{
+			bad_fd = open(bad_path.data, O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, S_IRUSR | S_IWUSR);
 
-		log_info(_("executing notification command for event \"%s\""),
-				 event);
+			if (bad_fd < 0)
+			{
+				log_warning(_("unable to open file \"%s\""), bad_path.data);
+				log_detail("%s", strerror(errno));
+				success = false;
+				break;
+			}
+		}
 
-		log_detail(_("command is:\n  %s"), parsed_command);
-		r = system(parsed_command);
-		if (r != 0)
+		if (write(bad_fd, record, record_len) != (ssize_t) record_len || fsync(bad_fd) != 0)
 		{
-			log_warning(_("unable to execute event notification command"));
-			log_detail(_("parsed event notification command was:\n  %s"), parsed_command);
+			log_warning(_("unable to write to file \"%s\""), bad_path.data);
+			log_detail("%s", strerror(errno));
 			success = false;
+			break;
 		}
+
+		log_warning(_("spooled event rejected by the primary, moved to \"%s\""), bad_path.data);
+		log_detail("%s", PQerrorMessage(conn));
+
+		rejected++;
+		record += record_len;
+	}
+
+	if (bad_fd >= 0)
+		close(bad_fd);
+
+	termPQExpBuffer(&bad_path);
+
+	/* keep only the records which have not been dealt with */
+	if (written > 0 || rejected > 0)
+	{
+		if (_rewrite_event_spool(record, end - record) == false)
+			return false;
+
+		log_notice(_("%i spooled event(s) written to the primary, %i rejected"), written, rejected);
+	}
+
+	return success;
+}
+
+
+/*
+ * Write events in COPY text format to "repmgr.events". On failure,
+ * "sqlstate" (which must have space for 6 characters) is set to the
+ * SQLSTATE reported by the server, if any.
+ */
+static bool
+_copy_event_records(PGconn *conn, const char *data, size_t len, char *sqlstate)
+{
+	PGresult   *res = NULL;
+	bool		success = true;
+
+	res = PQexec(conn,
+				 "COPY repmgr.events (node_id, event, successful, event_timestamp, details) "
+				 "     FROM STDIN");
+
+	if (PQresultStatus(res) != PGRES_COPY_IN)
+	{
+		PQclear(res);
+		return false;
+	}
+
+	PQclear(res);
+
+	if (PQputCopyData(conn, data, len) != 1)
+		PQputCopyEnd(conn, "unable to send spooled events");
+	else
+		PQputCopyEnd(conn, NULL);
+
+	res = PQgetResult(conn);
+
+	if (PQresultStatus(res) != PGRES_COMMAND_OK)
+	{
+		const char *state = PQresultErrorField(res, PG_DIAG_SQLSTATE);
+
+		if (state != NULL)
+			strncpy(sqlstate, state, 5);
+
+		success = false;
 	}
 
+	PQclear(res);
+
+	while ((res = PQgetResult(conn)) != NULL)
+		PQclear(res);
+
 	return success;
 }
 
 
+/*
+ * Replace the contents of the event spool file with "data", which
+ * consists of complete records.
+ */
+static bool
+_rewrite_event_spool(const char *data, size_t len)
+{
+	int			records = 0;
+	size_t		i;
+
+	if (ftruncate(event_spool_fd, 0) != 0 ||
+		(len > 0 && write(event_spool_fd, data, len) != (ssize_t) len) ||
+		fsync(event_spool_fd) != 0)
+	{
+		/* the events would be written again at the next replay */
+		log_warning(_("unable to rewrite event spool file"));
+		log_detail("%s", strerror(errno));
+		close_event_spool();
+		return false;
+	}
+
+	for (i = 0; i < len; i++)
+	{
+		if (data[i] == '\n')
+			records++;
+	}
+
+	event_spool_records = records;
+	event_spool_unsynced = 0;
+
+	return true;
+}
+
+
 PGresult *
 get_event_records(PGconn *conn, int node_id, const char *node_name, const char *event, bool all, int limit)
 {
@@ -4507,88 +5917,176 @@ connection_ping_reconnect(PGconn *conn)
 /* monitoring functions */
 /* ==================== */
 
-void
-add_monitoring_record(PGconn *primary_conn,
-					  PGconn *local_conn,
-					  int primary_node_id,
-					  int local_node_id,
-					  char *monitor_standby_timestamp,
-					  XLogRecPtr primary_last_wal_location,
-					  XLogRecPtr last_wal_receive_lsn,
-					  char *last_xact_replay_timestamp,
-					  long long unsigned int replication_lag_bytes,
-					  long long unsigned int apply_lag_bytes
-)
+/*
+ * Write a batch of buffered monitoring samples to the primary as a single
+ * multi-row INSERT. Node IDs and lag values are sent in binary format; the
+ * timestamps and LSNs as text, as the LSN columns are TEXT on 9.3.
+ *
+ * Returns true only if the INSERT succeeded; otherwise the caller should
+ * retain the samples and retry later. The result is always read here, as
+ * it would otherwise be silently discarded by the next query executed on
+ * the connection.
+ */
+bool
+add_monitoring_records(PGconn *primary_conn, t_monitoring_record *records, int record_count)
 {
 	PQExpBufferData query;
+	PGresult   *res = NULL;
+	int			param_count = record_count * MONITORING_RECORD_PARAMS;
+	const char **values = NULL;
+	int		   *lengths = NULL;
+	int		   *binary = NULL;
+	uint32	   *node_ids = NULL;
+	uint32	   *lags = NULL;
+	char	   (*lsns)[MONITORING_LSN_LEN] = NULL;
+	bool		success = true;
+	int			i;
+
+	if (record_count == 0)
+		return true;
+
+	values = (const char **) pg_malloc0(sizeof(char *) * param_count);
+	lengths = (int *) pg_malloc0(sizeof(int) * param_count);
+	binary = (int *) pg_malloc0(sizeof(int) * param_count);
+	node_ids = (uint32 *) pg_malloc0(sizeof(uint32) * record_count * 2);
+	lags = (uint32 *) pg_malloc0(sizeof(uint32) * record_count * 4);
+	lsns = pg_malloc0(MONITORING_LSN_LEN * record_count * 2);
 
 	initPQExpBuffer(&query);
 
-	appendPQExpBuffer(&query,
-					  "INSERT INTO repmgr.monitoring_history "
-					  "           (primary_node_id, "
-					  "            standby_node_id, "
-					  "            last_monitor_time, "
-					  "            last_apply_time, "
-					  "            last_wal_primary_location, "
-					  "            last_wal_standby_location, "
-					  "            replication_lag, "
-					  "            apply_lag ) "
-					  "     VALUES(%i, "
-					  "            %i, "
-					  "            '%s'::TIMESTAMP WITH TIME ZONE, "
-					  "            '%s'::TIMESTAMP WITH TIME ZONE, "
-					  "            '%X/%X', "
-					  "            '%X/%X', "
-					  "            %llu, "
-					  "            %llu) ",
-					  primary_node_id,
-					  local_node_id,
-					  monitor_standby_timestamp,
-					  last_xact_replay_timestamp,
-					  format_lsn(primary_last_wal_location),
-					  format_lsn(last_wal_receive_lsn),
-					  replication_lag_bytes,
-					  apply_lag_bytes);
-
-	log_verbose(LOG_DEBUG, "standby_monitor:()\n%s", query.data);
-
-	if (PQsendQuery(primary_conn, query.data) == 0)
-	{
-		log_warning(_("query could not be sent to primary:\n  %s"),
-					PQerrorMessage(primary_conn));
-	}
-	else
+	appendPQExpBufferStr(&query,
+						 "INSERT INTO repmgr.monitoring_history "
+						 "           (primary_node_id, "
+						 "            standby_node_id, "
+						 "            last_monitor_time, "
+						 "            last_apply_time, "
+						 "            last_wal_primary_location, "
+						 "            last_wal_standby_location, "
+						 "            replication_lag, "
+						 "            apply_lag ) "
+						 "     VALUES ");
+
+	for (i = 0; i < record_count; i++)
 	{
-		PGresult   *res = PQexec(local_conn, "SELECT repmgr.standby_set_last_updated()");
+		t_monitoring_record *record = &records[i];
+		int			p = i * MONITORING_RECORD_PARAMS;
 
-		/* not critical if the above query fails */
-		if (PQresultStatus(res) != PGRES_TUPLES_OK)
-			log_warning(_("add_monitoring_record(): unable to set last_updated:\n  %s"),
-						PQerrorMessage(local_conn));
+		if (i > 0)
+			appendPQExpBufferStr(&query, ", ");
 
-		PQclear(res);
+		appendPQExpBuffer(&query,
+						  "($%i, $%i, $%i, $%i, $%i, $%i, $%i, $%i)",
+						  p + 1, p + 2, p + 3, p + 4,
+						  p + 5, p + 6, p + 7, p + 8);
+
+		node_ids[i * 2] = htonl((uint32) record->primary_node_id);
+		node_ids[i * 2 + 1] = htonl((uint32) record->standby_node_id);
+
+		/* int8 in network byte order */
+		lags[i * 4] = htonl((uint32) (record->replication_lag_bytes >> 32));
+		lags[i * 4 + 1] = htonl((uint32) record->replication_lag_bytes);
+		lags[i * 4 + 2] = htonl((uint32) (record->apply_lag_bytes >> 32));
+		lags[i * 4 + 3] = htonl((uint32) record->apply_lag_bytes);
+
+		snprintf(lsns[i * 2], MONITORING_LSN_LEN, "%X/%X",
+				 format_lsn(record->primary_last_wal_location));
+		snprintf(lsns[i * 2 + 1], MONITORING_LSN_LEN, "%X/%X",
+				 format_lsn(record->last_wal_receive_lsn));
+
+		values[p] = (char *) &node_ids[i * 2];
+		lengths[p] = sizeof(uint32);
+		binary[p] = 1;
+
+		values[p + 1] = (char *) &node_ids[i * 2 + 1];
+		lengths[p + 1] = sizeof(uint32);
+		binary[p + 1] = 1;
+
+		values[p + 2] = record->monitor_standby_timestamp;
+
+		/* no transaction has been replayed yet */
+		values[p + 3] = record->last_xact_replay_timestamp[0] == '\0'
+			? NULL
+			: record->last_xact_replay_timestamp;
+
+		values[p + 4] = lsns[i * 2];
+		values[p + 5] = lsns[i * 2 + 1];
+
+		values[p + 6] = (char *) &lags[i * 4];
+		lengths[p + 6] = sizeof(uint32) * 2;
+		binary[p + 6] = 1;
+
+		values[p + 7] = (char *) &lags[i * 4 + 2];
+		lengths[p + 7] = sizeof(uint32) * 2;
+		binary[p + 7] = 1;
+	}
+
+	log_verbose(LOG_DEBUG, "add_monitoring_records(): writing %i record(s)", record_count);
+
+	res = PQexecParams(primary_conn,
+					   query.data,
+					   param_count,
+					   NULL,
+					   values,
+					   lengths,
+					   binary,
+					   0);
+
+	if (PQresultStatus(res) != PGRES_COMMAND_OK)
+	{
+		log_warning(_("unable to write monitoring history to primary:\n  %s"),
+					PQerrorMessage(primary_conn));
+		success = false;
 	}
 
+	PQclear(res);
 	termPQExpBuffer(&query);
 
-	return;
+	pfree(values);
+	pfree(lengths);
+	pfree(binary);
+	pfree(node_ids);
+	pfree(lags);
+	pfree(lsns);
+
+	return success;
 }
 
 
-int
-get_number_of_monitoring_records_to_delete(PGconn *primary_conn, int keep_history, int node_id)
+/*
+ * Record the time of the most recent monitoring cycle on the local standby
+ */
+void
+set_standby_last_updated(PGconn *local_conn)
+{
+	PGresult   *res = PQexec(local_conn, "SELECT repmgr.standby_set_last_updated()");
+
+	/* not critical if the above query fails */
+	if (PQresultStatus(res) != PGRES_TUPLES_OK)
+		log_warning(_("set_standby_last_updated(): unable to set last_updated:\n  %s"),
+					PQerrorMessage(local_conn));
+
+	PQclear(res);
+}
+
+
+/*
+ * Determine whether any monitoring records are due to be deleted; this
+ * stops at the first matching row, rather than counting all of them.
+ */
+RecordStatus
+get_monitoring_records_to_delete(PGconn *primary_conn, int keep_history, int node_id)
 {
 	PQExpBufferData query;
-	int				record_count = -1;
+	RecordStatus	record_status = RECORD_ERROR;
 	PGresult	   *res = NULL;
 
 	initPQExpBuffer(&query);
 
 	appendPQExpBuffer(&query,
-					  "SELECT pg_catalog.count(*) "
-					  "  FROM repmgr.monitoring_history "
-					  " WHERE pg_catalog.age(pg_catalog.now(), last_monitor_time) >= '%d days'::interval",
+					  "SELECT EXISTS ( "
+					  "  SELECT 1 "
+					  "    FROM repmgr.monitoring_history "
+					  "   WHERE last_monitor_time <= pg_catalog.now() - '%d days'::interval",
 					  keep_history);
 
 	if (node_id != UNKNOWN_NODE_ID)
@@ -4597,41 +6095,56 @@ get_number_of_monitoring_records_to_delete(PGconn *primary_conn, int keep_histor
 						  "  AND standby_node_id = %i", node_id);
 	}
 
-	log_verbose(LOG_DEBUG, "get_number_of_monitoring_records_to_delete():\n  %s", query.data);
+	appendPQExpBufferStr(&query, ")");
+
+	log_verbose(LOG_DEBUG, "get_monitoring_records_to_delete():\n  %s", query.data);
 
 	res = PQexec(primary_conn, query.data);
 
 	if (PQresultStatus(res) != PGRES_TUPLES_OK)
 	{
 		log_db_error(primary_conn, query.data,
-					 _("get_number_of_monitoring_records_to_delete(): unable to query number of monitoring records to clean up"));
+					 _("get_monitoring_records_to_delete(): unable to query monitoring records to clean up"));
 	}
 	else
 	{
-		record_count = atoi(PQgetvalue(res, 0, 0));
+		record_status = atobool(PQgetvalue(res, 0, 0)) ? RECORD_FOUND : RECORD_NOT_FOUND;
 	}
 
 	termPQExpBuffer(&query);
 	PQclear(res);
 
-	return record_count;
+	return record_status;
 }
 
 
+/*
+ * If "partitioned" is true, monitoring history older than "keep_history"
+ * days is removed by dropping the daily partitions which contain it;
+ * this is not possible when only one node's records are to be deleted.
+ */
 bool
-delete_monitoring_records(PGconn *primary_conn, int keep_history, int node_id)
+delete_monitoring_records(PGconn *primary_conn, int keep_history, int node_id, bool partitioned)
 {
 	PQExpBufferData query;
 	bool			success = true;
 	PGresult	   *res = NULL;
+	ExecStatusType	expected_status = PGRES_COMMAND_OK;
 
 	initPQExpBuffer(&query);
 
-	if (keep_history > 0 || node_id != UNKNOWN_NODE_ID)
+	if (keep_history > 0 && node_id == UNKNOWN_NODE_ID && partitioned == true)
+	{
+		appendPQExpBuffer(&query,
+						  "SELECT repmgr.monitoring_history_drop_partitions(%i)",
+						  keep_history);
+		expected_status = PGRES_TUPLES_OK;
+	}
+	else if (keep_history > 0 || node_id != UNKNOWN_NODE_ID)
 	{
 		appendPQExpBuffer(&query,
 						  "DELETE FROM repmgr.monitoring_history "
-						  " WHERE pg_catalog.age(pg_catalog.now(), last_monitor_time) >= '%d days'::INTERVAL ",
+						  " WHERE last_monitor_time <= pg_catalog.now() - '%d days'::INTERVAL ",
 						  keep_history);
 
 		if (node_id != UNKNOWN_NODE_ID)
@@ -4646,14 +6159,21 @@ delete_monitoring_records(PGconn *primary_conn, int keep_history, int node_id)
 							 "TRUNCATE TABLE repmgr.monitoring_history");
 	}
 
+	log_verbose(LOG_DEBUG, "delete_monitoring_records():\n  %s", query.data);
+
 	res = PQexec(primary_conn, query.data);
 
-	if (PQresultStatus(res) != PGRES_COMMAND_OK)
+	if (PQresultStatus(res) != expected_status)
 	{
 		log_db_error(primary_conn, query.data,
 					 _("delete_monitoring_records(): unable to delete monitoring records"));
 		success = false;
 	}
+	else if (expected_status == PGRES_TUPLES_OK)
+	{
+		log_verbose(LOG_INFO, _("%s monitoring history partition(s) dropped"),
+					PQgetvalue(res, 0, 0));
+	}
 
 	termPQExpBuffer(&query);
 	PQclear(res);
@@ -4661,6 +6181,80 @@ delete_monitoring_records(PGconn *primary_conn, int keep_history, int node_id)
 	return success;
 }
 
+
+/*
+ * Indicate whether repmgr.monitoring_history is a partitioned table
+ * (PostgreSQL 11 and later)
+ */
+bool
+is_monitoring_history_partitioned(PGconn *conn)
+{
+	PGresult   *res = NULL;
+	bool		partitioned = false;
+	const char *query =
+		"SELECT EXISTS ( "
+		"  SELECT 1 "
+		"    FROM pg_catalog.pg_class c "
+		"    JOIN pg_catalog.pg_namespace n ON n.oid = c.relnamespace "
+		"   WHERE n.nspname = 'repmgr' "
+		"     AND c.relname = 'monitoring_history' "
+		"     AND c.relkind = 'p') ";
+
+	res = PQexec(conn, query);
+
+	if (PQresultStatus(res) != PGRES_TUPLES_OK)
+	{
+		log_db_error(conn, query, _("is_monitoring_history_partitioned(): unable to query table type"));
+	}
+	else
+	{
+		partitioned = atobool(PQgetvalue(res, 0, 0));
+	}
+
+	PQclear(res);
+
+	return partitioned;
+}
+
+
+/*
+ * Create daily monitoring history partitions for today and the following
+ * "days_ahead" days, where not already present. Returns the number of
+ * partitions created, or -1 on error.
+ */
+int
+create_monitoring_history_partitions(PGconn *conn, int days_ahead)
+{
+	PQExpBufferData query;
+	PGresult   *res = NULL;
+	int			partitions_created = -1;
+
+	initPQExpBuffer(&query);
+
+	appendPQExpBuffer(&query,
+					  "SELECT repmgr.monitoring_history_create_partitions(%i)",
+					  days_ahead);
+
+	log_verbose(LOG_DEBUG, "create_monitoring_history_partitions():\n  %s", query.data);
+
+	res = PQexec(conn, query.data);
+
+	if (PQresultStatus(res) != PGRES_TUPLES_OK)
+	{
+		log_db_error(conn, query.data,
+					 _("create_monitoring_history_partitions(): unable to create monitoring history partitions"));
+	}
+	else
+	{
+		partitions_created = atoi(PQgetvalue(res, 0, 0));
+	}
+
+	termPQExpBuffer(&query);
+	PQclear(res);
+
+	return partitions_created;
+}
+
 /*
  * node voting functions
  *
@@ -5035,15 +6629,10 @@ init_replication_info(ReplInfo *replication_info)
 }
 
 
-bool
-get_replication_info(PGconn *conn, t_server_type node_type, ReplInfo *replication_info)
+static void
+_build_replication_info_query(PGconn *conn, t_server_type node_type, PQExpBufferData *query)
 {
-	PQExpBufferData query;
-	PGresult   *res = NULL;
-	bool		success = true;
-
-	initPQExpBuffer(&query);
-	appendPQExpBufferStr(&query,
+	appendPQExpBufferStr(query,
 						 " SELECT ts, "
 						 "        in_recovery, "
 						 "        last_wal_receive_lsn, "
@@ -5069,7 +6658,7 @@ get_replication_info(PGconn *conn, t_server_type node_type, ReplInfo *replicatio
 
 	if (PQserverVersion(conn) >= 100000)
 	{
-		appendPQExpBufferStr(&query,
+		appendPQExpBufferStr(query,
 							 "        COALESCE(pg_catalog.pg_last_wal_receive_lsn(), '0/0'::PG_LSN) AS last_wal_receive_lsn, "
 							 "        COALESCE(pg_catalog.pg_last_wal_replay_lsn(),  '0/0'::PG_LSN) AS last_wal_replay_lsn, "
 							 "        CASE WHEN pg_catalog.pg_is_in_recovery() IS FALSE "
@@ -5081,19 +6670,19 @@ get_replication_info(PGconn *conn, t_server_type node_type, ReplInfo *replicatio
 	{
 		if (PQserverVersion(conn) >= 90400)
 		{
-			appendPQExpBufferStr(&query,
+			appendPQExpBufferStr(query,
 								 "        COALESCE(pg_catalog.pg_last_xlog_receive_location(), '0/0'::PG_LSN) AS last_wal_receive_lsn, "
 								 "        COALESCE(pg_catalog.pg_last_xlog_replay_location(),  '0/0'::PG_LSN) AS last_wal_replay_lsn, ");
 		}
 		else
 		{
 			/* 9.3 does not have "pg_lsn" datatype */
-			appendPQExpBufferStr(&query,
+			appendPQExpBufferStr(query,
 								 "        COALESCE(pg_catalog.pg_last_xlog_receive_location(), '0/0') AS last_wal_receive_lsn, "
 								 "        COALESCE(pg_catalog.pg_last_xlog_replay_location(),  '0/0') AS last_wal_replay_lsn, ");
 		}
 
-		appendPQExpBufferStr(&query,
+		appendPQExpBufferStr(query,
 							 "        CASE WHEN pg_catalog.pg_is_in_recovery() IS FALSE "
 							 "          THEN FALSE "
 							 "          ELSE pg_catalog.pg_is_xlog_replay_paused() "
@@ -5102,20 +6691,51 @@ get_replication_info(PGconn *conn, t_server_type node_type, ReplInfo *replicatio
 
 	if (node_type == WITNESS)
 	{
-		appendPQExpBufferStr(&query,
+		appendPQExpBufferStr(query,
 							 "        repmgr.get_upstream_last_seen() AS upstream_last_seen");
 	}
 	else
 	{
-		appendPQExpBufferStr(&query,
+		appendPQExpBufferStr(query,
 							 "        CASE WHEN pg_catalog.pg_is_in_recovery() IS FALSE "
 							 "          THEN -1 "
 							 "          ELSE repmgr.get_upstream_last_seen() "
 							 "        END AS upstream_last_seen ");
 	}
 
-	appendPQExpBufferStr(&query,
+	appendPQExpBufferStr(query,
 						 "          ) q ");
+}
+
+
+static void
+_populate_replication_info(PGresult *res, ReplInfo *replication_info)
+{
+	snprintf(replication_info->current_timestamp,
+			 sizeof(replication_info->current_timestamp),
+			 "%s", PQgetvalue(res, 0, 0));
+	replication_info->in_recovery = atobool(PQgetvalue(res, 0, 1));
+	replication_info->last_wal_receive_lsn = parse_lsn(PQgetvalue(res, 0, 2));
+	replication_info->last_wal_replay_lsn = parse_lsn(PQgetvalue(res, 0, 3));
+	snprintf(replication_info->last_xact_replay_timestamp,
+			 sizeof(replication_info->last_xact_replay_timestamp),
+			 "%s", PQgetvalue(res, 0, 4));
+	replication_info->replication_lag_time = atoi(PQgetvalue(res, 0, 5));
+	replication_info->receiving_streamed_wal = atobool(PQgetvalue(res, 0, 6));
+	replication_info->wal_replay_paused = atobool(PQgetvalue(res, 0, 7));
+	replication_info->upstream_last_seen = atoi(PQgetvalue(res, 0, 8));
+}
+
+
+bool
+get_replication_info(PGconn *conn, t_server_type node_type, ReplInfo *replication_info)
+{
+	PQExpBufferData query;
+	PGresult   *res = NULL;
+	bool		success = true;
+
+	initPQExpBuffer(&query);
+	_build_replication_info_query(conn, node_type, &query);
 
 	log_verbose(LOG_DEBUG, "get_replication_info():\n%s", query.data);
 
@@ -5129,19 +6749,7 @@ get_replication_info(PGconn *conn, t_server_type node_type, ReplInfo *replicatio
 	}
 	else
 	{
-		snprintf(replication_info->current_timestamp,
-				 sizeof(replication_info->current_timestamp),
-				 "%s", PQgetvalue(res, 0, 0));
-		replication_info->in_recovery = atobool(PQgetvalue(res, 0, 1));
-		replication_info->last_wal_receive_lsn = parse_lsn(PQgetvalue(res, 0, 2));
-		replication_info->last_wal_replay_lsn = parse_lsn(PQgetvalue(res, 0, 3));
-		snprintf(replication_info->last_xact_replay_timestamp,
-				 sizeof(replication_info->last_xact_replay_timestamp),
-				 "%s", PQgetvalue(res, 0, 4));
-		replication_info->replication_lag_time = atoi(PQgetvalue(res, 0, 5));
-		replication_info->receiving_streamed_wal = atobool(PQgetvalue(res, 0, 6));
-		replication_info->wal_replay_paused = atobool(PQgetvalue(res, 0, 7));
-		replication_info->upstream_last_seen = atoi(PQgetvalue(res, 0, 8));
+		_populate_replication_info(res, replication_info);
 	}
 
 	termPQExpBuffer(&query);
@@ -5348,6 +6956,24 @@ set_upstream_last_seen(PGconn *conn)
 }
 
 
+/*
+ * Add the local standby's current replication state to the ring buffer
+ * held in shared memory; this generates no writes or WAL.
+ */
+void
+record_replication_sample(PGconn *conn)
+{
+	PGresult   *res = PQexec(conn, "SELECT repmgr.record_replication_sample()");
+
+	if (PQresultStatus(res) != PGRES_TUPLES_OK)
+	{
+		log_db_error(conn, NULL, _("unable to execute repmgr.record_replication_sample()"));
+	}
+
+	PQclear(res);
+}
+
+
 int
 get_upstream_last_seen(PGconn *conn, t_server_type node_type)
 {
@@ -6397,6 +8023,16 @@ get_virtual_ip(PGconn *conn, int primary_id, char *virtual_ip)
  */
 bool
 get_network_card(PGconn *conn, int primary_id, char *network_card)
+{
+    return get_network_card_record(conn, primary_id, network_card) == RECORD_FOUND;
+}
+
+/*
+ * As get_network_card(), but distinguishes between a node which has no
+ * network card configured (RECORD_NOT_FOUND) and a failed query (RECORD_ERROR).
+ */
+RecordStatus
+get_network_card_record(PGconn *conn, int primary_id, char *network_card)
 {
     PQExpBufferData query;
     PGresult   *res = NULL;
@@ -6413,23 +8049,25 @@ get_network_card(PGconn *conn, int primary_id, char *network_card)
     if (PQresultStatus(res) != PGRES_TUPLES_OK)
     {
         log_error(_("unable to get network card"));
+        log_detail("%s", PQerrorMessage(conn));
         PQclear(res);
-        return false;
+        return RECORD_ERROR;
     }
 
     if (PQntuples(res) == 0)
     {
         PQclear(res);
-        return false;
+        return RECORD_NOT_FOUND;
     }
 
     strncpy(network_card, PQgetvalue(res, 0, 0), MAXLEN);
 
+    PQclear(res);
+
     if(strlen(network_card) == 0)
-        return false;
+        return RECORD_NOT_FOUND;
 
-    PQclear(res);
-    return true;
+    return RECORD_FOUND;
 }
 
 /*
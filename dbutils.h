@@ -29,6 +29,7 @@
 #include "configfile.h"
 #include "strutil.h"
 #include "voting.h"
+#include "storagelatency.h"
 
 #define REPMGR_NODES_COLUMNS "n.node_id, n.type, n.upstream_node_id, n.node_name, n.conninfo, n.repluser, n.slot_name, n.location, n.priority, n.active, n.config_file, '' AS upstream_node_name "
 #define BDR2_NODES_COLUMNS "node_sysid, node_timeline, node_dboid, node_name, node_local_dsn, ''"
@@ -210,12 +211,47 @@ typedef struct
 	int			upstream_last_seen;
 } ReplInfo;
 
+/* monitoring sample buffered by repmgrd for writing to repmgr.monitoring_history */
+#define MONITORING_RECORD_PARAMS 8
+#define MONITORING_TIMESTAMP_LEN 64
+#define MONITORING_LSN_LEN 18	/* "XXXXXXXX/XXXXXXXX" */
+
+typedef struct
+{
+	int			primary_node_id;
+	int			standby_node_id;
+	char		monitor_standby_timestamp[MONITORING_TIMESTAMP_LEN];
+	XLogRecPtr	primary_last_wal_location;
+	XLogRecPtr	last_wal_receive_lsn;
+	char		last_xact_replay_timestamp[MONITORING_TIMESTAMP_LEN];
+	long long unsigned int replication_lag_bytes;
+	long long unsigned int apply_lag_bytes;
+} t_monitoring_record;
+
+/* node state required by a promotion candidate, see repmgr.get_election_state() */
+typedef struct
+{
+	pid_t		repmgrd_pid;
+	bool		repmgrd_paused;
+	bool		in_recovery;
+	XLogRecPtr	last_wal_receive_lsn;
+	XLogRecPtr	last_wal_replay_lsn;
+	bool		wal_replay_paused;
+	int			upstream_last_seen;
+	int			current_electoral_term;
+	int			priority;
+} t_election_state;
+
 /* structs to store a list of repmgr node records */
 typedef struct NodeInfoListCell
 {
 	struct NodeInfoListCell *next;
 	t_node_info *node_info;
     ReplInfo  replinfo; //highgo
+	bool		replinfo_valid;
+	t_election_state election_state;
+	bool		election_state_valid;
+	bool		ping_ok;
 } NodeInfoListCell;
 
 typedef struct NodeInfoList
@@ -231,6 +267,10 @@ typedef struct NodeInfoList
 	0 \
 }
 
+/* events spooled by repmgrd are synced to disk in batches */
+#define EVENT_SPOOL_SYNC_BATCH 16
+#define EVENT_SPOOL_SYNC_INTERVAL 1	/* seconds */
+
 typedef struct s_event_info
 {
 	char	   *node_name;
@@ -352,6 +392,18 @@ typedef struct
 }
 
 
+typedef struct
+{
+	bool		valid;
+	int64		samples;
+	int64		p50_us;
+	int64		p99_us;
+	int64		max_us;
+	bool		degraded;
+} t_storage_latency;
+
+#define T_STORAGE_LATENCY_INITIALIZER { false, 0, -1, -1, -1, false }
+
 typedef struct RepmgrdInfo {
 	int node_id;
 	int pid;
@@ -366,6 +418,7 @@ typedef struct RepmgrdInfo {
 	bool wal_paused_pending_wal;
 	int  upstream_last_seen;
 	char upstream_last_seen_text[MAXLEN];
+	t_storage_latency storage_latency[STORAGE_PROBE_TYPES];
 } RepmgrdInfo;
 
 
@@ -391,6 +444,8 @@ PGconn	   *establish_db_connection_by_params(t_conninfo_param_list *param_list,
 								  const bool exit_on_error);
 PGconn	   *establish_primary_db_connection(PGconn *conn,
 								const bool exit_on_error);
+void		establish_db_connections_concurrently(NodeInfoList *node_list, int timeout_ms);
+void		establish_db_connections_concurrently_quiet(NodeInfoList *node_list, int timeout_ms);
 PGconn	   *get_primary_connection(PGconn *standby_conn, int *primary_id, char *primary_conninfo_out);
 PGconn	   *get_primary_connection_quiet(PGconn *standby_conn, int *primary_id, char *primary_conninfo_out);
 
@@ -445,6 +500,13 @@ bool		repmgrd_check_local_node_id(PGconn *conn);
 BackupState	server_in_exclusive_backup_mode(PGconn *conn);
 void		repmgrd_set_pid(PGconn *conn, pid_t repmgrd_pid, const char *pidfile);
 pid_t		repmgrd_get_pid(PGconn *conn);
+void		repmgrd_set_election_state(PGconn *conn, int priority);
+void		get_election_state_concurrently(NodeInfoList *node_list, int timeout_ms);
+bool		get_election_state_by_node_queries(PGconn *conn, t_server_type node_type, t_election_state *election_state);
+void		get_replication_info_concurrently(NodeInfoList *node_list, int timeout_ms);
+void		ping_nodes_concurrently(NodeInfoList *node_list, int timeout_ms);
+bool		repmgrd_set_storage_latency(PGconn *conn, StorageProbeType probe, StorageLatencyHistogram *histogram, bool degraded);
+bool		get_storage_latency(PGconn *conn, t_storage_latency *storage_latency);
 bool		repmgrd_is_running(PGconn *conn);
 bool		repmgrd_is_paused(PGconn *conn);
 bool		repmgrd_pause(PGconn *conn, bool pause);
@@ -497,6 +559,8 @@ bool		update_node_record_slot_name(PGconn *primary_conn, int node_id, char *slot
 
 bool		witness_copy_node_records(PGconn *primary_conn, PGconn *witness_conn);
 
+int64		get_node_records_version(PGconn *conn);
+
 void		clear_node_info_list(NodeInfoList *nodes);
 
 /* PostgreSQL configuration file location functions */
@@ -509,6 +573,9 @@ void		config_file_list_add(t_configfile_list *list, const char *file, const char
 bool		create_event_record(PGconn *conn, t_configuration_options *options, int node_id, char *event, bool successful, char *details);
 bool		create_event_notification(PGconn *conn, t_configuration_options *options, int node_id, char *event, bool successful, char *details);
 bool		create_event_notification_extended(PGconn *conn, t_configuration_options *options, int node_id, char *event, bool successful, char *details, t_event_info *event_info);
+bool		open_event_spool(const char *path);
+void		close_event_spool(void);
+bool		replay_event_spool(PGconn *conn);
 PGresult   *get_event_records(PGconn *conn, int node_id, const char *node_name, const char *event, bool all, int limit);
 
 /* replication slot functions */
@@ -534,21 +601,13 @@ ExecStatusType	connection_ping(PGconn *conn);
 ExecStatusType	connection_ping_reconnect(PGconn *conn);
 
 /* monitoring functions  */
-void
-add_monitoring_record(PGconn *primary_conn,
-					  PGconn *local_conn,
-					  int primary_node_id,
-					  int local_node_id,
-					  char *monitor_standby_timestamp,
-					  XLogRecPtr primary_last_wal_location,
-					  XLogRecPtr last_wal_receive_lsn,
-					  char *last_xact_replay_timestamp,
-					  long long unsigned int replication_lag_bytes,
-					  long long unsigned int apply_lag_bytes
-);
+bool		add_monitoring_records(PGconn *primary_conn, t_monitoring_record *records, int record_count);
+void		set_standby_last_updated(PGconn *local_conn);
 
-int			get_number_of_monitoring_records_to_delete(PGconn *primary_conn, int keep_history, int node_id);
-bool		delete_monitoring_records(PGconn *primary_conn, int keep_history, int node_id);
+RecordStatus get_monitoring_records_to_delete(PGconn *primary_conn, int keep_history, int node_id);
+bool		delete_monitoring_records(PGconn *primary_conn, int keep_history, int node_id, bool partitioned);
+bool		is_monitoring_history_partitioned(PGconn *conn);
+int			create_monitoring_history_partitions(PGconn *conn, int days_ahead);
 
 
 
@@ -571,6 +630,7 @@ int			get_replication_lag_seconds(PGconn *conn);
 void		get_node_replication_stats(PGconn *conn, t_node_info *node_info);
 bool		is_downstream_node_attached(PGconn *conn, char *node_name);
 void		set_upstream_last_seen(PGconn *conn);
+void		record_replication_sample(PGconn *conn);
 int			get_upstream_last_seen(PGconn *conn, t_server_type node_type);
 bool		is_wal_replay_paused(PGconn *conn, bool check_pending_wal);
 
@@ -607,5 +667,6 @@ bool unbind_virtual_ip(const char *vip, const char *network_card);
 bool check_vip_conf(const char *vip, const char *network_card);
 bool get_virtual_ip(PGconn *conn, int primary_id, char *virtual_ip);
 bool get_network_card(PGconn *conn, int primary_id, char *network_card);
+RecordStatus get_network_card_record(PGconn *conn, int primary_id, char *network_card);
 
 #endif							/* _REPMGR_DBUTILS_H_ */
@@ -26,6 +26,10 @@
 
 #include <stdarg.h>
 #include <time.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/socket.h>
 
 #include "log.h"
 
@@ -34,9 +38,71 @@
 #define DEFAULT_SYSLOG_FACILITY LOG_LOCAL0
 #endif
 
+/* longer messages are truncated when passed to the log writer */
+#define LOG_MESSAGE_MAXLEN		8192
+#define LOG_WRITER_SNDBUF		(1024 * 1024)
+
+typedef enum
+{
+	LOG_MESSAGE_STDERR = 0,
+	LOG_MESSAGE_SYSLOG,
+	LOG_MESSAGE_REOPEN,
+	LOG_MESSAGE_OPENLOG
+} LogMessageType;
+
+typedef struct t_log_message
+{
+	LogMessageType type;
+	int			priority;
+	char		text[LOG_MESSAGE_MAXLEN];
+} t_log_message;
+
+/* repmgrd's end of the socket to the log writer, if running */
+static int	log_writer_socket = -1;
+
+#ifdef HAVE_SYSLOG
+/* as passed to openlog(), so a running log writer can be updated */
+static const char *log_syslog_ident = DEFAULT_IDENT;
+static int	log_syslog_facility = DEFAULT_SYSLOG_FACILITY;
+#endif
+
+/* context included in each line if "log_format" is "json" */
+static LogFormat log_format = LOG_FORMAT_TEXT;
+static int	log_node_id = UNKNOWN_NODE_ID;
+static const char *(*log_state_callback) (void) = NULL;
+static const char *log_event = NULL;
+static unsigned long log_messages_discarded = 0;
+
+/*
+ * Details of the event being recorded, each emitted as a separate member;
+ * copied, as the caller's values may not outlive the event.
+ */
+#define LOG_EVENT_FIELDS_MAX	8
+
+typedef struct t_log_event_field
+{
+	char		key[32];
+	char		value[MAXLEN];
+	bool		quote;
+} t_log_event_field;
+
+static t_log_event_field log_event_fields[LOG_EVENT_FIELDS_MAX];
+static int	log_event_field_count = 0;
+
 /* #define REPMGR_DEBUG */
 
 static int	detect_log_facility(const char *facility);
+static void _update_log_timestamps(void);
+static const char *_log_timestamp(void);
+static int	_format_json_line(char *buf, int buf_size, const char *level_name, const char *fmt, va_list ap)
+__attribute__((format(PG_PRINTF_ATTRIBUTE, 4, 0)));
+static int	_json_append(char *buf, int buf_size, int len, const char *str, bool escape);
+static void _add_event_field(const char *key, const char *value, bool quote);
+#ifdef HAVE_SYSLOG
+static const char *_syslog_level_name(int priority);
+#endif
+static bool _send_log_message(t_log_message *message, int text_len);
+static void _log_writer(int sock);
 static void
 _stderr_log_with_level(const char *level_name, int level, const char *fmt, va_list ap)
 __attribute__((format(PG_PRINTF_ATTRIBUTE, 3, 0)));
@@ -66,8 +132,6 @@ stderr_log_with_level(const char *level_name, int level, const char *fmt,...)
 static void
 _stderr_log_with_level(const char *level_name, int level, const char *fmt, va_list ap)
 {
-	char		buf[100];
-
 	/*
 	 * Store the requested level so that if there's a subsequent log_hint() or
 	 * log_detail(), we can suppress that if --terse was specified,
@@ -76,17 +140,45 @@ _stderr_log_with_level(const char *level_name, int level, const char *fmt, va_li
 
 	if (log_level >= level)
 	{
+		/* hand the formatted line to the log writer, if running */
+		if (log_writer_socket >= 0 || log_format == LOG_FORMAT_JSON)
+		{
+			t_log_message message;
+			int			len;
+
+			message.type = LOG_MESSAGE_STDERR;
+			message.priority = level;
+
+			if (log_format == LOG_FORMAT_JSON)
+			{
+				len = _format_json_line(message.text, sizeof(message.text), level_name, fmt, ap);
+			}
+			else
+			{
+				len = snprintf(message.text, sizeof(message.text), "%s [%s] ",
+							   _log_timestamp(), level_name);
+				vsnprintf(message.text + len, sizeof(message.text) - len, fmt, ap);
+
+				len = strlen(message.text);
+				if (len > (int) sizeof(message.text) - 2)
+					len = sizeof(message.text) - 2;
+			}
+
+			message.text[len++] = '\n';
+			message.text[len] = '\0';
+
+			if (_send_log_message(&message, len) == true)
+				return;
+
+			fputs(message.text, stderr);
+			fflush(stderr);
+			return;
+		}
 
 		/* Format log line prefix with timestamp if in daemon mode */
 		if (logger_output_mode == OM_DAEMON)
 		{
-			time_t		t;
-			struct tm  *tm;
-
-			time(&t);
-			tm = localtime(&t);
-			strftime(buf, sizeof(buf), "[%Y-%m-%d %H:%M:%S]", tm);
-			fprintf(stderr, "%s [%s] ", buf, level_name);
+			fprintf(stderr, "%s [%s] ", _log_timestamp(), level_name);
 		}
 		else
 		{
@@ -99,6 +191,284 @@ _stderr_log_with_level(const char *level_name, int level, const char *fmt, va_li
 	}
 }
 
+#ifdef HAVE_SYSLOG
+void
+syslog_log_with_level(int priority, const char *fmt,...)
+{
+	va_list		ap;
+
+	va_start(ap, fmt);
+
+	if (log_writer_socket >= 0)
+	{
+		t_log_message message;
+
+		message.type = LOG_MESSAGE_SYSLOG;
+		message.priority = priority;
+
+		if (log_format == LOG_FORMAT_JSON)
+			_format_json_line(message.text, sizeof(message.text), _syslog_level_name(priority), fmt, ap);
+		else
+			vsnprintf(message.text, sizeof(message.text), fmt, ap);
+
+		if (_send_log_message(&message, strlen(message.text)) == true)
+		{
+			va_end(ap);
+			return;
+		}
+
+		syslog(priority, "%s", message.text);
+	}
+	else if (log_format == LOG_FORMAT_JSON)
+	{
+		char		line[LOG_MESSAGE_MAXLEN];
+
+		_format_json_line(line, sizeof(line), _syslog_level_name(priority), fmt, ap);
+		syslog(priority, "%s", line);
+	}
+	else
+	{
+		vsyslog(priority, fmt, ap);
+	}
+
+	va_end(ap);
+}
+
+
+static const char *
+_syslog_level_name(int priority)
+{
+	switch (priority)
+	{
+		case LOG_EMERG:
+			return "EMERG";
+		case LOG_ALERT:
+			return "ALERT";
+		case LOG_CRIT:
+			return "CRIT";
+		case LOG_ERROR:
+			return "ERROR";
+		case LOG_WARNING:
+			return "WARNING";
+		case LOG_NOTICE:
+			return "NOTICE";
+		case LOG_INFO:
+			return "INFO";
+	}
+
+	return "DEBUG";
+}
+#endif
+
+
+/*
+ * Log line timestamps are formatted at most once per second.
+ */
+static time_t cached_time = 0;
+static char cached_timestamp[32] = "";
+static char cached_timestamp_json[32] = "";
+
+static void
+_update_log_timestamps(void)
+{
+	time_t		t;
+	struct tm  *tm;
+	size_t		len;
+
+	time(&t);
+
+	if (t == cached_time)
+		return;
+
+	tm = localtime(&t);
+	strftime(cached_timestamp, sizeof(cached_timestamp), "[%Y-%m-%d %H:%M:%S]", tm);
+	len = strftime(cached_timestamp_json, sizeof(cached_timestamp_json), "%Y-%m-%dT%H:%M:%S%z", tm);
+
+	/* RFC 3339 requires the UTC offset as "+hh:mm" rather than "+hhmm" */
+	if (len > 2 && len < sizeof(cached_timestamp_json) - 1)
+	{
+		memmove(cached_timestamp_json + len - 1, cached_timestamp_json + len - 2, 3);
+		cached_timestamp_json[len - 2] = ':';
+	}
+
+	cached_time = t;
+}
+
+
+static const char *
+_log_timestamp(void)
+{
+	_update_log_timestamps();
+
+	return cached_timestamp;
+}
+
+
+/*
+ * Format a log line as a JSON object (without trailing newline) into the
+ * provided buffer, truncating the message if necessary; returns its length.
+ *
+ * The message is formatted into a static buffer and escaped while being
+ * copied, so no memory is allocated.
+ */
+static int
+_format_json_line(char *buf, int buf_size, const char *level_name, const char *fmt, va_list ap)
+{
+	static char message[LOG_MESSAGE_MAXLEN];
+	char		node_id[16] = "null";
+	int			len = 0;
+
+	vsnprintf(message, sizeof(message), fmt, ap);
+
+	_update_log_timestamps();
+
+	if (log_node_id != UNKNOWN_NODE_ID)
+		snprintf(node_id, sizeof(node_id), "%i", log_node_id);
+
+	len = _json_append(buf, buf_size, len, "{\"timestamp\":\"", false);
+	len = _json_append(buf, buf_size, len, cached_timestamp_json, false);
+	len = _json_append(buf, buf_size, len, "\",\"level\":\"", false);
+	len = _json_append(buf, buf_size, len, level_name, false);
+	len = _json_append(buf, buf_size, len, "\",\"node_id\":", false);
+	len = _json_append(buf, buf_size, len, node_id, false);
+
+	if (log_state_callback != NULL)
+	{
+		len = _json_append(buf, buf_size, len, ",\"monitoring_state\":\"", false);
+		len = _json_append(buf, buf_size, len, log_state_callback(), true);
+		len = _json_append(buf, buf_size, len, "\"", false);
+	}
+
+	if (log_event != NULL)
+	{
+		int			i;
+
+		len = _json_append(buf, buf_size, len, ",\"event\":\"", false);
+		len = _json_append(buf, buf_size, len, log_event, true);
+		len = _json_append(buf, buf_size, len, "\"", false);
+
+		for (i = 0; i < log_event_field_count; i++)
+		{
+			t_log_event_field *field = &log_event_fields[i];
+
+			len = _json_append(buf, buf_size, len, ",\"", false);
+			len = _json_append(buf, buf_size, len, field->key, true);
+			len = _json_append(buf, buf_size, len, field->quote ? "\":\"" : "\":", false);
+			len = _json_append(buf, buf_size, len, field->value, true);
+
+			if (field->quote)
+				len = _json_append(buf, buf_size, len, "\"", false);
+		}
+	}
+
+	len = _json_append(buf, buf_size, len, ",\"message\":\"", false);
+	len = _json_append(buf, buf_size, len, message, true);
+
+	/* space for these was reserved by _json_append() */
+	buf[len++] = '"';
+	buf[len++] = '}';
+	buf[len] = '\0';
+
+	return len;
+}
+
+
+/*
+ * Append "str" to the JSON line being built in "buf", escaping it as a
+ * JSON string value if "escape" is set. Room is always left for the
+ * closing characters and a newline, so a long message is truncated
+ * rather than producing invalid JSON. Truncation never splits a UTF-8
+ * sequence; an incomplete or invalid sequence is replaced with U+FFFD.
+ */
+static int
+_json_append(char *buf, int buf_size, int len, const char *str, bool escape)
+{
+	int			limit = buf_size - 4;
+	const char *ptr;
+
+	for (ptr = str; *ptr && len < limit; ptr++)
+	{
+		unsigned char c = (unsigned char) *ptr;
+		char		escaped[8] = "";
+
+		if (c >= 0x80)
+		{
+			int			seq_len = c >= 0xF0 ? 4 : c >= 0xE0 ? 3 : c >= 0xC0 ? 2 : 1;
+			int			i;
+
+			for (i = 1; i < seq_len; i++)
+			{
+				if (((unsigned char) ptr[i] & 0xC0) != 0x80)
+					break;
+			}
+
+			if (seq_len == 1 || i < seq_len || c > 0xF4)
+			{
+				if (len + 6 > limit)
+					break;
+
+				memcpy(buf + len, "\\ufffd", 6);
+				len += 6;
+				ptr += i - 1;
+				continue;
+			}
+
+			if (len + seq_len > limit)
+				break;
+
+			memcpy(buf + len, ptr, seq_len);
+			len += seq_len;
+			ptr += seq_len - 1;
+			continue;
+		}
+
+		if (escape == true)
+		{
+			switch (c)
+			{
+				case '"':
+					strcpy(escaped, "\\\"");
+					break;
+				case '\\':
+					strcpy(escaped, "\\\\");
+					break;
+				case '\n':
+					strcpy(escaped, "\\n");
+					break;
+				case '\r':
+					strcpy(escaped, "\\r");
+					break;
+				case '\t':
+					strcpy(escaped, "\\t");
+					break;
+				default:
+					if (c < 0x20)
+						snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+			}
+		}
+
+		if (escaped[0] != '\0')
+		{
+			int			escaped_len = strlen(escaped);
+
+			if (len + escaped_len > limit)
+				break;
+
+			memcpy(buf + len, escaped, escaped_len);
+			len += escaped_len;
+		}
+		else
+		{
+			buf[len++] = c;
+		}
+	}
+
+	buf[len] = '\0';
+
+	return len;
+}
+
+
 void
 log_hint(const char *fmt,...)
 {
@@ -211,6 +581,9 @@ logger_init(t_configuration_options *opts, const char *ident)
 	if (logger_output_mode == OM_COMMAND_LINE)
 		return true;
 
+	log_format = opts->log_format;
+	log_node_id = opts->node_id;
+
 	if (facility && *facility)
 	{
 
@@ -246,6 +619,9 @@ logger_init(t_configuration_options *opts, const char *ident)
 		setlogmask(LOG_UPTO(log_level));
 		openlog(ident, LOG_CONS | LOG_PID | LOG_NDELAY, syslog_facility);
 
+		log_syslog_ident = ident;
+		log_syslog_facility = syslog_facility;
+
 		stderr_log_notice(_("setup syslog (level: %s, facility: %s)\n"), level, facility);
 	}
 #endif
@@ -290,9 +666,285 @@ logger_init(t_configuration_options *opts, const char *ident)
 }
 
 
+/*
+ * Reinitialise logging following a configuration change.
+ *
+ * A running log writer is kept, and told to apply the new log file and
+ * syslog settings. It is not replaced: the disk check thread may be running
+ * at this point, and repmgrd's other children would keep the old writer's
+ * socket open, so it would never exit.
+ */
+bool
+logger_reinit(t_configuration_options *opts, const char *ident)
+{
+#ifdef HAVE_SYSLOG
+	if (log_type == REPMGR_SYSLOG)
+		closelog();
+#endif
+
+	if (logger_init(opts, ident) == false)
+		return false;
+
+	if (log_writer_socket < 0)
+		return true;
+
+	logger_reopen(opts->log_file);
+
+#ifdef HAVE_SYSLOG
+	if (log_type == REPMGR_SYSLOG)
+	{
+		t_log_message message;
+
+		message.type = LOG_MESSAGE_OPENLOG;
+		message.priority = log_syslog_facility;
+		strncpy(message.text, log_syslog_ident, sizeof(message.text) - 1);
+		message.text[sizeof(message.text) - 1] = '\0';
+
+		(void) _send_log_message(&message, strlen(message.text));
+	}
+#endif
+
+	return true;
+}
+
+
+/*
+ * Start a process which writes log output on repmgrd's behalf, so that
+ * repmgrd itself never blocks on a slow log file or syslog.
+ *
+ * Formatted messages are passed to the writer over a socket pair without
+ * waiting; the socket's buffer acts as the queue. If it is full, the
+ * message is discarded and counted, and the number of discarded messages
+ * is logged once the writer has caught up. If the writer has gone away,
+ * logging reverts to writing directly.
+ *
+ * The writer exits once all processes holding the other end of the
+ * socket have closed it, after writing any queued messages; other child
+ * processes must therefore call logger_detach_writer(). It is started
+ * once only, as repmgrd later runs a thread (see repmgrd-diskcheck.c);
+ * logger_reinit() passes any changed settings to the running writer.
+ */
+bool
+logger_start_writer(void)
+{
+	int			sock_fds[2];
+	int			sndbuf = LOG_WRITER_SNDBUF;
+	pid_t		pid;
+
+	if (log_writer_socket >= 0)
+		return true;
+
+	if (socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, sock_fds) != 0)
+	{
+		log_warning(_("unable to create socket for log writer"));
+		log_detail("%s", strerror(errno));
+		return false;
+	}
+
+	/* the kernel may cap this; the default is still adequate */
+	(void) setsockopt(sock_fds[0], SOL_SOCKET, SO_SNDBUF, &sndbuf, sizeof(sndbuf));
+
+	fflush(NULL);
+
+	pid = fork();
+
+	if (pid < 0)
+	{
+		log_warning(_("unable to start log writer"));
+		log_detail("%s", strerror(errno));
+
+		close(sock_fds[0]);
+		close(sock_fds[1]);
+		return false;
+	}
+
+	if (pid == 0)
+	{
+		close(sock_fds[0]);
+		_log_writer(sock_fds[1]);
+	}
+
+	close(sock_fds[1]);
+	log_writer_socket = sock_fds[0];
+
+	return true;
+}
+
+
+/*
+ * Called in a child process of repmgrd, which then writes any log output
+ * directly; holding the socket open would prevent the log writer from
+ * exiting when repmgrd does.
+ */
+void
+logger_detach_writer(void)
+{
+	if (log_writer_socket < 0)
+		return;
+
+	close(log_writer_socket);
+	log_writer_socket = -1;
+}
+
+
+/*
+ * Tell the log writer to reopen the log file; the caller is expected to
+ * have reopened its own stderr already.
+ */
+void
+logger_reopen(const char *log_file)
+{
+	t_log_message message;
+
+	if (log_writer_socket < 0 || log_file[0] == '\0')
+		return;
+
+	message.type = LOG_MESSAGE_REOPEN;
+	message.priority = 0;
+	strncpy(message.text, log_file, sizeof(message.text) - 1);
+	message.text[sizeof(message.text) - 1] = '\0';
+
+	(void) _send_log_message(&message, strlen(message.text));
+}
+
+
+/*
+ * Returns false if the log writer is not available, in which case the
+ * caller should write the message itself.
+ */
+static bool
+_send_log_message(t_log_message *message, int text_len)
+{
+	size_t		message_len = offsetof(t_log_message, text) + text_len + 1;
+
+	if (log_writer_socket < 0)
+		return false;
+
+	if (log_messages_discarded > 0)
+	{
+		t_log_message discarded;
+		int			len;
+
+		discarded.type = message->type == LOG_MESSAGE_SYSLOG ? LOG_MESSAGE_SYSLOG : LOG_MESSAGE_STDERR;
+		discarded.priority = LOG_WARNING;
+
+		if (discarded.type == LOG_MESSAGE_SYSLOG)
+			len = snprintf(discarded.text, sizeof(discarded.text),
+						   _("%lu log message(s) discarded as the log writer was not keeping up"),
+						   log_messages_discarded);
+		else
+			len = snprintf(discarded.text, sizeof(discarded.text),
+						   _("%s [WARNING] %lu log message(s) discarded as the log writer was not keeping up\n"),
+						   _log_timestamp(), log_messages_discarded);
+
+		if (send(log_writer_socket, &discarded, offsetof(t_log_message, text) + len + 1,
+				 MSG_DONTWAIT | MSG_NOSIGNAL) < 0)
+		{
+			if (errno == EAGAIN || errno == EWOULDBLOCK)
+			{
+				log_messages_discarded++;
+				return true;
+			}
+		}
+		else
+		{
+			log_messages_discarded = 0;
+		}
+	}
+
+	if (send(log_writer_socket, message, message_len, MSG_DONTWAIT | MSG_NOSIGNAL) >= 0)
+		return true;
+
+	if (errno == EAGAIN || errno == EWOULDBLOCK)
+	{
+		log_messages_discarded++;
+		return true;
+	}
+
+	/* the log writer has gone away; write directly from now on */
+	close(log_writer_socket);
+	log_writer_socket = -1;
+
+	return false;
+}
+
+
+static void
+_log_writer(int sock)
+{
+	t_log_message message;
+#ifdef HAVE_SYSLOG
+	/* openlog() retains the pointer */
+	static char syslog_ident[MAXLEN];
+#endif
+
+	/* keep running until repmgrd has closed the socket, so no output is lost */
+	pqsignal(SIGHUP, SIG_IGN);
+	pqsignal(SIGINT, SIG_IGN);
+	pqsignal(SIGTERM, SIG_IGN);
+
+#ifdef HAVE_SYSLOG
+	/* messages are filtered by repmgrd, whose log level may change */
+	setlogmask(LOG_UPTO(LOG_DEBUG));
+#endif
+
+	for (;;)
+	{
+		ssize_t		len = recv(sock, &message, sizeof(message) - 1, 0);
+
+		if (len < 0 && errno == EINTR)
+			continue;
+
+		if (len <= 0)
+			break;
+
+		if (len <= (ssize_t) offsetof(t_log_message, text))
+			continue;
+
+		((char *) &message)[len] = '\0';
+
+		switch (message.type)
+		{
+			case LOG_MESSAGE_STDERR:
+				fputs(message.text, stderr);
+				fflush(stderr);
+				break;
+			case LOG_MESSAGE_SYSLOG:
+#ifdef HAVE_SYSLOG
+				syslog(message.priority, "%s", message.text);
+#endif
+				break;
+			case LOG_MESSAGE_REOPEN:
+				/* on failure, repmgrd will revert to writing directly */
+				if (freopen(message.text, "a", stderr) == NULL)
+					_exit(1);
+				break;
+			case LOG_MESSAGE_OPENLOG:
+#ifdef HAVE_SYSLOG
+				closelog();
+				strncpy(syslog_ident, message.text, sizeof(syslog_ident) - 1);
+				openlog(syslog_ident, LOG_CONS | LOG_PID | LOG_NDELAY, message.priority);
+#endif
+				break;
+		}
+	}
+
+	close(sock);
+
+	_exit(0);
+}
+
+
 bool
 logger_shutdown(void)
 {
+	/* the log writer exits once it has written any queued messages */
+	if (log_writer_socket >= 0)
+	{
+		close(log_writer_socket);
+		log_writer_socket = -1;
+	}
+
 #ifdef HAVE_SYSLOG
 	if (log_type == REPMGR_SYSLOG)
 		closelog();
@@ -329,6 +981,74 @@ logger_set_terse(void)
 }
 
 
+/*
+ * Provide a function returning the daemon's current monitoring state,
+ * for inclusion in JSON log output.
+ */
+void
+logger_set_state_callback(const char *(*state_callback) (void))
+{
+	log_state_callback = state_callback;
+}
+
+
+/*
+ * Set the event being recorded, for inclusion in JSON log lines; any
+ * fields added for the previous event are discarded.
+ */
+void
+logger_set_event(const char *event)
+{
+	log_event = event;
+	log_event_field_count = 0;
+}
+
+
+/*
+ * Add a field describing the current event (see logger_set_event()).
+ */
+void
+logger_add_event_field(const char *key, const char *value)
+{
+	_add_event_field(key, value, true);
+}
+
+
+void
+logger_add_event_field_int(const char *key, int value)
+{
+	char		buf[16];
+
+	snprintf(buf, sizeof(buf), "%i", value);
+	_add_event_field(key, buf, false);
+}
+
+
+void
+logger_add_event_field_bool(const char *key, bool value)
+{
+	_add_event_field(key, value ? "true" : "false", false);
+}
+
+
+static void
+_add_event_field(const char *key, const char *value, bool quote)
+{
+	t_log_event_field *field;
+
+	if (log_event == NULL || log_event_field_count >= LOG_EVENT_FIELDS_MAX)
+		return;
+
+	field = &log_event_fields[log_event_field_count++];
+
+	strncpy(field->key, key, sizeof(field->key) - 1);
+	field->key[sizeof(field->key) - 1] = '\0';
+	strncpy(field->value, value, sizeof(field->value) - 1);
+	field->value[sizeof(field->value) - 1] = '\0';
+	field->quote = quote;
+}
+
+
 void
 logger_set_level(int new_log_level)
 {
@@ -57,51 +57,55 @@ __attribute__((format(PG_PRINTF_ATTRIBUTE, 3, 4)));
 
 #include <syslog.h>
 
+extern void
+syslog_log_with_level(int priority, const char *fmt,...)
+__attribute__((format(PG_PRINTF_ATTRIBUTE, 2, 3)));
+
 #define log_debug(...) \
 	if (log_type == REPMGR_SYSLOG) \
-		syslog(LOG_DEBUG, __VA_ARGS__); \
+		syslog_log_with_level(LOG_DEBUG, __VA_ARGS__); \
 	else \
 		stderr_log_debug(__VA_ARGS__);
 
 #define log_info(...) \
 	{ \
-		if (log_type == REPMGR_SYSLOG) syslog(LOG_INFO, __VA_ARGS__); \
+		if (log_type == REPMGR_SYSLOG) syslog_log_with_level(LOG_INFO, __VA_ARGS__); \
 		else stderr_log_info(__VA_ARGS__); \
 	}
 
 #define log_notice(...) \
 	{ \
-		if (log_type == REPMGR_SYSLOG) syslog(LOG_NOTICE, __VA_ARGS__); \
+		if (log_type == REPMGR_SYSLOG) syslog_log_with_level(LOG_NOTICE, __VA_ARGS__); \
 		else stderr_log_notice(__VA_ARGS__); \
 	}
 
 #define log_warning(...) \
 	{ \
-		if (log_type == REPMGR_SYSLOG) syslog(LOG_WARNING, __VA_ARGS__); \
+		if (log_type == REPMGR_SYSLOG) syslog_log_with_level(LOG_WARNING, __VA_ARGS__); \
 		else stderr_log_warning(__VA_ARGS__); \
 	}
 
 #define log_error(...) \
 	{ \
-		if (log_type == REPMGR_SYSLOG) syslog(LOG_ERROR, __VA_ARGS__); \
+		if (log_type == REPMGR_SYSLOG) syslog_log_with_level(LOG_ERROR, __VA_ARGS__); \
 		else stderr_log_error(__VA_ARGS__); \
 	}
 
 #define log_crit(...) \
 	{ \
-		if (log_type == REPMGR_SYSLOG) syslog(LOG_CRIT, __VA_ARGS__); \
+		if (log_type == REPMGR_SYSLOG) syslog_log_with_level(LOG_CRIT, __VA_ARGS__); \
 		else stderr_log_crit(__VA_ARGS__); \
 	}
 
 #define log_alert(...) \
 	{ \
-		if (log_type == REPMGR_SYSLOG) syslog(LOG_ALERT, __VA_ARGS__); \
+		if (log_type == REPMGR_SYSLOG) syslog_log_with_level(LOG_ALERT, __VA_ARGS__); \
 		else stderr_log_alert(__VA_ARGS__); \
 	}
 
 #define log_emerg(...) \
 	{ \
-		if (log_type == REPMGR_SYSLOG) syslog(LOG_ALERT, __VA_ARGS__); \
+		if (log_type == REPMGR_SYSLOG) syslog_log_with_level(LOG_ALERT, __VA_ARGS__); \
 		else stderr_log_alert(__VA_ARGS__); \
 	}
 #else
@@ -123,13 +127,22 @@ int			detect_log_level(const char *level);
 /* Logger initialisation and shutdown */
 
 bool		logger_init(t_configuration_options *opts, const char *ident);
+bool		logger_reinit(t_configuration_options *opts, const char *ident);
 
+bool		logger_start_writer(void);
+void		logger_detach_writer(void);
+void		logger_reopen(const char *log_file);
 bool		logger_shutdown(void);
 
 void		logger_set_verbose(void);
 void		logger_set_terse(void);
 void		logger_set_min_level(int min_log_level);
 void		logger_set_level(int new_log_level);
+void		logger_set_state_callback(const char *(*state_callback) (void));
+void		logger_set_event(const char *event);
+void		logger_add_event_field(const char *key, const char *value);
+void		logger_add_event_field_int(const char *key, int value);
+void		logger_add_event_field_bool(const char *key, bool value);
 
 void
 log_detail(const char *fmt,...)
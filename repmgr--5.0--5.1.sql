@@ -0,0 +1,172 @@
+-- complain if script is sourced in psql, rather than via CREATE EXTENSION
+\echo Use "CREATE EXTENSION repmgr" to load this file. \quit
+
+CREATE FUNCTION set_election_state(INT, INT)
+  RETURNS VOID
+  AS 'MODULE_PATHNAME', 'set_election_state'
+  LANGUAGE C STRICT;
+
+CREATE FUNCTION get_election_state(
+  OUT repmgrd_pid INT,
+  OUT repmgrd_paused BOOL,
+  OUT in_recovery BOOL,
+  OUT last_wal_receive_lsn TEXT,
+  OUT last_wal_replay_lsn TEXT,
+  OUT wal_replay_paused BOOL,
+  OUT upstream_last_seen INT,
+  OUT current_electoral_term INT,
+  OUT priority INT)
+  RETURNS RECORD
+  AS 'MODULE_PATHNAME', 'get_election_state'
+  LANGUAGE C STRICT;
+
+CREATE FUNCTION bump_node_records_version()
+  RETURNS VOID
+  AS 'MODULE_PATHNAME', 'bump_node_records_version'
+  LANGUAGE C STRICT;
+
+CREATE FUNCTION get_node_records_version()
+  RETURNS BIGINT
+  AS 'MODULE_PATHNAME', 'get_node_records_version'
+  LANGUAGE C STRICT;
+
+CREATE FUNCTION set_storage_latency(INT, BIGINT, BIGINT, BIGINT[], BOOL)
+  RETURNS VOID
+  AS 'MODULE_PATHNAME', 'set_storage_latency'
+  LANGUAGE C STRICT;
+
+CREATE FUNCTION get_storage_latency(
+  OUT probe TEXT,
+  OUT samples BIGINT,
+  OUT p50_us BIGINT,
+  OUT p99_us BIGINT,
+  OUT max_us BIGINT,
+  OUT degraded BOOL,
+  OUT last_updated TIMESTAMP WITH TIME ZONE)
+  RETURNS SETOF RECORD
+  AS 'MODULE_PATHNAME', 'get_storage_latency'
+  LANGUAGE C STRICT;
+
+CREATE FUNCTION get_storage_latency_histogram(
+  OUT probe TEXT,
+  OUT lower_us BIGINT,
+  OUT upper_us BIGINT,
+  OUT count BIGINT)
+  RETURNS SETOF RECORD
+  AS 'MODULE_PATHNAME', 'get_storage_latency_histogram'
+  LANGUAGE C STRICT;
+
+CREATE FUNCTION record_replication_sample()
+  RETURNS BOOL
+  AS 'MODULE_PATHNAME', 'record_replication_sample'
+  LANGUAGE C STRICT;
+
+CREATE FUNCTION get_replication_samples(
+  OUT sample_time TIMESTAMP WITH TIME ZONE,
+  OUT last_wal_receive_lsn TEXT,
+  OUT last_wal_replay_lsn TEXT,
+  OUT lag_bytes BIGINT,
+  OUT upstream_last_seen INT)
+  RETURNS SETOF RECORD
+  AS 'MODULE_PATHNAME', 'get_replication_samples'
+  LANGUAGE C STRICT;
+
+/*
+ * monitoring history partition management (PostgreSQL 11 and later)
+ *
+ * An existing "monitoring_history" table is not converted to a partitioned
+ * table here, as that would require rewriting (and locking) a potentially
+ * large table during the upgrade; these functions do nothing if the table
+ * is not partitioned.
+ */
+CREATE FUNCTION monitoring_history_is_partitioned()
+  RETURNS BOOL
+  AS $repmgr_func$
+    SELECT EXISTS (
+      SELECT 1
+        FROM pg_catalog.pg_class c
+        JOIN pg_catalog.pg_namespace n ON n.oid = c.relnamespace
+       WHERE n.nspname = 'repmgr'
+         AND c.relname = 'monitoring_history'
+         AND c.relkind = 'p')
+  $repmgr_func$
+  LANGUAGE SQL STABLE;
+
+CREATE FUNCTION monitoring_history_create_partitions(days_ahead INT)
+  RETURNS INT
+  AS $repmgr_func$
+DECLARE
+  partition_start TIMESTAMP WITH TIME ZONE;
+  partition_name TEXT;
+  partitions_created INT := 0;
+BEGIN
+  IF NOT repmgr.monitoring_history_is_partitioned() THEN
+    RETURN 0;
+  END IF;
+
+  FOR i IN 0..days_ahead LOOP
+    partition_start := pg_catalog.date_trunc('day', pg_catalog.now()) + i * INTERVAL '1 day';
+    partition_name := 'monitoring_history_' || pg_catalog.to_char(partition_start, 'YYYYMMDD');
+
+    CONTINUE WHEN EXISTS (
+      SELECT 1
+        FROM pg_catalog.pg_class c
+        JOIN pg_catalog.pg_namespace n ON n.oid = c.relnamespace
+       WHERE n.nspname = 'repmgr'
+         AND c.relname = partition_name);
+
+    BEGIN
+      EXECUTE pg_catalog.format(
+        'CREATE TABLE repmgr.%I PARTITION OF repmgr.monitoring_history FOR VALUES FROM (%L) TO (%L)',
+        partition_name, partition_start, partition_start + INTERVAL '1 day');
+      partitions_created := partitions_created + 1;
+    EXCEPTION
+      /* created concurrently, or the default partition already holds rows for this day */
+      WHEN duplicate_table OR check_violation THEN
+        RAISE WARNING 'unable to create partition "%"', partition_name
+          USING DETAIL = SQLERRM;
+    END;
+  END LOOP;
+
+  RETURN partitions_created;
+END
+  $repmgr_func$
+  LANGUAGE plpgsql STRICT;
+
+CREATE FUNCTION monitoring_history_drop_partitions(keep_days INT)
+  RETURNS INT
+  AS $repmgr_func$
+DECLARE
+  cutoff TIMESTAMP WITH TIME ZONE := pg_catalog.now() - keep_days * INTERVAL '1 day';
+  partition_name TEXT;
+  partitions_dropped INT := 0;
+BEGIN
+  IF NOT repmgr.monitoring_history_is_partitioned() THEN
+    RETURN 0;
+  END IF;
+
+  FOR partition_name IN
+    SELECT c.relname
+      FROM pg_catalog.pg_inherits i
+      JOIN pg_catalog.pg_class c ON c.oid = i.inhrelid
+     WHERE i.inhparent = 'repmgr.monitoring_history'::pg_catalog.regclass
+       AND c.relname ~ '^monitoring_history_[0-9]{8}$'
+       AND pg_catalog.to_date(pg_catalog.substr(c.relname, 20), 'YYYYMMDD') + 1 <= cutoff
+  LOOP
+    EXECUTE pg_catalog.format('DROP TABLE repmgr.%I', partition_name);
+    partitions_dropped := partitions_dropped + 1;
+  END LOOP;
+
+  /*
+   * Remove expired rows from the partition spanning the cutoff, and from the
+   * default partition; the cutoff is passed as a literal so that all other
+   * partitions are pruned.
+   */
+  EXECUTE pg_catalog.format(
+    'DELETE FROM repmgr.monitoring_history WHERE last_monitor_time <= %L',
+    cutoff);
+
+  RETURN partitions_dropped;
+END
+  $repmgr_func$
+  LANGUAGE plpgsql STRICT;
@@ -0,0 +1,401 @@
+-- complain if script is sourced in psql, rather than via CREATE EXTENSION
+\echo Use "CREATE EXTENSION repmgr" to load this file. \quit
+
+CREATE TABLE repmgr.nodes (
+  node_id          INTEGER     PRIMARY KEY,
+  upstream_node_id INTEGER     NULL REFERENCES nodes (node_id) DEFERRABLE,
+  active           BOOLEAN     NOT NULL DEFAULT TRUE,
+  node_name        TEXT        NOT NULL,
+  type             TEXT        NOT NULL CHECK (type IN('primary','standby','witness','bdr')),
+  location         TEXT        NOT NULL DEFAULT 'default',
+  priority         INT         NOT NULL DEFAULT 100,
+  conninfo         TEXT        NOT NULL,
+  repluser         VARCHAR(63) NOT NULL,
+  slot_name        TEXT        NULL,
+  config_file      TEXT        NOT NULL,
+  virtual_ip       TEXT        NULL,
+  network_card     TEXT        NULL
+);
+
+CREATE TABLE repmgr.events (
+  node_id          INTEGER NOT NULL,
+  event            TEXT NOT NULL,
+  successful       BOOLEAN NOT NULL DEFAULT TRUE,
+  event_timestamp  TIMESTAMP WITH TIME ZONE NOT NULL DEFAULT CURRENT_TIMESTAMP,
+  details          TEXT NULL
+);
+
+DO $repmgr$
+DECLARE
+  DECLARE server_version_num INT;
+BEGIN
+  SELECT setting
+    FROM pg_catalog.pg_settings
+   WHERE name = 'server_version_num'
+    INTO server_version_num;
+  IF server_version_num >= 110000 THEN
+    EXECUTE $repmgr_func$
+CREATE TABLE repmgr.monitoring_history (
+  primary_node_id                INTEGER NOT NULL,
+  standby_node_id                INTEGER NOT NULL,
+  last_monitor_time              TIMESTAMP WITH TIME ZONE NOT NULL,
+  last_apply_time                TIMESTAMP WITH TIME ZONE,
+  last_wal_primary_location      PG_LSN NOT NULL,
+  last_wal_standby_location      PG_LSN,
+  replication_lag                BIGINT NOT NULL,
+  apply_lag                      BIGINT NOT NULL
+) PARTITION BY RANGE (last_monitor_time)
+    $repmgr_func$;
+    /* catches any rows written before daily partitions have been created */
+    EXECUTE $repmgr_func$
+CREATE TABLE repmgr.monitoring_history_default
+  PARTITION OF repmgr.monitoring_history DEFAULT
+    $repmgr_func$;
+  ELSIF server_version_num >= 90400 THEN
+    EXECUTE $repmgr_func$
+CREATE TABLE repmgr.monitoring_history (
+  primary_node_id                INTEGER NOT NULL,
+  standby_node_id                INTEGER NOT NULL,
+  last_monitor_time              TIMESTAMP WITH TIME ZONE NOT NULL,
+  last_apply_time                TIMESTAMP WITH TIME ZONE,
+  last_wal_primary_location      PG_LSN NOT NULL,
+  last_wal_standby_location      PG_LSN,
+  replication_lag                BIGINT NOT NULL,
+  apply_lag                      BIGINT NOT NULL
+)
+    $repmgr_func$;
+  ELSE
+    EXECUTE $repmgr_func$
+CREATE TABLE repmgr.monitoring_history (
+  primary_node_id                INTEGER NOT NULL,
+  standby_node_id                INTEGER NOT NULL,
+  last_monitor_time              TIMESTAMP WITH TIME ZONE NOT NULL,
+  last_apply_time                TIMESTAMP WITH TIME ZONE,
+  last_wal_primary_location      TEXT NOT NULL,
+  last_wal_standby_location      TEXT,
+  replication_lag                BIGINT NOT NULL,
+  apply_lag                      BIGINT NOT NULL
+)
+    $repmgr_func$;
+  END IF;
+END$repmgr$;
+
+
+
+CREATE INDEX idx_monitoring_history_time
+          ON repmgr.monitoring_history (last_monitor_time, standby_node_id);
+
+CREATE VIEW repmgr.show_nodes AS
+   SELECT n.node_id,
+          n.node_name,
+          n.active,
+          n.upstream_node_id,
+          un.node_name AS upstream_node_name,
+          n.type,
+          n.priority,
+          n.conninfo
+     FROM repmgr.nodes n
+LEFT JOIN repmgr.nodes un
+       ON un.node_id = n.upstream_node_id;
+
+
+/* XXX update upgrade scripts! */
+CREATE TABLE repmgr.voting_term (
+  term INT NOT NULL
+);
+
+CREATE UNIQUE INDEX voting_term_restrict
+ON repmgr.voting_term ((TRUE));
+
+CREATE RULE voting_term_delete AS
+   ON DELETE TO repmgr.voting_term
+   DO INSTEAD NOTHING;
+
+
+/* ================= */
+/* repmgrd functions */
+/* ================= */
+
+/* monitoring functions */
+
+CREATE FUNCTION set_local_node_id(INT)
+  RETURNS VOID
+  AS 'MODULE_PATHNAME', 'set_local_node_id'
+  LANGUAGE C STRICT;
+
+CREATE FUNCTION get_local_node_id()
+  RETURNS INT
+  AS 'MODULE_PATHNAME', 'get_local_node_id'
+  LANGUAGE C STRICT;
+
+CREATE FUNCTION standby_set_last_updated()
+  RETURNS TIMESTAMP WITH TIME ZONE
+  AS 'MODULE_PATHNAME', 'standby_set_last_updated'
+  LANGUAGE C STRICT;
+
+CREATE FUNCTION standby_get_last_updated()
+  RETURNS TIMESTAMP WITH TIME ZONE
+  AS 'MODULE_PATHNAME', 'standby_get_last_updated'
+  LANGUAGE C STRICT;
+
+CREATE FUNCTION set_upstream_last_seen()
+  RETURNS VOID
+  AS 'MODULE_PATHNAME', 'set_upstream_last_seen'
+  LANGUAGE C STRICT;
+
+CREATE FUNCTION get_upstream_last_seen()
+  RETURNS INT
+  AS 'MODULE_PATHNAME', 'get_upstream_last_seen'
+  LANGUAGE C STRICT;
+
+CREATE FUNCTION set_election_state(INT, INT)
+  RETURNS VOID
+  AS 'MODULE_PATHNAME', 'set_election_state'
+  LANGUAGE C STRICT;
+
+CREATE FUNCTION get_election_state(
+  OUT repmgrd_pid INT,
+  OUT repmgrd_paused BOOL,
+  OUT in_recovery BOOL,
+  OUT last_wal_receive_lsn TEXT,
+  OUT last_wal_replay_lsn TEXT,
+  OUT wal_replay_paused BOOL,
+  OUT upstream_last_seen INT,
+  OUT current_electoral_term INT,
+  OUT priority INT)
+  RETURNS RECORD
+  AS 'MODULE_PATHNAME', 'get_election_state'
+  LANGUAGE C STRICT;
+
+CREATE FUNCTION bump_node_records_version()
+  RETURNS VOID
+  AS 'MODULE_PATHNAME', 'bump_node_records_version'
+  LANGUAGE C STRICT;
+
+CREATE FUNCTION get_node_records_version()
+  RETURNS BIGINT
+  AS 'MODULE_PATHNAME', 'get_node_records_version'
+  LANGUAGE C STRICT;
+
+CREATE FUNCTION set_storage_latency(INT, BIGINT, BIGINT, BIGINT[], BOOL)
+  RETURNS VOID
+  AS 'MODULE_PATHNAME', 'set_storage_latency'
+  LANGUAGE C STRICT;
+
+CREATE FUNCTION get_storage_latency(
+  OUT probe TEXT,
+  OUT samples BIGINT,
+  OUT p50_us BIGINT,
+  OUT p99_us BIGINT,
+  OUT max_us BIGINT,
+  OUT degraded BOOL,
+  OUT last_updated TIMESTAMP WITH TIME ZONE)
+  RETURNS SETOF RECORD
+  AS 'MODULE_PATHNAME', 'get_storage_latency'
+  LANGUAGE C STRICT;
+
+CREATE FUNCTION get_storage_latency_histogram(
+  OUT probe TEXT,
+  OUT lower_us BIGINT,
+  OUT upper_us BIGINT,
+  OUT count BIGINT)
+  RETURNS SETOF RECORD
+  AS 'MODULE_PATHNAME', 'get_storage_latency_histogram'
+  LANGUAGE C STRICT;
+
+CREATE FUNCTION record_replication_sample()
+  RETURNS BOOL
+  AS 'MODULE_PATHNAME', 'record_replication_sample'
+  LANGUAGE C STRICT;
+
+CREATE FUNCTION get_replication_samples(
+  OUT sample_time TIMESTAMP WITH TIME ZONE,
+  OUT last_wal_receive_lsn TEXT,
+  OUT last_wal_replay_lsn TEXT,
+  OUT lag_bytes BIGINT,
+  OUT upstream_last_seen INT)
+  RETURNS SETOF RECORD
+  AS 'MODULE_PATHNAME', 'get_replication_samples'
+  LANGUAGE C STRICT;
+
+
+/* failover functions */
+
+CREATE FUNCTION notify_follow_primary(INT)
+  RETURNS VOID
+  AS 'MODULE_PATHNAME', 'notify_follow_primary'
+  LANGUAGE C STRICT;
+
+CREATE FUNCTION get_new_primary()
+  RETURNS INT
+  AS 'MODULE_PATHNAME', 'get_new_primary'
+  LANGUAGE C STRICT;
+
+CREATE FUNCTION reset_voting_status()
+  RETURNS VOID
+  AS 'MODULE_PATHNAME', 'reset_voting_status'
+  LANGUAGE C STRICT;
+
+CREATE FUNCTION am_bdr_failover_handler(INT)
+  RETURNS BOOL
+  AS 'MODULE_PATHNAME', 'am_bdr_failover_handler'
+  LANGUAGE C STRICT;
+
+CREATE FUNCTION unset_bdr_failover_handler()
+  RETURNS VOID
+  AS 'MODULE_PATHNAME', 'unset_bdr_failover_handler'
+  LANGUAGE C STRICT;
+
+CREATE FUNCTION get_repmgrd_pid()
+  RETURNS INT
+  AS 'MODULE_PATHNAME', 'get_repmgrd_pid'
+  LANGUAGE C STRICT;
+
+CREATE FUNCTION get_repmgrd_pidfile()
+  RETURNS TEXT
+  AS 'MODULE_PATHNAME', 'get_repmgrd_pidfile'
+  LANGUAGE C STRICT;
+
+CREATE FUNCTION set_repmgrd_pid(INT, TEXT)
+  RETURNS VOID
+  AS 'MODULE_PATHNAME', 'set_repmgrd_pid'
+  LANGUAGE C STRICT;
+
+CREATE FUNCTION repmgrd_is_running()
+  RETURNS BOOL
+  AS 'MODULE_PATHNAME', 'repmgrd_is_running'
+  LANGUAGE C STRICT;
+
+CREATE FUNCTION repmgrd_pause(BOOL)
+  RETURNS VOID
+  AS 'MODULE_PATHNAME', 'repmgrd_pause'
+  LANGUAGE C STRICT;
+
+CREATE FUNCTION repmgrd_is_paused()
+  RETURNS BOOL
+  AS 'MODULE_PATHNAME', 'repmgrd_is_paused'
+  LANGUAGE C STRICT;
+
+CREATE FUNCTION get_wal_receiver_pid()
+  RETURNS INT
+  AS 'MODULE_PATHNAME', 'get_wal_receiver_pid'
+  LANGUAGE C STRICT;
+
+/* monitoring history partition management (PostgreSQL 11 and later) */
+
+CREATE FUNCTION monitoring_history_is_partitioned()
+  RETURNS BOOL
+  AS $repmgr_func$
+    SELECT EXISTS (
+      SELECT 1
+        FROM pg_catalog.pg_class c
+        JOIN pg_catalog.pg_namespace n ON n.oid = c.relnamespace
+       WHERE n.nspname = 'repmgr'
+         AND c.relname = 'monitoring_history'
+         AND c.relkind = 'p')
+  $repmgr_func$
+  LANGUAGE SQL STABLE;
+
+CREATE FUNCTION monitoring_history_create_partitions(days_ahead INT)
+  RETURNS INT
+  AS $repmgr_func$
+DECLARE
+  partition_start TIMESTAMP WITH TIME ZONE;
+  partition_name TEXT;
+  partitions_created INT := 0;
+BEGIN
+  IF NOT repmgr.monitoring_history_is_partitioned() THEN
+    RETURN 0;
+  END IF;
+
+  FOR i IN 0..days_ahead LOOP
+    partition_start := pg_catalog.date_trunc('day', pg_catalog.now()) + i * INTERVAL '1 day';
+    partition_name := 'monitoring_history_' || pg_catalog.to_char(partition_start, 'YYYYMMDD');
+
+    CONTINUE WHEN EXISTS (
+      SELECT 1
+        FROM pg_catalog.pg_class c
+        JOIN pg_catalog.pg_namespace n ON n.oid = c.relnamespace
+       WHERE n.nspname = 'repmgr'
+         AND c.relname = partition_name);
+
+    BEGIN
+      EXECUTE pg_catalog.format(
+        'CREATE TABLE repmgr.%I PARTITION OF repmgr.monitoring_history FOR VALUES FROM (%L) TO (%L)',
+        partition_name, partition_start, partition_start + INTERVAL '1 day');
+      partitions_created := partitions_created + 1;
+    EXCEPTION
+      /* created concurrently, or the default partition already holds rows for this day */
+      WHEN duplicate_table OR check_violation THEN
+        RAISE WARNING 'unable to create partition "%"', partition_name
+          USING DETAIL = SQLERRM;
+    END;
+  END LOOP;
+
+  RETURN partitions_created;
+END
+  $repmgr_func$
+  LANGUAGE plpgsql STRICT;
+
+CREATE FUNCTION monitoring_history_drop_partitions(keep_days INT)
+  RETURNS INT
+  AS $repmgr_func$
+DECLARE
+  cutoff TIMESTAMP WITH TIME ZONE := pg_catalog.now() - keep_days * INTERVAL '1 day';
+  partition_name TEXT;
+  partitions_dropped INT := 0;
+BEGIN
+  IF NOT repmgr.monitoring_history_is_partitioned() THEN
+    RETURN 0;
+  END IF;
+
+  FOR partition_name IN
+    SELECT c.relname
+      FROM pg_catalog.pg_inherits i
+      JOIN pg_catalog.pg_class c ON c.oid = i.inhrelid
+     WHERE i.inhparent = 'repmgr.monitoring_history'::pg_catalog.regclass
+       AND c.relname ~ '^monitoring_history_[0-9]{8}$'
+       AND pg_catalog.to_date(pg_catalog.substr(c.relname, 20), 'YYYYMMDD') + 1 <= cutoff
+  LOOP
+    EXECUTE pg_catalog.format('DROP TABLE repmgr.%I', partition_name);
+    partitions_dropped := partitions_dropped + 1;
+  END LOOP;
+
+  /*
+   * Remove expired rows from the partition spanning the cutoff, and from the
+   * default partition; the cutoff is passed as a literal so that all other
+   * partitions are pruned.
+   */
+  EXECUTE pg_catalog.format(
+    'DELETE FROM repmgr.monitoring_history WHERE last_monitor_time <= %L',
+    cutoff);
+
+  RETURN partitions_dropped;
+END
+  $repmgr_func$
+  LANGUAGE plpgsql STRICT;
+
+
+
+
+/* views */
+
+CREATE VIEW repmgr.replication_status AS
+  SELECT m.primary_node_id, m.standby_node_id, n.node_name AS standby_name,
+ 	     n.type AS node_type, n.active, last_monitor_time,
+         CASE WHEN n.type='standby' THEN m.last_wal_primary_location ELSE NULL END AS last_wal_primary_location,
+         m.last_wal_standby_location,
+         CASE WHEN n.type='standby' THEN pg_catalog.pg_size_pretty(m.replication_lag) ELSE NULL END AS replication_lag,
+         CASE WHEN n.type='standby' THEN
+           CASE WHEN replication_lag > 0 THEN age(now(), m.last_apply_time) ELSE '0'::INTERVAL END
+           ELSE NULL
+         END AS replication_time_lag,
+         CASE WHEN n.type='standby' THEN pg_catalog.pg_size_pretty(m.apply_lag) ELSE NULL END AS apply_lag,
+         AGE(NOW(), CASE WHEN pg_catalog.pg_is_in_recovery() THEN repmgr.standby_get_last_updated() ELSE m.last_monitor_time END) AS communication_time_lag
+    FROM repmgr.monitoring_history m
+    JOIN repmgr.nodes n ON m.standby_node_id = n.node_id
+   WHERE (m.standby_node_id, m.last_monitor_time) IN (
+	          SELECT m1.standby_node_id, MAX(m1.last_monitor_time)
+			    FROM repmgr.monitoring_history m1 GROUP BY 1
+         );
+
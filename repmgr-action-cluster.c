@@ -54,14 +54,36 @@ typedef enum
 }			EventHeader;
 
 
+/*
+ * State needed to process the output of a remote "cluster show" or
+ * "cluster matrix" command as soon as it completes
+ */
+typedef struct
+{
+	int			node_id;
+	t_node_status_matrix *matrix;
+	ItemList   *warnings;
+	int		   *error_code;
+} t_cluster_command_context;
+
+
 struct ColHeader headers_show[SHOW_HEADER_COUNT];
 struct ColHeader headers_event[EVENT_HEADER_COUNT];
 
 
 
-static int	build_cluster_matrix(t_node_matrix_rec ***matrix_rec_dest, int *name_length, ItemList *warnings, int *error_code);
-static int	build_cluster_crosscheck(t_node_status_cube ***cube_dest, int *name_length, ItemList *warnings, int *error_code);
-static void cube_set_node_status(t_node_status_cube **cube, int n, int node_id, int matrix_node_id, int connection_node_id, int connection_status);
+static int	build_cluster_matrix(t_node_status_matrix *matrix, int *name_length, ItemList *warnings, int *error_code);
+static int	build_cluster_crosscheck(t_node_status_matrix *cube, int *name_length, ItemList *warnings, int *error_code);
+static void init_node_status_matrix(t_node_status_matrix *matrix, NodeInfoList *nodes, int dimensions, int *name_length);
+static void free_node_status_matrix(t_node_status_matrix *matrix);
+static int	node_status_matrix_index(t_node_status_matrix *matrix, int node_id);
+static int	compare_node_id_index(const void *a, const void *b);
+static void matrix_set_node_status(t_node_status_matrix *matrix, int node_id, int connection_node_id, int connection_status);
+static void matrix_command_completed(t_remote_command *command);
+static void crosscheck_command_completed(t_remote_command *command);
+static bool cluster_command_failed(t_remote_command *command, t_cluster_command_context *context);
+static void make_cluster_ssh_options(PQExpBufferData *ssh_options);
+static void cube_set_node_status(t_node_status_matrix *cube, int node_id, int matrix_node_id, int connection_node_id, int connection_status);
 
 /*
  * CLUSTER SHOW
@@ -85,6 +107,8 @@ do_cluster_show(void)
     char lag_str[MAXLEN];
     XLogRecPtr  primary_last_wal_location = InvalidXLogRecPtr;
     long long unsigned int replication_lag_bytes = 0;
+	instr_time	probe_start;
+	instr_time	probe_elapsed;
 
 	/* Connect to local database to obtain cluster connection data */
 	log_verbose(LOG_INFO, _("connecting to database"));
@@ -151,26 +175,47 @@ do_cluster_show(void)
 		}
 	}
 
+	/*
+	 * Probe all nodes concurrently, so the time taken is determined by the
+	 * slowest node (bounded by --timeout) rather than by the number of nodes.
+	 * The recovery type and WAL replay pause state are taken from the
+	 * replication info, to avoid further round trips.
+	 */
+	INSTR_TIME_SET_CURRENT(probe_start);
+
+	establish_db_connections_concurrently_quiet(&nodes, runtime_options.timeout * 1000);
+
+	INSTR_TIME_SET_CURRENT(probe_elapsed);
+	INSTR_TIME_SUBTRACT(probe_elapsed, probe_start);
+
+	/* allow the queries a moment to complete, even if the timeout was reached */
+	get_replication_info_concurrently(&nodes,
+									  Max(runtime_options.timeout * 1000 - (int) INSTR_TIME_GET_MILLISEC(probe_elapsed), 100));
+
 	for (cell = nodes.head; cell; cell = cell->next)
 	{
 		PQExpBufferData details;
 		PQExpBufferData buf;
 
-		cell->node_info->conn = establish_db_connection_quiet(cell->node_info->conninfo);
-        /* highgo: get replication info. */
-	//	get_replication_info(cell->node_info->conn, cell->node_info->type,&cell->replinfo);
-
 		if (PQstatus(cell->node_info->conn) == CONNECTION_OK)
 		{
 			cell->node_info->node_status = NODE_STATUS_UP;
-			cell->node_info->recovery_type = get_recovery_type(cell->node_info->conn);
-			/* highgo: get replication info. */
-			get_replication_info(cell->node_info->conn, cell->node_info->type,&cell->replinfo);
+
+			/* highgo: replication info */
+			if (cell->replinfo_valid == false)
+				cell->node_info->recovery_type = RECTYPE_UNKNOWN;
+			else if (cell->replinfo.in_recovery == true)
+				cell->node_info->recovery_type = RECTYPE_STANDBY;
+			else
+				cell->node_info->recovery_type = RECTYPE_PRIMARY;
 		}
 		else
 		{
-			/* check if node is reachable, but just not letting us in */
-			if (is_server_available_quiet(cell->node_info->conninfo))
+			/*
+			 * Check if node is reachable, but just not letting us in; there's
+			 * no point in doing this if the connection attempt timed out.
+			 */
+			if (cell->node_info->conn != NULL && is_server_available_quiet(cell->node_info->conninfo))
 				cell->node_info->node_status = NODE_STATUS_REJECTED;
 			else
 				cell->node_info->node_status = NODE_STATUS_DOWN;
@@ -179,7 +224,14 @@ do_cluster_show(void)
 
 			connection_error_found = true;
 
-			if (runtime_options.verbose)
+			if (cell->node_info->conn == NULL)
+			{
+				item_list_append_format(&warnings,
+										"node \"%s\" (ID: %i) did not respond within %i seconds",
+										cell->node_info->node_name, cell->node_info->node_id,
+										runtime_options.timeout);
+			}
+			else if (runtime_options.verbose)
 			{
 				char		error[MAXLEN];
 
@@ -330,7 +382,9 @@ do_cluster_show(void)
 						}
 
 						/* warn about issue with paused WAL replay */
-						if (is_wal_replay_paused(cell->node_info->conn, true))
+						if (cell->replinfo_valid == true &&
+							cell->replinfo.wal_replay_paused == true &&
+							cell->replinfo.last_wal_replay_lsn < cell->replinfo.last_wal_receive_lsn)
 						{
 							item_list_append_format(&warnings,
 													_("WAL replay is paused on node \"%s\" (ID: %i) with WAL replay pending; this node cannot be manually promoted until WAL replay is resumed"),
@@ -756,7 +810,7 @@ do_cluster_crosscheck(void)
 	const char *node_header = "Name";
 	int			name_length = strlen(node_header);
 
-	t_node_status_cube **cube;
+	t_node_status_matrix cube;
 
 	bool		connection_error_found = false;
 	int			error_code = SUCCESS;
@@ -776,14 +830,14 @@ do_cluster_crosscheck(void)
 
 				for (node_ix = 0; node_ix < n; node_ix++)
 				{
-					int			node_status = cube[node_ix]->matrix_list_rec[i]->node_status_list[j]->node_status;
+					int			node_status = CUBE_NODE_STATUS(&cube, node_ix, i, j);
 
 					if (node_status > max_node_status)
 						max_node_status = node_status;
 				}
 				printf("%i,%i,%i\n",
-					   cube[i]->node_id,
-					   cube[j]->node_id,
+					   cube.nodes[i].node_id,
+					   cube.nodes[j].node_id,
 					   max_node_status);
 
 				if (max_node_status == -1)
@@ -798,7 +852,7 @@ do_cluster_crosscheck(void)
 	{
 		printf("%*s | Id ", name_length, node_header);
 		for (i = 0; i < n; i++)
-			printf("| %2d ", cube[i]->node_id);
+			printf("| %2d ", cube.nodes[i].node_id);
 		printf("\n");
 
 		for (i = 0; i < name_length; i++)
@@ -813,8 +867,8 @@ do_cluster_crosscheck(void)
 			int			column_node_ix;
 
 			printf("%*s | %2d ", name_length,
-				   cube[i]->node_name,
-				   cube[i]->node_id);
+				   cube.nodes[i].node_name,
+				   cube.nodes[i].node_id);
 
 			for (column_node_ix = 0; column_node_ix < n; column_node_ix++)
 			{
@@ -837,7 +891,7 @@ do_cluster_crosscheck(void)
 
 				for (node_ix = 0; node_ix < n; node_ix++)
 				{
-					int			node_status = cube[node_ix]->matrix_list_rec[i]->node_status_list[column_node_ix]->node_status;
+					int			node_status = CUBE_NODE_STATUS(&cube, node_ix, i, column_node_ix);
 
 					if (node_status > max_node_status)
 						max_node_status = node_status;
@@ -874,29 +928,7 @@ do_cluster_crosscheck(void)
 
 	}
 
-	/* clean up allocated cube array */
-	{
-		int			h,
-					j;
-
-		for (h = 0; h < n; h++)
-		{
-			for (i = 0; i < n; i++)
-			{
-				for (j = 0; j < n; j++)
-				{
-					free(cube[h]->matrix_list_rec[i]->node_status_list[j]);
-				}
-				free(cube[h]->matrix_list_rec[i]->node_status_list);
-				free(cube[h]->matrix_list_rec[i]);
-			}
-
-			free(cube[h]->matrix_list_rec);
-			free(cube[h]);
-		}
-
-		free(cube);
-	}
+	free_node_status_matrix(&cube);
 
 	/* errors detected by build_cluster_crosscheck() have priority */
 	if (connection_error_found == true)
@@ -925,13 +957,13 @@ do_cluster_matrix()
 	const char *node_header = "Name";
 	int			name_length = strlen(node_header);
 
-	t_node_matrix_rec **matrix_rec_list;
+	t_node_status_matrix matrix;
 
 	bool		connection_error_found = false;
 	int			error_code = SUCCESS;
 	ItemList	warnings = {NULL, NULL};
 
-	n = build_cluster_matrix(&matrix_rec_list, &name_length, &warnings, &error_code);
+	n = build_cluster_matrix(&matrix, &name_length, &warnings, &error_code);
 
 	if (runtime_options.output_mode == OM_CSV)
 	{
@@ -940,12 +972,12 @@ do_cluster_matrix()
 			for (j = 0; j < n; j++)
 			{
 				printf("%d,%d,%d\n",
-					   matrix_rec_list[i]->node_id,
-					   matrix_rec_list[i]->node_status_list[j]->node_id,
-					   matrix_rec_list[i]->node_status_list[j]->node_status);
+					   matrix.nodes[i].node_id,
+					   matrix.nodes[j].node_id,
+					   MATRIX_NODE_STATUS(&matrix, i, j));
 
-				if (matrix_rec_list[i]->node_status_list[j]->node_status == -2
-					|| matrix_rec_list[i]->node_status_list[j]->node_status == -1)
+				if (MATRIX_NODE_STATUS(&matrix, i, j) == -2
+					|| MATRIX_NODE_STATUS(&matrix, i, j) == -1)
 				{
 					connection_error_found = true;
 				}
@@ -958,7 +990,7 @@ do_cluster_matrix()
 
 		printf("%*s | Id ", name_length, node_header);
 		for (i = 0; i < n; i++)
-			printf("| %2d ", matrix_rec_list[i]->node_id);
+			printf("| %2d ", matrix.nodes[i].node_id);
 		printf("\n");
 
 		for (i = 0; i < name_length; i++)
@@ -971,11 +1003,11 @@ do_cluster_matrix()
 		for (i = 0; i < n; i++)
 		{
 			printf("%*s | %2d ", name_length,
-				   matrix_rec_list[i]->node_name,
-				   matrix_rec_list[i]->node_id);
+				   matrix.nodes[i].node_name,
+				   matrix.nodes[i].node_id);
 			for (j = 0; j < n; j++)
 			{
-				switch (matrix_rec_list[i]->node_status_list[j]->node_status)
+				switch (MATRIX_NODE_STATUS(&matrix, i, j))
 				{
 					case -2:
 						c = '?';
@@ -988,7 +1020,7 @@ do_cluster_matrix()
 						c = '*';
 						break;
 					default:
-						log_error("unexpected node status value %i", matrix_rec_list[i]->node_status_list[j]->node_status);
+						log_error("unexpected node status value %i", MATRIX_NODE_STATUS(&matrix, i, j));
 						exit(ERR_INTERNAL);
 				}
 
@@ -1005,17 +1037,7 @@ do_cluster_matrix()
 
 	}
 
-	for (i = 0; i < n; i++)
-	{
-		for (j = 0; j < n; j++)
-		{
-			free(matrix_rec_list[i]->node_status_list[j]);
-		}
-		free(matrix_rec_list[i]->node_status_list);
-		free(matrix_rec_list[i]);
-	}
-
-	free(matrix_rec_list);
+	free_node_status_matrix(&matrix);
 
 	/* actual database connection errors have priority */
 	if (connection_error_found == true)
@@ -1027,45 +1049,139 @@ do_cluster_matrix()
 }
 
 
+/*
+ * Allocate a matrix (dimensions == 2) or cube (dimensions == 3) for the
+ * provided nodes, with all entries set to "unknown"
+ */
 static void
-matrix_set_node_status(t_node_matrix_rec **matrix_rec_list, int n, int node_id, int connection_node_id, int connection_status)
+init_node_status_matrix(t_node_status_matrix *matrix, NodeInfoList *nodes, int dimensions, int *name_length)
 {
-	int			i,
-				j;
+	NodeInfoListCell *cell = NULL;
+	int			entry_count = 1;
+	int			i = 0;
+
+	matrix->node_count = nodes->node_count;
+	matrix->nodes = (t_node_matrix_node *) pg_malloc0(sizeof(t_node_matrix_node) * nodes->node_count);
+	matrix->node_index = (t_node_id_index *) pg_malloc0(sizeof(t_node_id_index) * nodes->node_count);
 
-	for (i = 0; i < n; i++)
+	for (cell = nodes->head; cell; cell = cell->next)
 	{
-		if (matrix_rec_list[i]->node_id == node_id)
-		{
-			for (j = 0; j < n; j++)
-			{
-				if (matrix_rec_list[i]->node_status_list[j]->node_id == connection_node_id)
-				{
-					matrix_rec_list[i]->node_status_list[j]->node_status = connection_status;
-					break;
-				}
-			}
-			break;
-		}
+		int			name_length_cur;
+
+		matrix->nodes[i].node_id = cell->node_info->node_id;
+		strncpy(matrix->nodes[i].node_name,
+				cell->node_info->node_name,
+				sizeof(matrix->nodes[i].node_name) - 1);
+
+		matrix->node_index[i].node_id = cell->node_info->node_id;
+		matrix->node_index[i].node_ix = i;
+
+		/*
+		 * Find the maximum length of a node name
+		 */
+		name_length_cur = strlen(matrix->nodes[i].node_name);
+		if (name_length_cur > *name_length)
+			*name_length = name_length_cur;
+
+		i++;
 	}
+
+	qsort(matrix->node_index, matrix->node_count, sizeof(t_node_id_index), compare_node_id_index);
+
+	for (i = 0; i < dimensions; i++)
+		entry_count *= matrix->node_count;
+
+	matrix->node_status = (int *) pg_malloc(sizeof(int) * entry_count);
+
+	for (i = 0; i < entry_count; i++)
+		matrix->node_status[i] = -2;
+}
+
+
+static void
+free_node_status_matrix(t_node_status_matrix *matrix)
+{
+	pfree(matrix->nodes);
+	pfree(matrix->node_index);
+	pfree(matrix->node_status);
+
+	matrix->nodes = NULL;
+	matrix->node_index = NULL;
+	matrix->node_status = NULL;
+	matrix->node_count = 0;
+}
+
+
+/*
+ * Return the index of the specified node in the matrix, or -1 if it is
+ * not present (e.g. an ID returned by a node with a different view of
+ * the cluster)
+ */
+static int
+node_status_matrix_index(t_node_status_matrix *matrix, int node_id)
+{
+	t_node_id_index key;
+	t_node_id_index *entry = NULL;
+
+	key.node_id = node_id;
+
+	entry = (t_node_id_index *) bsearch(&key,
+										matrix->node_index,
+										matrix->node_count,
+										sizeof(t_node_id_index),
+										compare_node_id_index);
+
+	if (entry == NULL)
+		return -1;
+
+	return entry->node_ix;
 }
 
 
 static int
-build_cluster_matrix(t_node_matrix_rec ***matrix_rec_dest, int *name_length, ItemList *warnings, int *error_code)
+compare_node_id_index(const void *a, const void *b)
+{
+	int			node_id_a = ((const t_node_id_index *) a)->node_id;
+	int			node_id_b = ((const t_node_id_index *) b)->node_id;
+
+	if (node_id_a < node_id_b)
+		return -1;
+
+	if (node_id_a > node_id_b)
+		return 1;
+
+	return 0;
+}
+
+
+static void
+matrix_set_node_status(t_node_status_matrix *matrix, int node_id, int connection_node_id, int connection_status)
+{
+	int			i = node_status_matrix_index(matrix, node_id);
+	int			j = node_status_matrix_index(matrix, connection_node_id);
+
+	if (i < 0 || j < 0)
+		return;
+
+	MATRIX_NODE_STATUS(matrix, i, j) = connection_status;
+}
+
+
+static int
+build_cluster_matrix(t_node_status_matrix *matrix, int *name_length, ItemList *warnings, int *error_code)
 {
 	PGconn	   *conn = NULL;
-	int			i = 0,
-				j = 0;
+	int			i = 0;
 	int			local_node_id = UNKNOWN_NODE_ID;
 	int			node_count = 0;
 	NodeInfoList nodes = T_NODE_INFO_LIST_INITIALIZER;
 	NodeInfoListCell *cell = NULL;
 
 	PQExpBufferData command;
-	PQExpBufferData command_output;
-
-	t_node_matrix_rec **matrix_rec_list;
+	PQExpBufferData ssh_options;
+	t_remote_command *commands = NULL;
+	t_cluster_command_context *contexts = NULL;
+	int			command_count = 0;
 
 	/* obtain node list from the database */
 	log_info(_("connecting to database"));
@@ -1097,103 +1213,40 @@ build_cluster_matrix(t_node_matrix_rec ***matrix_rec_dest, int *name_length, Ite
 		exit(ERR_BAD_CONFIG);
 	}
 
+	init_node_status_matrix(matrix, &nodes, 2, name_length);
+
 	/*
-	 * Allocate an empty matrix record list
-	 *
-	 * -2 == NULL  ? -1 == Error x 0 == OK
+	 * Check the local node's connections to all nodes concurrently, then
+	 * fetch `repmgr cluster show --csv` output from each reachable node
+	 * in parallel.
 	 */
+	establish_db_connections_concurrently_quiet(&nodes, CLUSTER_SHOW_TIMEOUT * 1000);
 
-	matrix_rec_list = (t_node_matrix_rec **) pg_malloc0(sizeof(t_node_matrix_rec) * nodes.node_count);
-
-	i = 0;
-
-	/* Initialise matrix structure for each node */
-	for (cell = nodes.head; cell; cell = cell->next)
-	{
-		int			name_length_cur;
-		NodeInfoListCell *cell_j;
-
-		matrix_rec_list[i] = (t_node_matrix_rec *) pg_malloc0(sizeof(t_node_matrix_rec));
-
-		matrix_rec_list[i]->node_id = cell->node_info->node_id;
-		strncpy(matrix_rec_list[i]->node_name,
-				cell->node_info->node_name,
-				sizeof(cell->node_info->node_name));
-
-		/*
-		 * Find the maximum length of a node name
-		 */
-		name_length_cur = strlen(matrix_rec_list[i]->node_name);
-		if (name_length_cur > *name_length)
-			*name_length = name_length_cur;
-
-		matrix_rec_list[i]->node_status_list = (t_node_status_rec **) pg_malloc0(sizeof(t_node_status_rec) * nodes.node_count);
-
-		j = 0;
-
-		for (cell_j = nodes.head; cell_j; cell_j = cell_j->next)
-		{
-			matrix_rec_list[i]->node_status_list[j] = (t_node_status_rec *) pg_malloc0(sizeof(t_node_status_rec));
-			matrix_rec_list[i]->node_status_list[j]->node_id = cell_j->node_info->node_id;
-			matrix_rec_list[i]->node_status_list[j]->node_status = -2;	/* default unknown */
-
-			j++;
-		}
-
-		i++;
-	}
-
-	/* Fetch `repmgr cluster show --csv` output for each node */
-	i = 0;
+	commands = (t_remote_command *) pg_malloc0(sizeof(t_remote_command) * nodes.node_count);
+	contexts = (t_cluster_command_context *) pg_malloc0(sizeof(t_cluster_command_context) * nodes.node_count);
 
 	for (cell = nodes.head; cell; cell = cell->next)
 	{
 		int			connection_status = 0;
 		t_conninfo_param_list remote_conninfo = T_CONNINFO_PARAM_LIST_INITIALIZER;
-		char	   *host = NULL,
-				   *p = NULL;
 		int			connection_node_id = cell->node_info->node_id;
-		int			x,
-					y;
-		PGconn	   *node_conn = NULL;
-
-		initialize_conninfo_params(&remote_conninfo, false);
-		parse_conninfo_string(cell->node_info->conninfo,
-							  &remote_conninfo,
-							  NULL,
-							  false);
-
-		host = param_get(&remote_conninfo, "host");
-
-		node_conn = establish_db_connection_quiet(cell->node_info->conninfo);
 
 		connection_status =
-			(PQstatus(node_conn) == CONNECTION_OK) ? 0 : -1;
+			(PQstatus(cell->node_info->conn) == CONNECTION_OK) ? 0 : -1;
 
+		close_connection(&cell->node_info->conn);
 
-		matrix_set_node_status(matrix_rec_list,
-							   nodes.node_count,
+		matrix_set_node_status(matrix,
 							   local_node_id,
 							   connection_node_id,
 							   connection_status);
 
-
 		if (connection_status)
-		{
-			free_conninfo_params(&remote_conninfo);
-			PQfinish(node_conn);
-			node_conn = NULL;
 			continue;
-		}
 
 		/* We don't need to issue `cluster show --csv` for the local node */
 		if (connection_node_id == local_node_id)
-		{
-			free_conninfo_params(&remote_conninfo);
-			PQfinish(node_conn);
-			node_conn = NULL;
 			continue;
-		}
 
 		initPQExpBuffer(&command);
 
@@ -1211,65 +1264,47 @@ build_cluster_matrix(t_node_matrix_rec ***matrix_rec_dest, int *name_length, Ite
 
 		log_verbose(LOG_DEBUG, "build_cluster_matrix(): executing:\n  %s", command.data);
 
-		initPQExpBuffer(&command_output);
+		initialize_conninfo_params(&remote_conninfo, false);
+		parse_conninfo_string(cell->node_info->conninfo,
+							  &remote_conninfo,
+							  NULL,
+							  false);
 
-		(void) remote_command(host,
-							  runtime_options.remote_user,
-							  command.data,
-							  config_file_options.ssh_options,
-							  &command_output);
+		contexts[command_count].node_id = connection_node_id;
+		contexts[command_count].matrix = matrix;
+		contexts[command_count].warnings = warnings;
+		contexts[command_count].error_code = error_code;
 
-		p = command_output.data;
+		commands[command_count].host = pg_strdup(param_get(&remote_conninfo, "host"));
+		commands[command_count].command = pg_strdup(command.data);
+		commands[command_count].arg = &contexts[command_count];
+		command_count++;
 
 		termPQExpBuffer(&command);
+		free_conninfo_params(&remote_conninfo);
+	}
 
-		/* no output returned - probably SSH error */
-		if (p[0] == '\0' || p[0] == '\n')
-		{
-			item_list_append_format(warnings,
-									"node %i inaccessible via SSH",
-									connection_node_id);
-			*error_code = ERR_BAD_SSH;
-		}
-		else
-		{
-			for (j = 0; j < nodes.node_count; j++)
-			{
-				if (sscanf(p, "%d,%d", &x, &y) != 2)
-				{
-					matrix_set_node_status(matrix_rec_list,
-										   nodes.node_count,
-										   connection_node_id,
-										   x,
-										   -2);
-
-					item_list_append_format(warnings,
-											"unable to parse --csv output for node %i; output returned was:\n\"%s\"",
-											connection_node_id, p);
-					*error_code = ERR_INTERNAL;
-				}
-				else
-				{
-					matrix_set_node_status(matrix_rec_list,
-										   nodes.node_count,
-										   connection_node_id,
-										   x,
-										   (y == -1) ? -1 : 0);
-				}
+	initPQExpBuffer(&ssh_options);
+	make_cluster_ssh_options(&ssh_options);
 
-				while (*p && (*p != '\n'))
-					p++;
-				if (*p == '\n')
-					p++;
-			}
-		}
+	remote_commands_parallel(commands,
+							 command_count,
+							 runtime_options.remote_user,
+							 ssh_options.data,
+							 runtime_options.timeout_provided ? runtime_options.timeout : CLUSTER_MATRIX_TIMEOUT,
+							 matrix_command_completed);
 
-		termPQExpBuffer(&command_output);
-		PQfinish(node_conn);
-		free_conninfo_params(&remote_conninfo);
+	termPQExpBuffer(&ssh_options);
+
+	for (i = 0; i < command_count; i++)
+	{
+		pfree((char *) commands[i].host);
+		pfree((char *) commands[i].command);
+		termPQExpBuffer(&commands[i].output);
 	}
 
-	*matrix_rec_dest = matrix_rec_list;
+	pfree(commands);
+	pfree(contexts);
 
 	node_count = nodes.node_count;
 	clear_node_info_list(&nodes);
@@ -1279,16 +1314,15 @@ build_cluster_matrix(t_node_matrix_rec ***matrix_rec_dest, int *name_length, Ite
 
 
 static int
-build_cluster_crosscheck(t_node_status_cube ***dest_cube, int *name_length, ItemList *warnings, int *error_code)
+build_cluster_crosscheck(t_node_status_matrix *cube, int *name_length, ItemList *warnings, int *error_code)
 {
 	PGconn	   *conn = NULL;
-	int			h,
-				i,
-				j;
+	int			i;
 	NodeInfoList nodes = T_NODE_INFO_LIST_INITIALIZER;
 	NodeInfoListCell *cell = NULL;
-
-	t_node_status_cube **cube;
+	PQExpBufferData ssh_options;
+	t_remote_command *commands = NULL;
+	t_cluster_command_context *contexts = NULL;
 
 	int			node_count = 0;
 
@@ -1316,215 +1350,250 @@ build_cluster_crosscheck(t_node_status_cube ***dest_cube, int *name_length, Item
 		exit(ERR_BAD_CONFIG);
 	}
 
+	init_node_status_matrix(cube, &nodes, 3, name_length);
+
 	/*
-	 * Allocate an empty cube matrix structure
-	 *
-	 * -2 == NULL -1 == Error 0 == OK
+	 * Build the connection cube from `repmgr cluster matrix --csv` output
+	 * fetched from all nodes in parallel; the command is executed directly
+	 * on the local node.
 	 */
+	commands = (t_remote_command *) pg_malloc0(sizeof(t_remote_command) * nodes.node_count);
+	contexts = (t_cluster_command_context *) pg_malloc0(sizeof(t_cluster_command_context) * nodes.node_count);
 
-	cube = (t_node_status_cube **) pg_malloc(sizeof(t_node_status_cube *) * nodes.node_count);
-
-	h = 0;
+	i = 0;
 
 	for (cell = nodes.head; cell; cell = cell->next)
 	{
-		int			name_length_cur = 0;
-		NodeInfoListCell *cell_i = NULL;
+		PQExpBufferData command;
 
-		cube[h] = (t_node_status_cube *) pg_malloc(sizeof(t_node_status_cube));
-		cube[h]->node_id = cell->node_info->node_id;
-		strncpy(cube[h]->node_name, cell->node_info->node_name, sizeof(cell->node_info->node_name));
+		initPQExpBuffer(&command);
 
-		/*
-		 * Find the maximum length of a node name
-		 */
-		name_length_cur = strlen(cube[h]->node_name);
-		if (name_length_cur > *name_length)
-			*name_length = name_length_cur;
+		if (cell->node_info->node_id == config_file_options.node_id)
+		{
+			make_remote_repmgr_path(&command, cell->node_info);
 
-		cube[h]->matrix_list_rec = (t_node_matrix_rec **) pg_malloc(sizeof(t_node_matrix_rec) * nodes.node_count);
+			appendPQExpBufferStr(&command,
+								 " cluster matrix --csv -L NOTICE --terse");
 
-		i = 0;
-		for (cell_i = nodes.head; cell_i; cell_i = cell_i->next)
+			commands[i].host = NULL;
+		}
+		else
 		{
-			NodeInfoListCell *cell_j;
+			t_conninfo_param_list remote_conninfo = T_CONNINFO_PARAM_LIST_INITIALIZER;
 
-			cube[h]->matrix_list_rec[i] = (t_node_matrix_rec *) pg_malloc0(sizeof(t_node_matrix_rec));
-			cube[h]->matrix_list_rec[i]->node_id = cell_i->node_info->node_id;
+			appendPQExpBufferChar(&command, '"');
 
-			/* we don't need the name here */
-			cube[h]->matrix_list_rec[i]->node_name[0] = '\0';
+			make_remote_repmgr_path(&command, cell->node_info);
 
-			cube[h]->matrix_list_rec[i]->node_status_list = (t_node_status_rec **) pg_malloc0(sizeof(t_node_status_rec *) * nodes.node_count);
+			appendPQExpBufferStr(&command,
+								 " cluster matrix --csv -L NOTICE --terse\"");
 
-			j = 0;
+			initialize_conninfo_params(&remote_conninfo, false);
 
-			for (cell_j = nodes.head; cell_j; cell_j = cell_j->next)
-			{
-				cube[h]->matrix_list_rec[i]->node_status_list[j] = (t_node_status_rec *) pg_malloc0(sizeof(t_node_status_rec));
-				cube[h]->matrix_list_rec[i]->node_status_list[j]->node_id = cell_j->node_info->node_id;
-				cube[h]->matrix_list_rec[i]->node_status_list[j]->node_status = -2; /* default unknown */
+			parse_conninfo_string(cell->node_info->conninfo,
+								  &remote_conninfo,
+								  NULL,
+								  false);
 
-				j++;
-			}
+			commands[i].host = pg_strdup(param_get(&remote_conninfo, "host"));
 
-			i++;
+			free_conninfo_params(&remote_conninfo);
 		}
 
-		h++;
+		log_verbose(LOG_DEBUG, "build_cluster_crosscheck(): executing\n  %s", command.data);
+
+		contexts[i].node_id = cell->node_info->node_id;
+		contexts[i].matrix = cube;
+		contexts[i].warnings = warnings;
+		contexts[i].error_code = error_code;
+
+		commands[i].command = pg_strdup(command.data);
+		commands[i].arg = &contexts[i];
+
+		termPQExpBuffer(&command);
+
+		i++;
 	}
 
+	initPQExpBuffer(&ssh_options);
+	make_cluster_ssh_options(&ssh_options);
 
-	/*
-	 * Build the connection cube
-	 */
-	i = 0;
+	remote_commands_parallel(commands,
+							 nodes.node_count,
+							 runtime_options.remote_user,
+							 ssh_options.data,
+							 runtime_options.timeout_provided ? runtime_options.timeout : CLUSTER_CROSSCHECK_TIMEOUT,
+							 crosscheck_command_completed);
 
-	for (cell = nodes.head; cell; cell = cell->next)
+	termPQExpBuffer(&ssh_options);
+
+	for (i = 0; i < nodes.node_count; i++)
 	{
-		int			remote_node_id = UNKNOWN_NODE_ID;
-		PQExpBufferData command;
-		PQExpBufferData command_output;
+		if (commands[i].host != NULL)
+			pfree((char *) commands[i].host);
+		pfree((char *) commands[i].command);
+		termPQExpBuffer(&commands[i].output);
+	}
 
-		char	   *p = NULL;
+	pfree(commands);
+	pfree(contexts);
 
-		remote_node_id = cell->node_info->node_id;
+	node_count = nodes.node_count;
 
-		initPQExpBuffer(&command);
+	clear_node_info_list(&nodes);
 
-		make_remote_repmgr_path(&command, cell->node_info);
+	return node_count;
+}
 
-		appendPQExpBufferStr(&command,
-							 " cluster matrix --csv -L NOTICE --terse");
 
-		initPQExpBuffer(&command_output);
+/*
+ * Process the output of `repmgr cluster show --csv` executed on a node
+ */
+static void
+matrix_command_completed(t_remote_command *command)
+{
+	t_cluster_command_context *context = (t_cluster_command_context *) command->arg;
+	char	   *p = command->output.data;
+	int			x,
+				y;
+	int			j;
 
-		if (cube[i]->node_id == config_file_options.node_id)
+	if (cluster_command_failed(command, context) == true)
+		return;
+
+	for (j = 0; j < context->matrix->node_count; j++)
+	{
+		if (sscanf(p, "%d,%d", &x, &y) != 2)
 		{
-			(void) local_command_simple(command.data,
-										&command_output);
+			matrix_set_node_status(context->matrix,
+								   context->node_id,
+								   x,
+								   -2);
+
+			item_list_append_format(context->warnings,
+									"unable to parse --csv output for node %i; output returned was:\n\"%s\"",
+									context->node_id, p);
+			*context->error_code = ERR_INTERNAL;
 		}
 		else
 		{
-			t_conninfo_param_list remote_conninfo = T_CONNINFO_PARAM_LIST_INITIALIZER;
-			char	   *host = NULL;
-			PQExpBufferData quoted_command;
-
-			initPQExpBuffer(&quoted_command);
-			appendPQExpBuffer(&quoted_command,
-							  "\"%s\"",
-							  command.data);
+			matrix_set_node_status(context->matrix,
+								   context->node_id,
+								   x,
+								   (y == -1) ? -1 : 0);
+		}
 
-			initialize_conninfo_params(&remote_conninfo, false);
+		while (*p && (*p != '\n'))
+			p++;
+		if (*p == '\n')
+			p++;
+	}
+}
 
-			parse_conninfo_string(cell->node_info->conninfo,
-								  &remote_conninfo,
-								  NULL,
-								  false);
 
-			host = param_get(&remote_conninfo, "host");
+/*
+ * Process the output of `repmgr cluster matrix --csv` executed on a node
+ */
+static void
+crosscheck_command_completed(t_remote_command *command)
+{
+	t_cluster_command_context *context = (t_cluster_command_context *) command->arg;
+	char	   *p = command->output.data;
+	int			j;
 
-			log_verbose(LOG_DEBUG, "build_cluster_crosscheck(): executing\n  %s", quoted_command.data);
+	if (cluster_command_failed(command, context) == true)
+		return;
 
-			(void) remote_command(host,
-								  runtime_options.remote_user,
-								  quoted_command.data,
-								  config_file_options.ssh_options,
-								  &command_output);
+	for (j = 0; j < (context->matrix->node_count * context->matrix->node_count); j++)
+	{
+		int			matrix_rec_node_id;
+		int			node_status_node_id;
+		int			node_status;
 
-			free_conninfo_params(&remote_conninfo);
-			termPQExpBuffer(&quoted_command);
+		if (sscanf(p, "%d,%d,%d", &matrix_rec_node_id, &node_status_node_id, &node_status) != 3)
+		{
+			cube_set_node_status(context->matrix,
+								 context->node_id,
+								 matrix_rec_node_id,
+								 node_status_node_id,
+								 -2);
+			*context->error_code = ERR_INTERNAL;
 		}
-
-		termPQExpBuffer(&command);
-
-		p = command_output.data;
-
-		if (p[0] == '\0' || p[0] == '\n')
+		else
 		{
-			item_list_append_format(warnings,
-									"node %i inaccessible via SSH",
-									remote_node_id);
-			termPQExpBuffer(&command_output);
-			*error_code = ERR_BAD_SSH;
-			continue;
+			cube_set_node_status(context->matrix,
+								 context->node_id,
+								 matrix_rec_node_id,
+								 node_status_node_id,
+								 node_status);
 		}
 
-		for (j = 0; j < (nodes.node_count * nodes.node_count); j++)
-		{
-			int			matrix_rec_node_id;
-			int			node_status_node_id;
-			int			node_status;
+		while (*p && (*p != '\n'))
+			p++;
+		if (*p == '\n')
+			p++;
+	}
+}
 
-			if (sscanf(p, "%d,%d,%d", &matrix_rec_node_id, &node_status_node_id, &node_status) != 3)
-			{
-				cube_set_node_status(cube,
-									 nodes.node_count,
-									 remote_node_id,
-									 matrix_rec_node_id,
-									 node_status_node_id,
-									 -2);
-				*error_code = ERR_INTERNAL;
-			}
-			else
-			{
-				cube_set_node_status(cube,
-									 nodes.node_count,
-									 remote_node_id,
-									 matrix_rec_node_id,
-									 node_status_node_id,
-									 node_status);
-			}
 
-			while (*p && (*p != '\n'))
-				p++;
-			if (*p == '\n')
-				p++;
-		}
-		termPQExpBuffer(&command_output);
+/*
+ * Record a warning if the command timed out or returned no output
+ * (probably an SSH error)
+ */
+static bool
+cluster_command_failed(t_remote_command *command, t_cluster_command_context *context)
+{
+	if (command->completed == false)
+	{
+		item_list_append_format(context->warnings,
+								"node %i did not respond via SSH in time",
+								context->node_id);
+		*context->error_code = ERR_BAD_SSH;
+		return true;
+	}
 
-		i++;
+	if (command->output.data[0] == '\0' || command->output.data[0] == '\n')
+	{
+		item_list_append_format(context->warnings,
+								"node %i inaccessible via SSH",
+								context->node_id);
+		*context->error_code = ERR_BAD_SSH;
+		return true;
 	}
 
-	*dest_cube = cube;
+	return false;
+}
 
-	node_count = nodes.node_count;
 
-	clear_node_info_list(&nodes);
+/*
+ * "ssh_options", plus the options needed to share connections via
+ * ControlMaster sockets if "ssh_control_path" is set
+ */
+static void
+make_cluster_ssh_options(PQExpBufferData *ssh_options)
+{
+	appendPQExpBufferStr(ssh_options, config_file_options.ssh_options);
 
-	return node_count;
+	if (config_file_options.ssh_control_path[0] != '\0')
+	{
+		appendPQExpBuffer(ssh_options,
+						  " -o ControlMaster=auto -o ControlPersist=60 -o 'ControlPath=%s'",
+						  config_file_options.ssh_control_path);
+	}
 }
 
 
 static void
-cube_set_node_status(t_node_status_cube **cube, int n, int execute_node_id, int matrix_node_id, int connection_node_id, int connection_status)
+cube_set_node_status(t_node_status_matrix *cube, int execute_node_id, int matrix_node_id, int connection_node_id, int connection_status)
 {
-	int			h,
-				i,
-				j;
+	int			h = node_status_matrix_index(cube, execute_node_id);
+	int			i = node_status_matrix_index(cube, matrix_node_id);
+	int			j = node_status_matrix_index(cube, connection_node_id);
 
+	if (h < 0 || i < 0 || j < 0)
+		return;
 
-	for (h = 0; h < n; h++)
-	{
-		if (cube[h]->node_id == execute_node_id)
-		{
-			for (i = 0; i < n; i++)
-			{
-				if (cube[h]->matrix_list_rec[i]->node_id == matrix_node_id)
-				{
-					for (j = 0; j < n; j++)
-					{
-						if (cube[h]->matrix_list_rec[i]->node_status_list[j]->node_id == connection_node_id)
-						{
-							cube[h]->matrix_list_rec[i]->node_status_list[j]->node_status = connection_status;
-							break;
-						}
-					}
-					break;
-				}
-			}
-		}
-	}
+	CUBE_NODE_STATUS(cube, h, i, j) = connection_status;
 }
 
 
@@ -1533,7 +1602,8 @@ do_cluster_cleanup(void)
 {
 	PGconn	   *conn = NULL;
 	PGconn	   *primary_conn = NULL;
-	int			entries_to_delete = 0;
+	RecordStatus records_to_delete = RECORD_NOT_FOUND;
+	bool		partitioned = false;
 	PQExpBufferData event_details;
 
 	conn = establish_db_connection(config_file_options.conninfo, true);
@@ -1546,29 +1616,30 @@ do_cluster_cleanup(void)
 
 	log_debug(_("number of days of monitoring history to retain: %i"), runtime_options.keep_history);
 
-	entries_to_delete = get_number_of_monitoring_records_to_delete(primary_conn,
-																   runtime_options.keep_history,
-																   runtime_options.node_id);
+	records_to_delete = get_monitoring_records_to_delete(primary_conn,
+														 runtime_options.keep_history,
+														 runtime_options.node_id);
 
-	if (entries_to_delete < 0)
+	if (records_to_delete == RECORD_ERROR)
 	{
-		log_error(_("unable to query number of monitoring records to clean up"));
+		log_error(_("unable to query monitoring records to clean up"));
 		PQfinish(primary_conn);
 		exit(ERR_DB_QUERY);
 	}
-	else if (entries_to_delete == 0)
+	else if (records_to_delete == RECORD_NOT_FOUND)
 	{
 		log_info(_("no monitoring records to delete"));
 		PQfinish(primary_conn);
 		return;
 	}
 
-	log_debug("at least %i monitoring records for deletion",
-			  entries_to_delete);
+	partitioned = is_monitoring_history_partitioned(primary_conn);
+
+	log_debug("monitoring history is %spartitioned", partitioned == true ? "" : "not ");
 
 	initPQExpBuffer(&event_details);
 
-	if (delete_monitoring_records(primary_conn, runtime_options.keep_history, runtime_options.node_id) == false)
+	if (delete_monitoring_records(primary_conn, runtime_options.keep_history, runtime_options.node_id, partitioned) == false)
 	{
 		appendPQExpBufferStr(&event_details,
 						  _("unable to delete monitoring records"));
@@ -1587,7 +1658,11 @@ do_cluster_cleanup(void)
 		exit(ERR_DB_QUERY);
 	}
 
-	if (vacuum_table(primary_conn, "repmgr.monitoring_history") == false)
+	/*
+	 * Dropped partitions need no vacuuming, and vacuuming the partitioned
+	 * table would process every remaining partition.
+	 */
+	if (partitioned == false && vacuum_table(primary_conn, "repmgr.monitoring_history") == false)
 	{
 		/* annoying if this fails, but not fatal */
 		log_warning(_("unable to vacuum table \"repmgr.monitoring_history\""));
@@ -1653,6 +1728,7 @@ do_cluster_help(void)
 	puts("");
 	printf(_("    --csv                     emit output as CSV (with a subset of fields)\n"));
 	printf(_("    --compact                 display only a subset of fields\n"));
+	printf(_("    --timeout                 maximum number of seconds to wait for nodes to respond (default: %i)\n"), CLUSTER_SHOW_TIMEOUT);
 	puts("");
 
 	printf(_("CLUSTER MATRIX\n"));
@@ -1662,6 +1738,7 @@ do_cluster_help(void)
 	printf(_("  Configuration file or database connection required.\n"));
 	puts("");
 	printf(_("    --csv                     emit output as CSV\n"));
+	printf(_("    --timeout                 maximum number of seconds to wait for each node via SSH (default: %i)\n"), CLUSTER_MATRIX_TIMEOUT);
 	puts("");
 
 	printf(_("CLUSTER CROSSCHECK\n"));
@@ -1671,6 +1748,7 @@ do_cluster_help(void)
 	printf(_("  Configuration file or database connection required.\n"));
 	puts("");
 	printf(_("    --csv                     emit output as CSV\n"));
+	printf(_("    --timeout                 maximum number of seconds to wait for each node via SSH (default: %i)\n"), CLUSTER_CROSSCHECK_TIMEOUT);
 	puts("");
 
 
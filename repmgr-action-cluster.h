@@ -24,22 +24,36 @@
 typedef struct
 {
 	int			node_id;
-	int			node_status;
-} t_node_status_rec;
+	char		node_name[NAMEDATALEN];
+} t_node_matrix_node;
 
 typedef struct
 {
 	int			node_id;
-	char		node_name[NAMEDATALEN];
-	t_node_status_rec **node_status_list;
-} t_node_matrix_rec;
+	int			node_ix;
+} t_node_id_index;
 
+/*
+ * Connection status between each pair of nodes ("cluster matrix"), or
+ * between each pair of nodes as seen from each node ("cluster crosscheck"),
+ * stored in a single array addressed by node index; "node_index" is sorted
+ * by node ID to map IDs to indexes.
+ *
+ * -2 == unknown, -1 == error, 0 == OK
+ */
 typedef struct
 {
-	int			node_id;
-	char		node_name[NAMEDATALEN];
-	t_node_matrix_rec **matrix_list_rec;
-} t_node_status_cube;
+	int			node_count;
+	t_node_matrix_node *nodes;
+	t_node_id_index *node_index;
+	int		   *node_status;
+} t_node_status_matrix;
+
+#define MATRIX_NODE_STATUS(matrix, i, j) \
+	((matrix)->node_status[(i) * (matrix)->node_count + (j)])
+
+#define CUBE_NODE_STATUS(cube, h, i, j) \
+	((cube)->node_status[((h) * (cube)->node_count + (i)) * (cube)->node_count + (j)])
 
 
 
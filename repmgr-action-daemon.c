@@ -131,6 +131,13 @@ do_daemon_status(void)
 		repmgrd_info[i]->wal_paused_pending_wal = false;
 		repmgrd_info[i]->upstream_last_seen = -1;
 
+		for (j = 0; j < STORAGE_PROBE_TYPES; j++)
+		{
+			t_storage_latency storage_latency = T_STORAGE_LATENCY_INITIALIZER;
+
+			repmgrd_info[i]->storage_latency[j] = storage_latency;
+		}
+
 		cell->node_info->conn = establish_db_connection_quiet(cell->node_info->conninfo);
 
 		if (PQstatus(cell->node_info->conn) != CONNECTION_OK)
@@ -218,6 +225,8 @@ do_daemon_status(void)
 				}
 			}
 
+			(void) get_storage_latency(cell->node_info->conn, repmgrd_info[i]->storage_latency);
+
 			PQfinish(cell->node_info->conn);
 		}
 
@@ -261,6 +270,10 @@ do_daemon_status(void)
 		{
 			int running = repmgrd_info[i]->running ? 1 : 0;
 			int paused = repmgrd_info[i]->paused ? 1 : 0;
+			t_storage_latency *data_latency = &repmgrd_info[i]->storage_latency[STORAGE_PROBE_DATA_DIRECTORY];
+			t_storage_latency *wal_latency = &repmgrd_info[i]->storage_latency[STORAGE_PROBE_WAL_DIRECTORY];
+			int data_degraded = data_latency->valid == true ? (data_latency->degraded ? 1 : 0) : -1;
+			int wal_degraded = wal_latency->valid == true ? (wal_latency->degraded ? 1 : 0) : -1;
 
 			/* If PostgreSQL is not running, repmgrd status is unknown */
 			if (repmgrd_info[i]->pg_running == false)
@@ -269,7 +282,7 @@ do_daemon_status(void)
 				paused = -1;
 			}
 
-			printf("%i,%s,%s,%i,%i,%i,%i,%i,%i\n",
+			printf("%i,%s,%s,%i,%i,%i,%i,%i,%i," INT64_FORMAT "," INT64_FORMAT ",%i," INT64_FORMAT "," INT64_FORMAT ",%i\n",
 				   cell->node_info->node_id,
 				   cell->node_info->node_name,
 				   get_node_type_string(cell->node_info->type),
@@ -280,7 +293,13 @@ do_daemon_status(void)
 				   cell->node_info->priority,
 				   repmgrd_info[i]->pid == UNKNOWN_PID
 				     ? -1
-				     : repmgrd_info[i]->upstream_last_seen);
+				     : repmgrd_info[i]->upstream_last_seen,
+				   data_latency->p50_us,
+				   data_latency->p99_us,
+				   data_degraded,
+				   wal_latency->p50_us,
+				   wal_latency->p99_us,
+				   wal_degraded);
 		}
 		else
 		{
@@ -47,6 +47,77 @@ typedef struct TablespaceDataList
 	TablespaceDataListCell *tail;
 } TablespaceDataList;
 
+/* a set of files to be copied from the Barman server */
+typedef struct
+{
+	char		list_filename[MAXPGPATH];
+	char		remote_directory[MAXPGPATH];
+	char		local_directory[MAXPGPATH];
+	/* used by copy_barman_files() */
+	int			file_count;
+	long long	bytes;
+	int			first_worker;
+	int			worker_count;
+} t_copy_job;
+
+/* a file to be copied by copy_barman_files() */
+typedef struct
+{
+	char	   *path;
+	long long	size;
+	int			job;
+} t_copy_file;
+
+/* shared between the rsync processes started by copy_barman_files() */
+typedef struct
+{
+	long long	bytes_total;
+	long long	bytes_copied;
+	time_t		last_report;
+} t_copy_progress;
+
+/* one of the rsync processes started by copy_barman_files() */
+typedef struct
+{
+	int			job;
+	const char *local_directory;
+	t_copy_progress *progress;
+	long long	bytes;
+	int			files;
+	char		list_filename[MAXPGPATH];
+	FILE	   *list_file;
+	char		command[MAXLEN];
+} t_copy_worker;
+
+/* a file recorded in the clone manifest */
+typedef struct
+{
+	char	   *path;
+	long long	size;
+	long long	mtime;
+} t_manifest_entry;
+
+/* interval, in seconds, between progress reports during a copy */
+#define COPY_PROGRESS_INTERVAL 10
+
+/*
+ * Files are recorded in the clone manifest once the rsync process copying
+ * them has completed, so each process is given at most about this much
+ * data, which is all that would need to be copied again after an
+ * interruption
+ */
+#define COPY_BATCH_BYTES (4LL * 1024 * 1024 * 1024)
+
+/*
+ * Records the files copied from Barman, so an interrupted clone can be
+ * resumed; written in the data directory and removed once the clone is
+ * complete
+ */
+#define CLONE_MANIFEST_FILENAME "repmgr_clone.manifest"
+
+/* idle time, in seconds, after which the shared SSH connection to Barman exits */
+#define BARMAN_SSH_CONTROL_PERSIST 60
+
 
 static PGconn *primary_conn = NULL;
 static PGconn *source_conn = NULL;
@@ -69,10 +140,19 @@ static t_configfile_list config_files = T_CONFIGFILE_LIST_INITIALIZER;
 
 static standy_clone_mode mode = pg_basebackup;
 
+/* set if --delta-sync was provided and the existing data directory can be resynchronised */
+static bool delta_sync = false;
+
 /* used by barman mode */
 static char local_repmgr_tmp_directory[MAXPGPATH] = "";
 static char datadir_list_filename[MAXLEN] = "";
 static char barman_command_buf[MAXLEN] = "";
+static char barman_control_path[MAXPGPATH] = "";
+
+static char clone_manifest_path[MAXPGPATH] = "";
+static FILE *clone_manifest = NULL;
+static t_manifest_entry *manifest_entries = NULL;
+static int	manifest_entry_count = 0;
 
 static void _do_standby_promote_internal(PGconn *conn, int server_version_num);
 static void _do_create_recovery_conf(void);
@@ -86,6 +166,8 @@ static void check_recovery_type(PGconn *conn);
 
 static void initialise_direct_clone(t_node_info *node_record);
 static int	run_basebackup(t_node_info *node_record);
+static bool check_delta_sync(PQExpBufferData *reason);
+static int	run_delta_sync(void);
 static int	run_file_backup(t_node_info *node_record);
 
 static void copy_configuration_files(bool delete_after_copy);
@@ -95,6 +177,22 @@ static void tablespace_data_append(TablespaceDataList *list, const char *name, c
 static void get_barman_property(char *dst, char *name, char *local_repmgr_directory);
 static int	get_tablespace_data_barman(char *, TablespaceDataList *);
 static char *make_barman_ssh_command(char *buf);
+static void start_barman_ssh_master(void);
+static void stop_barman_ssh_master(void);
+static const char *barman_ssh_options(void);
+static const char *barman_rsync_options(void);
+static bool copy_barman_files(t_copy_job *jobs, int job_count);
+static bool open_clone_manifest(const char *backup_id);
+static bool clone_manifest_contains(const char *path);
+static void clone_manifest_record(const char *path);
+static void clone_manifest_sync(void);
+static void close_clone_manifest(bool remove_manifest);
+static int	compare_manifest_entry_path(const void *a, const void *b);
+static void copy_progress_output(t_remote_command *command);
+static void copy_worker_completed(t_remote_command *command);
+static int	compare_copy_file_path(const void *a, const void *b);
+static int	compare_copy_file_size(const void *a, const void *b);
+static int	compare_copy_worker_size(const void *a, const void *b);
 
 static bool create_recovery_file(t_node_info *node_record, t_conninfo_param_list *primary_conninfo, int server_version_num, char *dest, bool as_file);
 static void write_primary_conninfo(PQExpBufferData *dest, t_conninfo_param_list *param_list);
@@ -151,6 +249,31 @@ do_standby_clone(void)
 
 	mode = get_standby_clone_mode();
 
+	if (runtime_options.copy_parallelism > 1 && mode != barman &&
+		strcmp(runtime_options.compression_method, "zstd") != 0)
+	{
+		log_warning(_("--copy-parallelism is only applicable when cloning from Barman or with --compression=zstd"));
+	}
+
+	if (runtime_options.compression_method[0] != '\0' && mode == barman)
+	{
+		log_warning(_("--compression is not applicable when cloning from Barman"));
+	}
+
+	if (runtime_options.delta_sync == true && mode == barman)
+	{
+		log_error(_("--delta-sync cannot be used when cloning from Barman"));
+		log_hint(_("use --without-barman to clone directly from the upstream node"));
+		exit(ERR_BAD_CONFIG);
+	}
+
+	if (runtime_options.resume == true && mode != barman)
+	{
+		log_error(_("--resume can only be used when cloning from Barman"));
+		log_detail(_("an interrupted pg_basebackup cannot be resumed"));
+		exit(ERR_BAD_CONFIG);
+	}
+
 	/*
 	 * Copy the provided data directory; if a configuration file was provided,
 	 * use the (mandatory) value from that; if -D/--pgdata was provided, use
@@ -547,6 +670,64 @@ do_standby_clone(void)
 	}
 
 
+	/*
+	 * Server-side compression of a base backup is only available from
+	 * PostgreSQL 15
+	 */
+	if (mode == pg_basebackup && runtime_options.compression_method[0] != '\0' &&
+		source_server_version_num != UNKNOWN_SERVER_VERSION_NUM &&
+		source_server_version_num < 150000)
+	{
+		log_error(_("--compression requires PostgreSQL 15 or later on the source node"));
+		PQfinish(source_conn);
+		exit(ERR_BAD_CONFIG);
+	}
+
+	/*
+	 * If --delta-sync was provided, determine whether the existing data
+	 * directory can be brought into line with the source node by pg_rewind,
+	 * which copies only the blocks changed since the point where the two
+	 * diverged. Otherwise fall back to a full clone, but only if -F/--force
+	 * permits the existing data directory to be overwritten.
+	 */
+	if (runtime_options.delta_sync == true)
+	{
+		PQExpBufferData reason;
+
+		initPQExpBuffer(&reason);
+
+		if (check_delta_sync(&reason) == true)
+		{
+			delta_sync = true;
+
+			if (runtime_options.dry_run == true)
+			{
+				log_info(_("existing data directory \"%s\" can be resynchronised with pg_rewind"),
+						 local_data_directory);
+			}
+		}
+		else if (runtime_options.force == true)
+		{
+			log_warning(_("unable to resynchronise existing data directory \"%s\""),
+						local_data_directory);
+			log_detail("%s", reason.data);
+			log_notice(_("-F/--force provided - a full clone will be performed"));
+		}
+		else
+		{
+			log_error(_("unable to resynchronise existing data directory \"%s\""),
+					  local_data_directory);
+			log_detail("%s", reason.data);
+			log_hint(_("use -F/--force to perform a full clone instead"));
+
+			termPQExpBuffer(&reason);
+			PQfinish(source_conn);
+			exit(ERR_BAD_CONFIG);
+		}
+
+		termPQExpBuffer(&reason);
+	}
+
 	if (runtime_options.dry_run == true)
 	{
 		if (upstream_node_id != UNKNOWN_NODE_ID)
@@ -558,7 +739,7 @@ do_standby_clone(void)
 			log_warning(_("unable to determine a valid upstream node id"));
 		}
 
-		if (mode == pg_basebackup && runtime_options.fast_checkpoint == false)
+		if (mode == pg_basebackup && delta_sync == false && runtime_options.fast_checkpoint == false)
 		{
 			log_hint(_("consider using the -c/--fast-checkpoint option"));
 		}
@@ -577,7 +758,14 @@ do_standby_clone(void)
 	switch (mode)
 	{
 		case pg_basebackup:
-			log_notice(_("starting backup (using pg_basebackup)..."));
+			if (delta_sync == true)
+			{
+				log_notice(_("resynchronising data directory (using pg_rewind)..."));
+			}
+			else
+			{
+				log_notice(_("starting backup (using pg_basebackup)..."));
+			}
 			break;
 		case barman:
 			log_notice(_("retrieving backup from Barman..."));
@@ -587,7 +775,7 @@ do_standby_clone(void)
 			log_error(_("unknown clone mode"));
 	}
 
-	if (mode == pg_basebackup)
+	if (mode == pg_basebackup && delta_sync == false)
 	{
 		if (runtime_options.fast_checkpoint == false)
 		{
@@ -598,7 +786,33 @@ do_standby_clone(void)
 	switch (mode)
 	{
 		case pg_basebackup:
-			r = run_basebackup(&local_node_record);
+			if (delta_sync == true)
+			{
+				r = run_delta_sync();
+
+				/* the data directory is now in an unknown state, so replace it */
+				if (r != SUCCESS && runtime_options.force == true)
+				{
+					log_warning(_("unable to resynchronise data directory with pg_rewind"));
+					log_notice(_("-F/--force provided - a full clone will be performed"));
+
+					delta_sync = false;
+
+					if (create_pg_dir(local_data_directory, true) == false)
+					{
+						log_error(_("unable to use directory \"%s\""),
+								  local_data_directory);
+						PQfinish(source_conn);
+						exit(ERR_BAD_CONFIG);
+					}
+
+					r = run_basebackup(&local_node_record);
+				}
+			}
+			else
+			{
+				r = run_basebackup(&local_node_record);
+			}
 			break;
 		case barman:
 			r = run_file_backup(&local_node_record);
@@ -618,8 +832,17 @@ do_standby_clone(void)
 		}
 
 		log_error(_("unable to take a base backup of the primary server"));
-		log_hint(_("data directory (\"%s\") may need to be cleaned up manually"),
-				 local_data_directory);
+
+		/* the manifest is kept if the copy from Barman was started */
+		if (mode == barman && clone_manifest_path[0] != '\0')
+		{
+			log_hint(_("execute \"repmgr standby clone\" with --resume to continue copying from Barman"));
+		}
+		else
+		{
+			log_hint(_("data directory (\"%s\") may need to be cleaned up manually"),
+					 local_data_directory);
+		}
 
 		PQfinish(source_conn);
 		exit(r);
@@ -671,7 +894,14 @@ do_standby_clone(void)
 	switch (mode)
 	{
 		case pg_basebackup:
-			log_notice(_("standby clone (using pg_basebackup) complete"));
+			if (delta_sync == true)
+			{
+				log_notice(_("standby clone (using pg_rewind) complete"));
+			}
+			else
+			{
+				log_notice(_("standby clone (using pg_basebackup) complete"));
+			}
 			break;
 
 		case barman:
@@ -753,7 +983,7 @@ do_standby_clone(void)
 	switch (mode)
 	{
 		case pg_basebackup:
-			appendPQExpBufferStr(&event_details, "pg_basebackup");
+			appendPQExpBufferStr(&event_details, delta_sync ? "pg_rewind" : "pg_basebackup");
 			break;
 		case barman:
 			appendPQExpBufferStr(&event_details, "barman");
@@ -809,7 +1039,23 @@ check_barman_config(void)
 	}
 
 
-	if (!create_pg_dir(local_data_directory, runtime_options.force))
+	if (runtime_options.resume == true)
+	{
+		char		manifest_path[MAXPGPATH] = "";
+
+		/* keep the files already copied */
+		maxpath_snprintf(manifest_path, "%s/%s", local_data_directory, CLONE_MANIFEST_FILENAME);
+
+		if (access(manifest_path, F_OK) != 0)
+		{
+			log_error(_("no interrupted clone found in data directory \"%s\""),
+					  local_data_directory);
+			log_detail(_("clone manifest \"%s\" not found"), manifest_path);
+			log_hint(_("execute \"repmgr standby clone\" without --resume"));
+			exit(ERR_BAD_CONFIG);
+		}
+	}
+	else if (!create_pg_dir(local_data_directory, runtime_options.force))
 	{
 		log_error(_("unable to use directory %s"),
 				  local_data_directory);
@@ -828,6 +1074,10 @@ check_barman_config(void)
 	maxlen_snprintf(datadir_list_filename,
 					"%s/data.txt", local_repmgr_tmp_directory);
 
+	/* left behind if the interrupted clone did not exit cleanly */
+	if (runtime_options.resume == true)
+		rmtree(local_repmgr_tmp_directory, true);
+
 	if (!create_pg_dir(local_repmgr_tmp_directory, runtime_options.force))
 	{
 		log_error(_("unable to create directory \"%s\""),
@@ -836,6 +1086,9 @@ check_barman_config(void)
 		exit(ERR_BAD_CONFIG);
 	}
 
+	/* further commands will share a single SSH connection */
+	start_barman_ssh_master();
+
 	/*
 	 * Fetch server parameters from Barman
 	 */
@@ -5231,12 +5484,13 @@ check_source_server_via_barman()
 
 	initPQExpBuffer(&command_output);
 	maxlen_snprintf(buf,
-					"ssh %s \"psql -Aqt \\\"%s\\\" -c \\\""
+					"ssh%s %s \"psql -Aqt \\\"%s\\\" -c \\\""
 					" SELECT conninfo"
 					" FROM repmgr.nodes"
 					" WHERE %s"
 					" AND active IS TRUE"
 					"\\\"\"",
+					barman_ssh_options(),
 					config_file_options.barman_host,
 					repmgr_conninfo_buf.data,
 					where_condition);
@@ -5663,10 +5917,11 @@ initialise_direct_clone(t_node_info *node_record)
 {
 	/*
 	 * Check the destination data directory can be used (in Barman mode, this
-	 * directory will already have been created)
+	 * directory will already have been created); when resynchronising, the
+	 * existing data directory is retained.
 	 */
 
-	if (!create_pg_dir(local_data_directory, runtime_options.force))
+	if (delta_sync == false && !create_pg_dir(local_data_directory, runtime_options.force))
 	{
 		log_error(_("unable to use directory \"%s\""),
 				  local_data_directory);
@@ -5802,6 +6057,215 @@ initialise_direct_clone(t_node_info *node_record)
 }
 
 
+/*
+ * Determine whether the existing data directory can be resynchronised with
+ * the source node using pg_rewind; if not, the reason is appended to
+ * "reason".
+ *
+ * pg_rewind determines the point at which the two servers' histories
+ * diverged, and copies only those blocks modified on either side since
+ * then; this requires the data directory to belong to the same cluster as
+ * the source node and to have been shut down cleanly.
+ */
+static bool
+check_delta_sync(PQExpBufferData *reason)
+{
+	t_conninfo_param_list repl_conninfo = T_CONNINFO_PARAM_LIST_INITIALIZER;
+	t_system_identification identification = T_SYSTEM_IDENTIFICATION_INITIALIZER;
+	PGconn	   *repl_conn = NULL;
+	uint64		local_system_identifier = UNKNOWN_SYSTEM_IDENTIFIER;
+	XLogRecPtr	checkpoint_location = InvalidXLogRecPtr;
+	DBState		db_state;
+	bool		success;
+
+	if (PQstatus(source_conn) != CONNECTION_OK)
+	{
+		appendPQExpBufferStr(reason,
+							 _("a connection to the source node is required"));
+		return false;
+	}
+
+	if (source_server_version_num < 90500)
+	{
+		appendPQExpBufferStr(reason,
+							 _("pg_rewind is only available from PostgreSQL 9.5"));
+		return false;
+	}
+
+	if (check_dir(local_data_directory) != DIR_NOT_EMPTY || is_pg_dir(local_data_directory) == false)
+	{
+		appendPQExpBuffer(reason,
+						  _("\"%s\" is not an existing PostgreSQL data directory"),
+						  local_data_directory);
+		return false;
+	}
+
+	if (is_pg_running(local_data_directory) != PG_DIR_NOT_RUNNING)
+	{
+		appendPQExpBuffer(reason,
+						  _("PostgreSQL may be running in data directory \"%s\""),
+						  local_data_directory);
+		return false;
+	}
+
+	db_state = get_db_state(local_data_directory);
+
+	if (db_state != DB_SHUTDOWNED && db_state != DB_SHUTDOWNED_IN_RECOVERY)
+	{
+		appendPQExpBuffer(reason,
+						  _("data directory was not shut down cleanly (state: %s)"),
+						  describe_db_state(db_state));
+		return false;
+	}
+
+	local_system_identifier = get_system_identifier(local_data_directory);
+
+	/* IDENTIFY_SYSTEM requires a replication connection */
+	initialize_conninfo_params(&repl_conninfo, false);
+	copy_conninfo_params(&repl_conninfo, &recovery_conninfo);
+	param_set(&repl_conninfo, "replication", "1");
+
+	repl_conn = establish_db_connection_by_params(&repl_conninfo, false);
+	free_conninfo_params(&repl_conninfo);
+
+	if (PQstatus(repl_conn) != CONNECTION_OK)
+	{
+		appendPQExpBufferStr(reason,
+							 _("unable to establish a replication connection to the source node"));
+		PQfinish(repl_conn);
+		return false;
+	}
+
+	success = identify_system(repl_conn, &identification);
+	PQfinish(repl_conn);
+
+	if (success == false)
+	{
+		appendPQExpBufferStr(reason,
+							 _("unable to query the source node's system identification"));
+		return false;
+	}
+
+	if (identification.system_identifier != local_system_identifier)
+	{
+		appendPQExpBuffer(reason,
+						  _("system identifier of the data directory (%lu) does not match that of the source node (%lu)"),
+						  local_system_identifier,
+						  identification.system_identifier);
+		return false;
+	}
+
+	if (can_use_pg_rewind(source_conn, local_data_directory, reason) == false)
+		return false;
+
+	checkpoint_location = get_latest_checkpoint_location(local_data_directory);
+
+	log_verbose(LOG_INFO, _("data directory's latest checkpoint is at %X/%X on timeline %i"),
+				format_lsn(checkpoint_location),
+				get_timeline(local_data_directory));
+	log_verbose(LOG_INFO, _("source node is at %X/%X on timeline %i"),
+				format_lsn(identification.xlogpos),
+				identification.timeline);
+
+	return true;
+}
+
+
+/*
+ * Bring the existing data directory into line with the source node by
+ * executing pg_rewind. If the data directory has not diverged from the
+ * source node, pg_rewind makes no changes and the standby will catch up
+ * via streaming replication.
+ */
+static int
+run_delta_sync(void)
+{
+	t_conninfo_param_list rewind_conninfo = T_CONNINFO_PARAM_LIST_INITIALIZER;
+	PQExpBufferData command;
+	PQExpBufferData command_output;
+	PQExpBufferData filebuf;
+	char	   *conninfo_str = NULL;
+	bool		success;
+
+	/* pg_rewind requires a superuser connection (before PostgreSQL 11) */
+	initialize_conninfo_params(&rewind_conninfo, false);
+	copy_conninfo_params(&rewind_conninfo, &source_conninfo);
+
+	if (runtime_options.superuser[0] != '\0')
+		param_set(&rewind_conninfo, "user", runtime_options.superuser);
+
+	conninfo_str = param_list_to_string(&rewind_conninfo);
+	free_conninfo_params(&rewind_conninfo);
+
+	initPQExpBuffer(&command);
+
+	appendPQExpBuffer(&command,
+					  "%s -D ",
+					  make_pg_path("pg_rewind"));
+
+	appendShellString(&command,
+					  local_data_directory);
+
+	appendPQExpBuffer(&command,
+					  " --source-server='%s'",
+					  conninfo_str);
+
+	pfree(conninfo_str);
+
+	log_detail(_("pg_rewind command is \"%s\""),
+			   command.data);
+
+	initPQExpBuffer(&command_output);
+
+	success = local_command(command.data, &command_output);
+
+	termPQExpBuffer(&command);
+
+	if (success == false)
+	{
+		log_error(_("unable to execute pg_rewind"));
+		log_detail("%s", command_output.data);
+
+		termPQExpBuffer(&command_output);
+		return ERR_BAD_BASEBACKUP;
+	}
+
+	termPQExpBuffer(&command_output);
+
+	initPQExpBuffer(&filebuf);
+
+	/* remove any recovery.done file copied in by pg_rewind */
+	appendPQExpBuffer(&filebuf,
+					  "%s/recovery.done",
+					  local_data_directory);
+
+	if (unlink(filebuf.data) < 0 && errno != ENOENT)
+	{
+		log_warning(_("unable to delete \"%s\""),
+					filebuf.data);
+		log_detail("%s", strerror(errno));
+	}
+
+	/* before PostgreSQL 11, pg_rewind copies the source node's replication slots */
+	if (source_server_version_num < 110000)
+	{
+		resetPQExpBuffer(&filebuf);
+		appendPQExpBuffer(&filebuf,
+						  "%s/pg_replslot",
+						  local_data_directory);
+
+		if (rmtree(filebuf.data, false) == false)
+		{
+			log_warning(_("unable to remove replication slots copied from the source node"));
+		}
+	}
+
+	termPQExpBuffer(&filebuf);
+
+	return SUCCESS;
+}
+
+
 static int
 run_basebackup(t_node_info *node_record)
 {
@@ -5924,6 +6388,36 @@ run_basebackup(t_node_info *node_record)
 		appendPQExpBufferStr(&params, " -X stream");
 	}
 
+	/*
+	 * From PostgreSQL 15, the source node can compress the backup before
+	 * sending it, and pg_basebackup decompresses it as it is received; this
+	 * reduces the bandwidth needed at the cost of CPU time on both nodes.
+	 * zstd can compress with several threads on the source node.
+	 *
+	 * Any compression method specified in 'pg_basebackup_options' takes
+	 * precedence.
+	 */
+	if (runtime_options.compression_method[0] != '\0' && backup_options.compress[0] == '\0')
+	{
+		appendPQExpBuffer(&params, " --compress=server-%s", runtime_options.compression_method);
+
+		if (runtime_options.compression_level > 0)
+		{
+			appendPQExpBuffer(&params, ":level=%i", runtime_options.compression_level);
+		}
+
+		if (runtime_options.copy_parallelism > 1 && strcmp(runtime_options.compression_method, "zstd") == 0)
+		{
+			appendPQExpBuffer(&params, "%cworkers=%i",
+							  runtime_options.compression_level > 0 ? ',' : ':',
+							  runtime_options.copy_parallelism);
+		}
+	}
+	else if (runtime_options.compression_method[0] != '\0')
+	{
+		log_warning(_("--compression ignored as \"pg_basebackup_options\" already specifies a compression method"));
+	}
+
 	/*
 	 * From 9.6, pg_basebackup accepts -S/--slot, which forces WAL streaming
 	 * to use the specified replication slot. If replication slot usage is
@@ -6141,6 +6635,10 @@ run_file_backup(t_node_info *node_record)
 	PQExpBufferData tablespace_map;
 	bool		tablespace_map_rewrite = false;
 
+	/* in Barman mode, the data directory and each tablespace are copied together */
+	t_copy_job *copy_jobs = NULL;
+	int			copy_job_count = 0;
+
 	if (mode == barman)
 	{
 		/*
@@ -6227,7 +6725,8 @@ run_file_backup(t_node_info *node_record)
 					 * Copy backup.info
 					 */
 					maxlen_snprintf(command,
-									"rsync -a %s:%s/%s/backup.info %s",
+									"rsync -a%s %s:%s/%s/backup.info %s",
+									barman_rsync_options(),
 									config_file_options.barman_host,
 									basebackups_directory,
 									backup_id,
@@ -6309,6 +6808,16 @@ run_file_backup(t_node_info *node_record)
 			pclose(fi);
 		}
 
+		if (open_clone_manifest(backup_id) == false)
+			exit(ERR_BAD_CONFIG);
+
+		/* one copy job for the data directory, and one per tablespace */
+		i = 1;
+		for (cell_t = tablespace_list.head; cell_t; cell_t = cell_t->next)
+			i++;
+
+		copy_jobs = pg_malloc0(sizeof(t_copy_job) * i);
+
 		/* For 9.5 and greater, create our own tablespace_map file */
 		if (source_server_version_num >= 90500)
 		{
@@ -6331,21 +6840,15 @@ run_file_backup(t_node_info *node_record)
 		 */
 
 		/*
-		 * Copy all backup files from the Barman server
+		 * Queue the data directory files for copying from the Barman server
 		 */
-		maxlen_snprintf(command,
-						"rsync --progress -a --files-from=%s %s:%s/%s/data %s",
-						datadir_list_filename,
-						config_file_options.barman_host,
-						basebackups_directory,
-						backup_id,
-						local_data_directory);
-
-		(void) local_command(
-							 command,
-							 NULL);
-
-		unlink(datadir_list_filename);
+		strncpy(copy_jobs[copy_job_count].list_filename, datadir_list_filename, MAXPGPATH);
+		maxpath_snprintf(copy_jobs[copy_job_count].remote_directory,
+						 "%s/%s/data",
+						 basebackups_directory,
+						 backup_id);
+		strncpy(copy_jobs[copy_job_count].local_directory, local_data_directory, MAXPGPATH);
+		copy_job_count++;
 
 		/*
 		 * We must create some PGDATA subdirectories because they are not
@@ -6443,24 +6946,21 @@ run_file_backup(t_node_info *node_record)
 			if (cell_t->f != NULL)	/* cell_t->f == NULL iff the tablespace is
 									 * empty */
 			{
-				maxlen_snprintf(command,
-								"rsync --progress -a --files-from=%s/%s.txt %s:%s/%s/%s %s",
-								local_repmgr_tmp_directory,
-								cell_t->oid,
-								config_file_options.barman_host,
-								basebackups_directory,
-								backup_id,
-								cell_t->oid,
-								tblspc_dir_dest);
-				(void) local_command(
-									 command,
-									 NULL);
+				/* the list must be complete on disk before rsync reads it */
 				fclose(cell_t->f);
-				maxlen_snprintf(filename,
-								"%s/%s.txt",
-								local_repmgr_tmp_directory,
-								cell_t->oid);
-				unlink(filename);
+				cell_t->f = NULL;
+
+				maxpath_snprintf(copy_jobs[copy_job_count].list_filename,
+								 "%s/%s.txt",
+								 local_repmgr_tmp_directory,
+								 cell_t->oid);
+				maxpath_snprintf(copy_jobs[copy_job_count].remote_directory,
+								 "%s/%s/%s",
+								 basebackups_directory,
+								 backup_id,
+								 cell_t->oid);
+				strncpy(copy_jobs[copy_job_count].local_directory, tblspc_dir_dest, MAXPGPATH);
+				copy_job_count++;
 			}
 		}
 
@@ -6514,6 +7014,24 @@ run_file_backup(t_node_info *node_record)
 		}
 	}
 
+	/*
+	 * Copy the data directory and tablespace files from the Barman server.
+	 * Any tablespace symlinks created above are not affected, as Barman
+	 * does not include the contents of pg_tblspc in its backups.
+	 */
+	if (mode == barman)
+	{
+		if (copy_barman_files(copy_jobs, copy_job_count) == false)
+		{
+			log_error(_("unable to copy backup files from the Barman server"));
+			r = ERR_BARMAN;
+			goto stop_backup;
+		}
+
+		for (i = 0; i < copy_job_count; i++)
+			unlink(copy_jobs[i].list_filename);
+	}
+
 	/*
 	 * For 9.5 and later, if tablespace remapping was requested, we'll need to
 	 * rewrite the tablespace map file ourselves. The tablespace map file is
@@ -6572,6 +7090,14 @@ stop_backup:
 
 	if (mode == barman)
 	{
+		stop_barman_ssh_master();
+
+		/* only needed if the clone is to be resumed */
+		close_clone_manifest(r == SUCCESS);
+
+		if (copy_jobs != NULL)
+			pfree(copy_jobs);
+
 		/* In Barman mode, remove local_repmgr_directory */
 		rmtree(local_repmgr_tmp_directory, true);
 	}
@@ -6673,6 +7199,849 @@ stop_backup:
 }
 
 
+/*
+ * Copy each job's files from the Barman server: the files listed in the
+ * job's "list_filename", with paths relative to its "remote_directory" on
+ * the Barman server, are copied into its "local_directory". The files
+ * copied by each rsync process are recorded in the clone manifest once it
+ * has completed successfully, and files recorded by a previous attempt are
+ * skipped when resuming.
+ *
+ * With --copy-parallelism greater than 1, each job's files are divided
+ * between up to that many rsync processes running concurrently, so the
+ * copy is not limited by the throughput of a single SSH connection. The
+ * files are balanced by size: the largest (typically 1GB relation
+ * segments) are handed out first, each to the process with the least data
+ * assigned so far. The processes for all jobs form a single queue, largest
+ * first, so the data directory and tablespaces are copied in a pipeline
+ * rather than one after the other. Large jobs are divided between further
+ * processes, so none copies much more than COPY_BATCH_BYTES.
+ */
+static bool
+copy_barman_files(t_copy_job *jobs, int job_count)
+{
+	int			parallelism = runtime_options.copy_parallelism;
+	char		line[MAXLEN] = "";
+	char		last_dir[MAXPGPATH] = "";
+	t_copy_file *files = NULL;
+	int			file_count = 0;
+	int			file_max = 1024;
+	t_copy_worker *workers = NULL;
+	int			worker_count = 0;
+	t_remote_command *commands = NULL;
+	t_copy_progress progress;
+	int			skipped_count = 0;
+	bool		success = true;
+	int			i;
+	int			j;
+
+	memset(&progress, 0, sizeof(progress));
+	progress.last_report = time(NULL);
+
+	/* read the lists of files to be copied */
+	files = pg_malloc0(sizeof(t_copy_file) * file_max);
+
+	for (j = 0; j < job_count; j++)
+	{
+		FILE	   *fp = fopen(jobs[j].list_filename, "r");
+
+		if (fp == NULL)
+		{
+			log_error(_("unable to open file \"%s\""), jobs[j].list_filename);
+			log_detail("%s", strerror(errno));
+			success = false;
+			goto cleanup;
+		}
+
+		jobs[j].file_count = 0;
+
+		while (fgets(line, sizeof(line), fp) != NULL)
+		{
+			char		local_path[MAXPGPATH] = "";
+
+			line[strcspn(line, "\n")] = '\0';
+
+			if (line[0] == '\0')
+				continue;
+
+			/* copied by a previous attempt */
+			maxpath_snprintf(local_path, "%s/%s", jobs[j].local_directory, line);
+
+			if (clone_manifest_contains(local_path) == true)
+			{
+				skipped_count++;
+				continue;
+			}
+
+			if (file_count == file_max)
+			{
+				file_max *= 2;
+				files = pg_realloc(files, sizeof(t_copy_file) * file_max);
+			}
+
+			files[file_count].path = pg_strdup(line);
+			files[file_count].size = 0;
+			files[file_count].job = j;
+			file_count++;
+
+			jobs[j].file_count++;
+		}
+
+		fclose(fp);
+	}
+
+	if (skipped_count > 0)
+	{
+		log_notice(_("skipping %i files already copied from the Barman server"), skipped_count);
+	}
+
+	if (file_count == 0)
+		goto cleanup;
+
+	qsort(files, file_count, sizeof(t_copy_file), compare_copy_file_path);
+
+	/*
+	 * Fetch the file sizes, with one listing per job, executed concurrently;
+	 * any file missing from a listing is treated as empty, which only
+	 * affects the balancing.
+	 */
+	commands = pg_malloc0(sizeof(t_remote_command) * job_count);
+
+	for (j = 0; j < job_count; j++)
+	{
+		char	   *command = pg_malloc0(MAXLEN);
+
+		maxlen_snprintf(command,
+						"rsync%s --list-only --no-human-readable --files-from=%s %s:%s",
+						barman_rsync_options(),
+						jobs[j].list_filename,
+						config_file_options.barman_host,
+						jobs[j].remote_directory);
+
+		commands[j].host = NULL;
+		commands[j].command = command;
+	}
+
+	remote_commands_parallel_bounded(commands, job_count, parallelism, "", "", 0, NULL);
+
+	for (j = 0; j < job_count; j++)
+	{
+		char	   *p = NULL;
+
+		if (commands[j].completed == false || commands[j].exit_status != 0)
+		{
+			log_warning(_("unable to retrieve file sizes for \"%s\" from the Barman server"),
+						jobs[j].remote_directory);
+			log_detail(_("files will be divided between rsync processes without regard to size"));
+		}
+
+		for (p = commands[j].output.data; p != NULL && *p != '\0';)
+		{
+			char	   *next_line = strchr(p, '\n');
+			char		perms[16] = "";
+			char		size[32] = "";
+			int			offset = 0;
+
+			if (next_line != NULL)
+				*next_line++ = '\0';
+
+			/* e.g. "-rw------- 1073741824 2020/01/01 00:00:00 base/16384/16385" */
+			if (sscanf(p, "%15s %31s %*s %*s %n", perms, size, &offset) == 2 &&
+				offset > 0 && perms[0] == '-')
+			{
+				t_copy_file key;
+				t_copy_file *file = NULL;
+				char	   *s;
+				char	   *d;
+
+				/* older rsync versions group digits with commas */
+				for (s = d = size; *s != '\0'; s++)
+				{
+					if (*s != ',')
+						*d++ = *s;
+				}
+				*d = '\0';
+
+				key.path = p + offset;
+				key.job = j;
+				file = bsearch(&key, files, file_count, sizeof(t_copy_file), compare_copy_file_path);
+
+				if (file != NULL)
+					file->size = atoll(size);
+			}
+
+			p = next_line;
+		}
+
+		termPQExpBuffer(&commands[j].output);
+		pfree((char *) commands[j].command);
+	}
+
+	pfree(commands);
+	commands = NULL;
+
+	/*
+	 * Create the directories up front, rather than have several rsync
+	 * processes race to create each one.
+	 */
+	for (i = 0; i < file_count; i++)
+	{
+		char		dir[MAXPGPATH] = "";
+		char	   *slash = NULL;
+
+		maxpath_snprintf(dir, "%s/%s", jobs[files[i].job].local_directory, files[i].path);
+		slash = strrchr(dir, '/');
+		*slash = '\0';
+
+		if (strcmp(dir, last_dir) == 0)
+			continue;
+
+		strncpy(last_dir, dir, MAXPGPATH);
+
+		if (mkdir_p(dir, S_IRWXU) != 0)
+		{
+			log_error(_("unable to create directory \"%s\""), dir);
+			log_detail("%s", strerror(errno));
+			success = false;
+			goto cleanup;
+		}
+	}
+
+	for (j = 0; j < job_count; j++)
+		jobs[j].bytes = 0;
+
+	for (i = 0; i < file_count; i++)
+		jobs[files[i].job].bytes += files[i].size;
+
+	/*
+	 * Each job gets at least --copy-parallelism processes, and more if
+	 * needed to limit the data copied by each.
+	 */
+	for (j = 0; j < job_count; j++)
+	{
+		long long	batches = jobs[j].bytes / COPY_BATCH_BYTES + 1;
+
+		jobs[j].first_worker = worker_count;
+		jobs[j].worker_count = (int) Min(Max((long long) parallelism, batches), (long long) jobs[j].file_count);
+		worker_count += jobs[j].worker_count;
+	}
+
+	workers = pg_malloc0(sizeof(t_copy_worker) * worker_count);
+
+	for (j = 0; j < job_count; j++)
+	{
+		for (i = jobs[j].first_worker; i < jobs[j].first_worker + jobs[j].worker_count; i++)
+		{
+			workers[i].job = j;
+			maxpath_snprintf(workers[i].list_filename, "%s/copy-%i.txt", local_repmgr_tmp_directory, i + 1);
+			workers[i].list_file = fopen(workers[i].list_filename, "w");
+
+			if (workers[i].list_file == NULL)
+			{
+				log_error(_("unable to create file \"%s\""), workers[i].list_filename);
+				log_detail("%s", strerror(errno));
+				success = false;
+			}
+		}
+	}
+
+	/* assign each job's files, largest first, to its least-loaded process */
+	qsort(files, file_count, sizeof(t_copy_file), compare_copy_file_size);
+
+	for (i = 0; i < file_count && success == true; i++)
+	{
+		t_copy_job *job = &jobs[files[i].job];
+		int			worker = job->first_worker;
+		int			k;
+
+		/* files of equal size are spread evenly */
+		for (k = job->first_worker + 1; k < job->first_worker + job->worker_count; k++)
+		{
+			if (workers[k].bytes < workers[worker].bytes ||
+				(workers[k].bytes == workers[worker].bytes && workers[k].files < workers[worker].files))
+				worker = k;
+		}
+
+		workers[worker].bytes += files[i].size;
+		workers[worker].files++;
+		progress.bytes_total += files[i].size;
+
+		fprintf(workers[worker].list_file, "%s\n", files[i].path);
+	}
+
+	for (i = 0; i < worker_count; i++)
+	{
+		if (workers[i].list_file != NULL && fclose(workers[i].list_file) != 0)
+		{
+			log_error(_("unable to write file \"%s\""), workers[i].list_filename);
+			success = false;
+		}
+
+		workers[i].list_file = NULL;
+	}
+
+	if (success == false)
+		goto cleanup;
+
+	/*
+	 * Start the largest transfers first. When several run at once, they
+	 * don't use the shared SSH connection, so each has its own TCP stream
+	 * and encryption process.
+	 */
+	qsort(workers, worker_count, sizeof(t_copy_worker), compare_copy_worker_size);
+
+	commands = pg_malloc0(sizeof(t_remote_command) * worker_count);
+
+	for (i = 0; i < worker_count; i++)
+	{
+		t_copy_job *job = &jobs[workers[i].job];
+
+		maxlen_snprintf(workers[i].command,
+						"rsync -a%s --out-format='%%b %%l %%n' --files-from=%s %s:%s %s",
+						parallelism > 1 ? "" : barman_rsync_options(),
+						workers[i].list_filename,
+						config_file_options.barman_host,
+						job->remote_directory,
+						job->local_directory);
+
+		workers[i].local_directory = job->local_directory;
+		workers[i].progress = &progress;
+
+		commands[i].host = NULL;
+		commands[i].command = workers[i].command;
+		commands[i].arg = &workers[i];
+		commands[i].output_callback = copy_progress_output;
+	}
+
+	if (parallelism > 1)
+	{
+		log_notice(_("copying %i files (%lli MB) from the Barman server with up to %i rsync processes"),
+				   file_count, progress.bytes_total / (1024 * 1024), parallelism);
+	}
+	else
+	{
+		log_notice(_("copying %i files (%lli MB) from the Barman server"),
+				   file_count, progress.bytes_total / (1024 * 1024));
+	}
+
+	/* the copy may take many hours, so no timeout is applied */
+	remote_commands_parallel_bounded(commands, worker_count, parallelism, "", "", 0, copy_worker_completed);
+
+	for (i = 0; i < worker_count; i++)
+	{
+		if (commands[i].completed == false || commands[i].exit_status != 0)
+		{
+			log_error(_("unable to copy files from the Barman server to \"%s\""),
+					  jobs[workers[i].job].local_directory);
+			log_detail(_("command was:\n  %s"), workers[i].command);
+			success = false;
+		}
+
+		termPQExpBuffer(&commands[i].output);
+		unlink(workers[i].list_filename);
+	}
+
+	if (success == true)
+		log_info(_("copied %lli MB from the Barman server"),
+				 progress.bytes_copied / (1024 * 1024));
+
+cleanup:
+	for (i = 0; i < file_count; i++)
+		pfree(files[i].path);
+
+	pfree(files);
+
+	if (workers != NULL)
+	{
+		for (i = 0; i < worker_count; i++)
+		{
+			if (workers[i].list_file != NULL)
+				fclose(workers[i].list_file);
+		}
+
+		pfree(workers);
+	}
+
+	if (commands != NULL)
+		pfree(commands);
+
+	return success;
+}
+
+
+/*
+ * Consume the "--out-format" lines ("<bytes transferred> <size> <name>")
+ * emitted by an rsync process started by copy_barman_files(), and report
+ * the overall progress at intervals.
+ *
+ * As the format includes "%b", rsync emits each line once the file has been
+ * transferred, rather than when the transfer starts. The file may not yet
+ * have been renamed into place, so files are only recorded in the clone
+ * manifest by copy_worker_completed().
+ */
+static void
+copy_progress_output(t_remote_command *command)
+{
+	t_copy_worker *worker = (t_copy_worker *) command->arg;
+	t_copy_progress *progress = worker->progress;
+	PQExpBuffer output = &command->output;
+	char	   *line = output->data;
+	char	   *eol = NULL;
+	size_t		remaining;
+	time_t		now;
+
+	while ((eol = strchr(line, '\n')) != NULL)
+	{
+		size_t		line_len = eol - line;
+
+		/* directories are reported with a trailing slash */
+		if (line_len > 0 && line[line_len - 1] != '/')
+		{
+			char	   *size = NULL;
+
+			/* the size, rather than the bytes transferred, which may be compressed */
+			(void) strtoll(line, &size, 10);
+
+			if (size < eol)
+				progress->bytes_copied += strtoll(size, NULL, 10);
+		}
+
+		line = eol + 1;
+	}
+
+	/* keep any incomplete line for the next call */
+	remaining = output->len - (line - output->data);
+	memmove(output->data, line, remaining);
+	output->len = remaining;
+	output->data[remaining] = '\0';
+
+	now = time(NULL);
+
+	if (now - progress->last_report < COPY_PROGRESS_INTERVAL || progress->bytes_total <= 0)
+		return;
+
+	progress->last_report = now;
+
+	log_info(_("copied %lli of %lli MB (%i%%)"),
+			 progress->bytes_copied / (1024 * 1024),
+			 progress->bytes_total / (1024 * 1024),
+			 (int) (progress->bytes_copied * 100 / progress->bytes_total));
+}
+
+
+/*
+ * Once an rsync process started by copy_barman_files() has completed
+ * successfully, record all the files it was to copy in the clone manifest.
+ */
+static void
+copy_worker_completed(t_remote_command *command)
+{
+	t_copy_worker *worker = (t_copy_worker *) command->arg;
+	char		line[MAXPGPATH] = "";
+	FILE	   *fp = NULL;
+
+	if (command->completed == false || command->exit_status != 0)
+		return;
+
+	fp = fopen(worker->list_filename, "r");
+
+	if (fp == NULL)
+	{
+		log_debug("copy_worker_completed(): unable to open \"%s\": %s", worker->list_filename, strerror(errno));
+		return;
+	}
+
+	while (fgets(line, sizeof(line), fp) != NULL)
+	{
+		char		local_path[MAXPGPATH] = "";
+
+		line[strcspn(line, "\n")] = '\0';
+
+		if (line[0] == '\0')
+			continue;
+
+		maxpath_snprintf(local_path, "%s/%s", worker->local_directory, line);
+		clone_manifest_record(local_path);
+	}
+
+	fclose(fp);
+
+	clone_manifest_sync();
+}
+
+
+/* sort by job, then path */
+static int
+compare_copy_file_path(const void *a, const void *b)
+{
+	const t_copy_file *file_a = (const t_copy_file *) a;
+	const t_copy_file *file_b = (const t_copy_file *) b;
+
+	if (file_a->job != file_b->job)
+		return file_a->job - file_b->job;
+
+	return strcmp(file_a->path, file_b->path);
+}
+
+
+/* sort by descending size */
+static int
+compare_copy_file_size(const void *a, const void *b)
+{
+	long long	size_a = ((const t_copy_file *) a)->size;
+	long long	size_b = ((const t_copy_file *) b)->size;
+
+	if (size_a > size_b)
+		return -1;
+
+	if (size_a < size_b)
+		return 1;
+
+	return 0;
+}
+
+
+/* sort by descending number of bytes assigned */
+static int
+compare_copy_worker_size(const void *a, const void *b)
+{
+	long long	bytes_a = ((const t_copy_worker *) a)->bytes;
+	long long	bytes_b = ((const t_copy_worker *) b)->bytes;
+
+	if (bytes_a > bytes_b)
+		return -1;
+
+	if (bytes_a < bytes_b)
+		return 1;
+
+	return 0;
+}
+
+
+/*
+ * Open the clone manifest in the data directory. With --resume, the files
+ * recorded by the interrupted clone are loaded, provided they were copied
+ * from the same Barman backup; otherwise a new manifest is created.
+ */
+static bool
+open_clone_manifest(const char *backup_id)
+{
+	char		line[MAXPGPATH + MAXLEN] = "";
+	char		manifest_backup_id[MAXLEN] = "";
+	int			entry_max = 0;
+	bool		torn = false;
+
+	maxpath_snprintf(clone_manifest_path, "%s/%s", local_data_directory, CLONE_MANIFEST_FILENAME);
+
+	if (runtime_options.resume == false)
+	{
+		clone_manifest = fopen(clone_manifest_path, "w");
+
+		if (clone_manifest == NULL)
+		{
+			log_error(_("unable to create clone manifest \"%s\""), clone_manifest_path);
+			log_detail("%s", strerror(errno));
+			return false;
+		}
+
+		fprintf(clone_manifest, "backup_id %s\n", backup_id);
+		clone_manifest_sync();
+
+		return true;
+	}
+
+	clone_manifest = fopen(clone_manifest_path, "r");
+
+	if (clone_manifest == NULL)
+	{
+		log_error(_("unable to open clone manifest \"%s\""), clone_manifest_path);
+		log_detail("%s", strerror(errno));
+		return false;
+	}
+
+	while (fgets(line, sizeof(line), clone_manifest) != NULL)
+	{
+		size_t		line_len = strlen(line);
+		char	   *path = NULL;
+		char	   *size = NULL;
+		char	   *mtime = NULL;
+
+		/* the last line may have been cut short by the interruption */
+		torn = (line_len == 0 || line[line_len - 1] != '\n');
+
+		if (torn == true)
+			continue;
+
+		line[line_len - 1] = '\0';
+
+		if (manifest_backup_id[0] == '\0')
+		{
+			if ((path = string_skip_prefix("backup_id ", line)) != NULL)
+				strncpy(manifest_backup_id, path, MAXLEN - 1);
+			continue;
+		}
+
+		/* file <path> <size> <mtime> */
+		if ((path = string_skip_prefix("file\t", line)) == NULL)
+			continue;
+
+		if ((size = strchr(path, '\t')) == NULL)
+			continue;
+		*size++ = '\0';
+
+		if ((mtime = strchr(size, '\t')) == NULL)
+			continue;
+		*mtime++ = '\0';
+
+		if (manifest_entry_count == entry_max)
+		{
+			entry_max = entry_max ? entry_max * 2 : 1024;
+			manifest_entries = pg_realloc(manifest_entries, sizeof(t_manifest_entry) * entry_max);
+		}
+
+		manifest_entries[manifest_entry_count].path = pg_strdup(path);
+		manifest_entries[manifest_entry_count].size = atoll(size);
+		manifest_entries[manifest_entry_count].mtime = atoll(mtime);
+		manifest_entry_count++;
+	}
+
+	fclose(clone_manifest);
+	clone_manifest = NULL;
+
+	if (strcmp(manifest_backup_id, backup_id) != 0)
+	{
+		log_error(_("the interrupted clone was of a different Barman backup"));
+		log_detail(_("clone manifest records backup \"%s\", latest backup is \"%s\""),
+				   manifest_backup_id, backup_id);
+		log_hint(_("execute \"repmgr standby clone\" with -F/--force and without --resume to start a new clone"));
+		return false;
+	}
+
+	if (manifest_entry_count > 1)
+		qsort(manifest_entries, manifest_entry_count, sizeof(t_manifest_entry), compare_manifest_entry_path);
+
+	log_notice(_("resuming clone of Barman backup \"%s\""), backup_id);
+	log_detail(_("%i files recorded as copied in \"%s\""), manifest_entry_count, clone_manifest_path);
+
+	clone_manifest = fopen(clone_manifest_path, "a");
+
+	if (clone_manifest == NULL)
+	{
+		log_error(_("unable to open clone manifest \"%s\""), clone_manifest_path);
+		log_detail("%s", strerror(errno));
+		return false;
+	}
+
+	/* terminate a partial last line, so it isn't joined to the next entry */
+	if (torn == true)
+		fputc('\n', clone_manifest);
+
+	return true;
+}
+
+
+/*
+ * Indicate whether the file was recorded as copied by an interrupted clone,
+ * and is still as it was then.
+ */
+static bool
+clone_manifest_contains(const char *path)
+{
+	t_manifest_entry key;
+	t_manifest_entry *entry = NULL;
+	struct stat statbuf;
+
+	if (manifest_entry_count == 0)
+		return false;
+
+	key.path = (char *) path;
+
+	entry = bsearch(&key, manifest_entries, manifest_entry_count, sizeof(t_manifest_entry), compare_manifest_entry_path);
+
+	if (entry == NULL)
+		return false;
+
+	if (stat(path, &statbuf) != 0)
+		return false;
+
+	return (long long) statbuf.st_size == entry->size &&
+		(long long) statbuf.st_mtime == entry->mtime;
+}
+
+
+/*
+ * Record a file copied in full. rsync writes each file under a temporary
+ * name and renames it once complete, with its timestamp already set, so
+ * the size and modification time recorded here are those of the finished
+ * file.
+ */
+static void
+clone_manifest_record(const char *path)
+{
+	struct stat statbuf;
+
+	if (clone_manifest == NULL)
+		return;
+
+	if (stat(path, &statbuf) != 0)
+	{
+		log_debug("clone_manifest_record(): unable to stat \"%s\": %s", path, strerror(errno));
+		return;
+	}
+
+	fprintf(clone_manifest, "file\t%s\t%lli\t%lli\n",
+			path,
+			(long long) statbuf.st_size,
+			(long long) statbuf.st_mtime);
+}
+
+
+/*
+ * Make the manifest durable; at most the files copied since the last call
+ * will need to be copied again after an interruption.
+ */
+static void
+clone_manifest_sync(void)
+{
+	if (clone_manifest == NULL)
+		return;
+
+	if (fflush(clone_manifest) != 0 || fsync(fileno(clone_manifest)) != 0)
+	{
+		log_debug("clone_manifest_sync(): unable to sync \"%s\": %s", clone_manifest_path, strerror(errno));
+	}
+}
+
+
+/*
+ * Close the manifest; it is removed once the clone is complete, and
+ * otherwise kept for --resume.
+ */
+static void
+close_clone_manifest(bool remove_manifest)
+{
+	int			i;
+
+	if (clone_manifest != NULL)
+	{
+		clone_manifest_sync();
+		fclose(clone_manifest);
+		clone_manifest = NULL;
+	}
+
+	for (i = 0; i < manifest_entry_count; i++)
+		pfree(manifest_entries[i].path);
+
+	if (manifest_entries != NULL)
+		pfree(manifest_entries);
+
+	manifest_entries = NULL;
+	manifest_entry_count = 0;
+
+	if (remove_manifest == true && clone_manifest_path[0] != '\0')
+	{
+		unlink(clone_manifest_path);
+		clone_manifest_path[0] = '\0';
+	}
+}
+
+
+static int
+compare_manifest_entry_path(const void *a, const void *b)
+{
+	return strcmp(((const t_manifest_entry *) a)->path,
+				  ((const t_manifest_entry *) b)->path);
+}
+
+
+/*
+ * Open a master SSH connection to the Barman server, over which subsequent
+ * commands are multiplexed rather than each performing its own SSH
+ * handshake. Should we exit without closing it, the master connection exits
+ * by itself after BARMAN_SSH_CONTROL_PERSIST seconds without use.
+ */
+static void
+start_barman_ssh_master(void)
+{
+	char		command[MAXLEN] = "";
+
+	maxpath_snprintf(barman_control_path, "%s/ssh-control", local_repmgr_tmp_directory);
+
+	/* the path must fit in a Unix socket address */
+	if (strlen(barman_control_path) >= 100)
+	{
+		log_debug("start_barman_ssh_master(): control path \"%s\" too long", barman_control_path);
+		barman_control_path[0] = '\0';
+		return;
+	}
+
+	maxlen_snprintf(command,
+					"ssh -o ControlMaster=yes -o ControlPersist=%i -o ControlPath=%s %s true",
+					BARMAN_SSH_CONTROL_PERSIST,
+					barman_control_path,
+					config_file_options.barman_host);
+
+	if (local_command(command, NULL) == false)
+	{
+		log_warning(_("unable to open a shared SSH connection to the Barman server"));
+		log_detail(_("a separate SSH connection will be made for each command"));
+		barman_control_path[0] = '\0';
+	}
+}
+
+
+static void
+stop_barman_ssh_master(void)
+{
+	char		command[MAXLEN] = "";
+
+	if (barman_control_path[0] == '\0')
+		return;
+
+	maxlen_snprintf(command,
+					"ssh -o ControlPath=%s -O exit %s 2>/dev/null",
+					barman_control_path,
+					config_file_options.barman_host);
+
+	(void) local_command(command, NULL);
+
+	barman_control_path[0] = '\0';
+}
+
+
+/*
+ * ssh options for commands executed on the Barman server; empty if no
+ * shared connection is open.
+ */
+static const char *
+barman_ssh_options(void)
+{
+	static char options[MAXLEN] = "";
+
+	if (barman_control_path[0] == '\0')
+		return "";
+
+	maxlen_snprintf(options, " -o ControlPath=%s", barman_control_path);
+
+	return options;
+}
+
+
+/* as barman_ssh_options(), for rsync */
+static const char *
+barman_rsync_options(void)
+{
+	static char options[MAXLEN] = "";
+
+	if (barman_control_path[0] == '\0')
+		return "";
+
+	maxlen_snprintf(options, " -e \"ssh -o ControlPath=%s\"", barman_control_path);
+
+	return options;
+}
+
+
 static char *
 make_barman_ssh_command(char *buf)
 {
@@ -6684,7 +8053,8 @@ make_barman_ssh_command(char *buf)
 						config_file_options.barman_config);
 
 	maxlen_snprintf(buf,
-					"ssh %s barman%s",
+					"ssh%s %s barman%s",
+					barman_ssh_options(),
 					config_file_options.barman_host,
 					config_opt);
 
@@ -7570,9 +8940,17 @@ do_standby_help(void)
 			 "                                      copy configuration files located outside the \n" \
 			 "                                        data directory to the same path on the standby (default) or to the\n" \
 			 "                                        PostgreSQL data directory\n"));
+	printf(_("  --compression=METHOD[:LEVEL]        compress the backup on the source node (\"gzip\", \"lz4\" or \"zstd\";\n" \
+			 "                                        PostgreSQL 15 and later)\n"));
+	printf(_("  --copy-parallelism=N                when using Barman, copy files with N concurrent rsync processes;\n" \
+			 "                                        with --compression=zstd, compress with N threads\n"));
+	printf(_("  --delta-sync                        resynchronise an existing data directory with pg_rewind\n" \
+			 "                                        rather than copying the entire data directory\n"));
 	printf(_("  --dry-run                           perform checks but don't actually clone the standby\n"));
 	printf(_("  --no-upstream-connection            when using Barman, do not connect to upstream node\n"));
 	printf(_("  -R, --remote-user=USERNAME          database server username for SSH operations (default: \"%s\")\n"), runtime_options.username);
+	printf(_("  --resume                            when using Barman, continue an interrupted clone, copying\n" \
+			 "                                        only the files not yet copied\n"));
 	printf(_("  --replication-user                  user to make replication connections with (optional, not usually required)\n"));
 	printf(_("  --upstream-conninfo                 \"primary_conninfo\" value to write in recovery.conf\n" \
 			 "                                        when the intended upstream server does not yet exist\n"));
@@ -25,9 +25,17 @@
 #define CONFIG_FILE_SAMEPATH 1
 #define CONFIG_FILE_PGDATA 2
 
+/* default value for "standby clone --copy-parallelism" */
+#define DEFAULT_COPY_PARALLELISM 1
+
 /* default value for "cluster event --limit"*/
 #define CLUSTER_EVENT_LIMIT 20
 
+/* default values for "cluster show/matrix/crosscheck --timeout" */
+#define CLUSTER_SHOW_TIMEOUT 10
+#define CLUSTER_MATRIX_TIMEOUT 30
+#define CLUSTER_CROSSCHECK_TIMEOUT 60
+
 typedef struct
 {
 	/* configuration metadata */
@@ -36,6 +44,7 @@ typedef struct
 	bool		host_param_provided;
 	bool		limit_provided;
 	bool		wait_provided;
+	bool		timeout_provided;
 
 	/* general configuration options */
 	char		config_file[MAXPGPATH];
@@ -85,6 +94,11 @@ typedef struct
 	char		upstream_conninfo[MAXLEN];
 	bool		without_barman;
 	bool		recovery_conf_only;
+	int			copy_parallelism;
+	bool		delta_sync;
+	char		compression_method[MAXLEN];
+	int			compression_level;
+	bool		resume;
 
 	/* "standby clone"/"standby follow" options */
 	int			upstream_node_id;
@@ -124,6 +138,9 @@ typedef struct
 	bool		list_actions;
 	bool		checkpoint;
 
+	/* "cluster show"/"cluster matrix"/"cluster crosscheck" options */
+	int			timeout;
+
 	/* "cluster event" options */
 	bool		all;
 	char		event[MAXLEN];
@@ -141,7 +158,7 @@ typedef struct
 
 #define T_RUNTIME_OPTIONS_INITIALIZER { \
 		/* configuration metadata */ \
-		false, false, false, false, false,	\
+		false, false, false, false, false, false, \
 		/* general configuration options */	\
 		"", false, false, "", -1, false, false, \
 		/* logging options */ \
@@ -156,7 +173,7 @@ typedef struct
 		UNKNOWN_NODE_ID, "", "", UNKNOWN_NODE_ID, \
 		/* "standby clone" options */ \
 		false, CONFIG_FILE_SAMEPATH, false, false, false, "", "", "", \
-		false, false, \
+		false, false, DEFAULT_COPY_PARALLELISM, false, "", 0, false, \
 		/* "standby clone"/"standby follow" options */ \
 		NO_UPSTREAM_NODE, \
 		/* "standby register" options */ \
@@ -171,6 +188,8 @@ typedef struct
 		"", \
 		/* "node service" options */ \
 		"", false, false, false,  \
+		/* "cluster show"/"cluster matrix"/"cluster crosscheck" options */ \
+		CLUSTER_SHOW_TIMEOUT, \
 		/* "cluster event" options */ \
 		false, "", CLUSTER_EVENT_LIMIT,	\
 		/* "cluster cleanup" options */ \
@@ -430,6 +430,50 @@ main(int argc, char **argv)
 				runtime_options.recovery_conf_only = true;
 				break;
 
+			case OPT_COPY_PARALLELISM:
+				runtime_options.copy_parallelism = repmgr_atoi(optarg, "--copy-parallelism", &cli_errors, 1);
+
+				if (runtime_options.copy_parallelism > REMOTE_COMMAND_PARALLELISM)
+				{
+					item_list_append_format(&cli_errors,
+											_("value provided for \"--copy-parallelism\" must not be greater than %i"),
+											REMOTE_COMMAND_PARALLELISM);
+				}
+				break;
+
+			case OPT_DELTA_SYNC:
+				runtime_options.delta_sync = true;
+				break;
+
+				/* --compression=METHOD[:LEVEL] */
+			case OPT_COMPRESSION:
+				{
+					char	   *level = strchr(optarg, ':');
+					int			method_len = level == NULL ? strlen(optarg) : level - optarg;
+
+					if (method_len >= MAXLEN)
+						method_len = MAXLEN - 1;
+
+					strncpy(runtime_options.compression_method, optarg, method_len);
+					runtime_options.compression_method[method_len] = '\0';
+
+					if (strcmp(runtime_options.compression_method, "gzip") != 0 &&
+						strcmp(runtime_options.compression_method, "lz4") != 0 &&
+						strcmp(runtime_options.compression_method, "zstd") != 0)
+					{
+						item_list_append(&cli_errors,
+										 _("value provided for \"--compression\" must be \"gzip\", \"lz4\" or \"zstd\""));
+					}
+
+					if (level != NULL)
+						runtime_options.compression_level = repmgr_atoi(level + 1, "--compression", &cli_errors, 1);
+				}
+				break;
+
+			case OPT_RESUME:
+				runtime_options.resume = true;
+				break;
+
 
 				/*---------------------------
 				 * "standby register" options
@@ -555,6 +599,17 @@ main(int argc, char **argv)
 				runtime_options.checkpoint = true;
 				break;
 
+				/*---------------------------------------------------
+				 * "cluster show"/"cluster matrix"/"cluster crosscheck"
+				 * options
+				 *---------------------------------------------------
+				 */
+
+			case OPT_TIMEOUT:
+				runtime_options.timeout = repmgr_atoi(optarg, "--timeout", &cli_errors, 1);
+				runtime_options.timeout_provided = true;
+				break;
+
 				/*------------------------
 				 * "cluster event" options
 				 *------------------------
@@ -1709,6 +1764,58 @@ check_cli_parameters(const int action)
 		}
 	}
 
+	if (runtime_options.copy_parallelism != DEFAULT_COPY_PARALLELISM)
+	{
+		switch (action)
+		{
+			case STANDBY_CLONE:
+				break;
+			default:
+				item_list_append_format(&cli_warnings,
+										_("--copy-parallelism will be ignored when executing %s"),
+										action_name(action));
+		}
+	}
+
+	if (runtime_options.delta_sync == true)
+	{
+		switch (action)
+		{
+			case STANDBY_CLONE:
+				break;
+			default:
+				item_list_append_format(&cli_warnings,
+										_("--delta-sync will be ignored when executing %s"),
+										action_name(action));
+		}
+	}
+
+	if (runtime_options.compression_method[0] != '\0')
+	{
+		switch (action)
+		{
+			case STANDBY_CLONE:
+				break;
+			default:
+				item_list_append_format(&cli_warnings,
+										_("--compression will be ignored when executing %s"),
+										action_name(action));
+		}
+	}
+
+	if (runtime_options.resume == true)
+	{
+		switch (action)
+		{
+			case STANDBY_CLONE:
+				break;
+			default:
+				item_list_append_format(&cli_warnings,
+										_("--resume will be ignored when executing %s"),
+										action_name(action));
+		}
+	}
+
 	if (runtime_options.event[0])
 	{
 		switch (action)
@@ -1722,6 +1829,21 @@ check_cli_parameters(const int action)
 		}
 	}
 
+	if (runtime_options.timeout_provided)
+	{
+		switch (action)
+		{
+			case CLUSTER_SHOW:
+			case CLUSTER_MATRIX:
+			case CLUSTER_CROSSCHECK:
+				break;
+			default:
+				item_list_append_format(&cli_warnings,
+										_("--timeout not required when executing %s"),
+										action_name(action));
+		}
+	}
+
 	if (runtime_options.limit_provided)
 	{
 		switch (action)
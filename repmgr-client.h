@@ -102,6 +102,11 @@
 #define OPT_COMPACT		                   1045
 #define OPT_DISABLE_WAL_RECEIVER           1046
 #define OPT_ENABLE_WAL_RECEIVER            1047
+#define OPT_TIMEOUT                        1048
+#define OPT_COPY_PARALLELISM               1049
+#define OPT_DELTA_SYNC                     1050
+#define OPT_COMPRESSION                    1051
+#define OPT_RESUME                         1052
 
 /* deprecated since 3.3 */
 #define OPT_DATA_DIR						999
@@ -153,9 +158,13 @@ static struct option long_options[] =
 
 /* "standby clone" options */
 	{"copy-external-config-files", optional_argument, NULL, OPT_COPY_EXTERNAL_CONFIG_FILES},
+	{"compression", required_argument, NULL, OPT_COMPRESSION},
+	{"copy-parallelism", required_argument, NULL, OPT_COPY_PARALLELISM},
+	{"delta-sync", no_argument, NULL, OPT_DELTA_SYNC},
 	{"fast-checkpoint", no_argument, NULL, 'c'},
 	{"no-upstream-connection", no_argument, NULL, OPT_NO_UPSTREAM_CONNECTION},
 	{"recovery-min-apply-delay", required_argument, NULL, OPT_RECOVERY_MIN_APPLY_DELAY},
+	{"resume", no_argument, NULL, OPT_RESUME},
 	{"replication-user", required_argument, NULL, OPT_REPLICATION_USER},
 	{"upstream-conninfo", required_argument, NULL, OPT_UPSTREAM_CONNINFO},
 	{"upstream-node-id", required_argument, NULL, OPT_UPSTREAM_NODE_ID},
@@ -198,6 +207,9 @@ static struct option long_options[] =
 	{"list-actions", no_argument, NULL, OPT_LIST_ACTIONS},
 	{"checkpoint", no_argument, NULL, OPT_CHECKPOINT},
 
+/* "cluster show"/"cluster matrix"/"cluster crosscheck" options */
+	{"timeout", required_argument, NULL, OPT_TIMEOUT},
+
 /* "cluster event" options */
 	{"all", no_argument, NULL, OPT_ALL},
 	{"event", required_argument, NULL, OPT_EVENT},
@@ -26,7 +26,12 @@
 
 #include "postgres.h"
 #include "fmgr.h"
+#include "funcapi.h"
+#include "access/htup_details.h"
 #include "access/xlog.h"
+#if (PG_VERSION_NUM >= 150000)
+#include "access/xlogrecovery.h"
+#endif
 #include "miscadmin.h"
 #include "replication/walreceiver.h"
 #include "storage/fd.h"
@@ -35,7 +40,10 @@
 #include "storage/procarray.h"
 #include "storage/shmem.h"
 #include "storage/spin.h"
+#include "catalog/pg_type.h"
+#include "utils/array.h"
 #include "utils/builtins.h"
+#include "utils/tuplestore.h"
 
 #if (PG_VERSION_NUM >= 90400)
 #include "utils/pg_lsn.h"
@@ -54,6 +62,7 @@
 #endif
 
 #include "voting.h"
+#include "storagelatency.h"
 
 #define UNKNOWN_NODE_ID		-1
 #define ELECTION_RERUN_NOTIFICATION -2
@@ -63,6 +72,9 @@
 #define REPMGRD_STATE_FILE PGSTAT_STAT_PERMANENT_DIRECTORY "/repmgrd_state.txt"
 #define REPMGRD_STATE_FILE_BUF_SIZE 128
 
+/* at the default monitoring interval of 2 seconds, about 34 minutes */
+#define REPLICATION_SAMPLE_BUFFER_SIZE 1024
+
 PG_MODULE_MAGIC;
 
 typedef enum
@@ -72,6 +84,29 @@ typedef enum
 	CANDIDATE_NODE
 } NodeState;
 
+/* replication state of a standby, as sampled by repmgrd */
+typedef struct ReplicationSample
+{
+	TimestampTz sample_time;
+	XLogRecPtr	last_wal_receive_lsn;
+	XLogRecPtr	last_wal_replay_lsn;
+	int64		lag_bytes;		/* -1 if not known */
+	int			upstream_last_seen;
+} ReplicationSample;
+
+/*
+ * Ring buffer of the most recent replication samples. "mutex" is held only
+ * while a sample is written and "next_sample" advanced, and while readers
+ * fetch "next_sample"; readers copy the samples without a lock, then discard
+ * any which may have been overwritten while they were copying.
+ */
+typedef struct ReplicationSampleBuffer
+{
+	slock_t		mutex;
+	uint64		next_sample;
+	ReplicationSample samples[REPLICATION_SAMPLE_BUFFER_SIZE];
+} ReplicationSampleBuffer;
+
 typedef struct repmgrdSharedState
 {
 	LWLockId	lock;			/* protects search/modification */
@@ -84,8 +119,17 @@ typedef struct repmgrdSharedState
 	TimestampTz upstream_last_seen;
 	NodeVotingStatus voting_status;
 	int			current_electoral_term;
+	int			local_node_priority;
 	int			candidate_node_id;
 	bool		follow_new_primary;
+	/* node record cache invalidation */
+	int64		node_records_version;
+	/* storage latency, as reported by repmgrd */
+	StorageLatencyHistogram storage_latency[STORAGE_PROBE_TYPES];
+	bool		storage_degraded[STORAGE_PROBE_TYPES];
+	TimestampTz storage_latency_updated;
+	/* recent replication state */
+	ReplicationSampleBuffer replication_samples;
 	/* BDR failover */
 	int			bdr_failover_handler;
 } repmgrdSharedState;
@@ -99,6 +143,7 @@ void		_PG_init(void);
 void		_PG_fini(void);
 
 static void repmgr_shmem_startup(void);
+static Tuplestorestate *_init_materialized_srf(FunctionCallInfo fcinfo, TupleDesc *tupdesc);
 
 Datum		set_local_node_id(PG_FUNCTION_ARGS);
 PG_FUNCTION_INFO_V1(set_local_node_id);
@@ -118,6 +163,33 @@ PG_FUNCTION_INFO_V1(set_upstream_last_seen);
 Datum		get_upstream_last_seen(PG_FUNCTION_ARGS);
 PG_FUNCTION_INFO_V1(get_upstream_last_seen);
 
+Datum		set_election_state(PG_FUNCTION_ARGS);
+PG_FUNCTION_INFO_V1(set_election_state);
+
+Datum		get_election_state(PG_FUNCTION_ARGS);
+PG_FUNCTION_INFO_V1(get_election_state);
+
+Datum		bump_node_records_version(PG_FUNCTION_ARGS);
+PG_FUNCTION_INFO_V1(bump_node_records_version);
+
+Datum		get_node_records_version(PG_FUNCTION_ARGS);
+PG_FUNCTION_INFO_V1(get_node_records_version);
+
+Datum		set_storage_latency(PG_FUNCTION_ARGS);
+PG_FUNCTION_INFO_V1(set_storage_latency);
+
+Datum		get_storage_latency(PG_FUNCTION_ARGS);
+PG_FUNCTION_INFO_V1(get_storage_latency);
+
+Datum		get_storage_latency_histogram(PG_FUNCTION_ARGS);
+PG_FUNCTION_INFO_V1(get_storage_latency_histogram);
+
+Datum		record_replication_sample(PG_FUNCTION_ARGS);
+PG_FUNCTION_INFO_V1(record_replication_sample);
+
+Datum		get_replication_samples(PG_FUNCTION_ARGS);
+PG_FUNCTION_INFO_V1(get_replication_samples);
+
 Datum		notify_follow_primary(PG_FUNCTION_ARGS);
 PG_FUNCTION_INFO_V1(notify_follow_primary);
 
@@ -231,11 +303,19 @@ repmgr_shmem_startup(void)
 		memset(shared_state->repmgrd_pidfile, 0, MAXPGPATH);
 		shared_state->repmgrd_paused = false;
 		shared_state->current_electoral_term = 0;
+		shared_state->local_node_priority = -1;
 		/* arbitrary "magic" date to indicate this field hasn't been updated */
 		shared_state->upstream_last_seen = POSTGRES_EPOCH_JDATE;
 		shared_state->voting_status = VS_NO_VOTE;
 		shared_state->candidate_node_id = UNKNOWN_NODE_ID;
 		shared_state->follow_new_primary = false;
+		/* start from a value which will differ from that seen before a restart */
+		shared_state->node_records_version = (int64) GetCurrentTimestamp();
+		memset(shared_state->storage_latency, 0, sizeof(shared_state->storage_latency));
+		memset(shared_state->storage_degraded, 0, sizeof(shared_state->storage_degraded));
+		shared_state->storage_latency_updated = 0;
+		SpinLockInit(&shared_state->replication_samples.mutex);
+		shared_state->replication_samples.next_sample = 0;
 		shared_state->bdr_failover_handler = UNKNOWN_NODE_ID;
 	}
 
@@ -418,6 +498,507 @@ get_upstream_last_seen(PG_FUNCTION_ARGS)
 }
 
 
+/*
+ * Store the node's current electoral term and priority, so they can be
+ * returned by get_election_state() without a catalog lookup.
+ */
+Datum
+set_election_state(PG_FUNCTION_ARGS)
+{
+	if (!shared_state)
+		PG_RETURN_VOID();
+
+	if (PG_ARGISNULL(0) || PG_ARGISNULL(1))
+		PG_RETURN_VOID();
+
+	LWLockAcquire(shared_state->lock, LW_EXCLUSIVE);
+
+	shared_state->current_electoral_term = PG_GETARG_INT32(0);
+	shared_state->local_node_priority = PG_GETARG_INT32(1);
+
+	LWLockRelease(shared_state->lock);
+
+	PG_RETURN_VOID();
+}
+
+
+/*
+ * Return all the information a promotion candidate needs about this
+ * node as a single row, so the election requires only one round trip
+ * per sibling.
+ *
+ * LSNs are returned as text, as the "pg_lsn" datatype is not available
+ * in PostgreSQL 9.3.
+ */
+Datum
+get_election_state(PG_FUNCTION_ARGS)
+{
+	TupleDesc	tupdesc;
+	Datum		values[9];
+	bool		nulls[9];
+	char		lsn_buf[64];
+
+	int			repmgrd_pid;
+	bool		repmgrd_paused;
+	TimestampTz upstream_last_seen;
+	int			current_electoral_term;
+	int			local_node_priority;
+
+	bool		in_recovery;
+	XLogRecPtr	last_wal_receive_lsn = InvalidXLogRecPtr;
+	XLogRecPtr	last_wal_replay_lsn = InvalidXLogRecPtr;
+	bool		wal_replay_paused = false;
+	int			upstream_last_seen_secs = -1;
+
+	if (!shared_state)
+		PG_RETURN_NULL();
+
+	if (get_call_result_type(fcinfo, NULL, &tupdesc) != TYPEFUNC_COMPOSITE)
+		elog(ERROR, "return type must be a row type");
+
+	LWLockAcquire(shared_state->lock, LW_SHARED);
+
+	repmgrd_pid = shared_state->repmgrd_pid;
+	repmgrd_paused = shared_state->repmgrd_paused;
+	upstream_last_seen = shared_state->upstream_last_seen;
+	current_electoral_term = shared_state->current_electoral_term;
+	local_node_priority = shared_state->local_node_priority;
+
+	LWLockRelease(shared_state->lock);
+
+	in_recovery = RecoveryInProgress();
+
+	if (in_recovery == true)
+	{
+#if (PG_VERSION_NUM >= 130000)
+		last_wal_receive_lsn = GetWalRcvFlushRecPtr(NULL, NULL);
+#else
+		last_wal_receive_lsn = GetWalRcvWriteRecPtr(NULL, NULL);
+#endif
+		last_wal_replay_lsn = GetXLogReplayRecPtr(NULL);
+
+#if (PG_VERSION_NUM >= 140000)
+		wal_replay_paused = (GetRecoveryPauseState() != RECOVERY_NOT_PAUSED);
+#else
+		wal_replay_paused = RecoveryIsPaused();
+#endif
+	}
+
+	/* see note in get_upstream_last_seen() */
+	if (upstream_last_seen != POSTGRES_EPOCH_JDATE)
+	{
+		long		secs;
+		int			microsecs;
+
+		TimestampDifference(upstream_last_seen, GetCurrentTimestamp(),
+							&secs, &microsecs);
+		upstream_last_seen_secs = (uint32) secs;
+	}
+
+	memset(nulls, 0, sizeof(nulls));
+
+	if (repmgrd_pid == UNKNOWN_PID)
+		nulls[0] = true;
+	else
+		values[0] = Int32GetDatum(repmgrd_pid);
+
+	values[1] = BoolGetDatum(repmgrd_paused);
+	values[2] = BoolGetDatum(in_recovery);
+
+	snprintf(lsn_buf, sizeof(lsn_buf), "%X/%X",
+			 (uint32) (last_wal_receive_lsn >> 32), (uint32) last_wal_receive_lsn);
+	values[3] = CStringGetTextDatum(lsn_buf);
+
+	snprintf(lsn_buf, sizeof(lsn_buf), "%X/%X",
+			 (uint32) (last_wal_replay_lsn >> 32), (uint32) last_wal_replay_lsn);
+	values[4] = CStringGetTextDatum(lsn_buf);
+
+	values[5] = BoolGetDatum(wal_replay_paused);
+	values[6] = Int32GetDatum(upstream_last_seen_secs);
+	values[7] = Int32GetDatum(current_electoral_term);
+
+	if (local_node_priority < 0)
+		nulls[8] = true;
+	else
+		values[8] = Int32GetDatum(local_node_priority);
+
+	PG_RETURN_DATUM(HeapTupleGetDatum(heap_form_tuple(tupdesc, values, nulls)));
+}
+
+
+/*
+ * Called by repmgr/repmgrd after modifying node records, so that cached
+ * copies of the records can be detected as stale.
+ */
+Datum
+bump_node_records_version(PG_FUNCTION_ARGS)
+{
+	if (!shared_state)
+		PG_RETURN_VOID();
+
+	LWLockAcquire(shared_state->lock, LW_EXCLUSIVE);
+	shared_state->node_records_version++;
+	LWLockRelease(shared_state->lock);
+
+	PG_RETURN_VOID();
+}
+
+
+Datum
+get_node_records_version(PG_FUNCTION_ARGS)
+{
+	int64		node_records_version;
+
+	if (!shared_state)
+		PG_RETURN_NULL();
+
+	LWLockAcquire(shared_state->lock, LW_SHARED);
+	node_records_version = shared_state->node_records_version;
+	LWLockRelease(shared_state->lock);
+
+	PG_RETURN_INT64(node_records_version);
+}
+
+
+/*
+ * Store the storage latency histogram for the specified probe, as
+ * collected by repmgrd.
+ */
+Datum
+set_storage_latency(PG_FUNCTION_ARGS)
+{
+	int			probe = PG_GETARG_INT32(0);
+	int64		samples = PG_GETARG_INT64(1);
+	int64		max_us = PG_GETARG_INT64(2);
+	ArrayType  *counts_array = PG_GETARG_ARRAYTYPE_P(3);
+	bool		degraded = PG_GETARG_BOOL(4);
+	Datum	   *counts = NULL;
+	bool	   *counts_nulls = NULL;
+	int			bucket_count = 0;
+	int			i;
+
+	if (!shared_state)
+		PG_RETURN_VOID();
+
+	if (probe < 0 || probe >= STORAGE_PROBE_TYPES)
+		elog(ERROR, "invalid storage probe %i", probe);
+
+	deconstruct_array(counts_array, INT8OID, sizeof(int64), FLOAT8PASSBYVAL, 'd',
+					  &counts, &counts_nulls, &bucket_count);
+
+	if (bucket_count != STORAGE_LATENCY_BUCKETS)
+		elog(ERROR, "expected %i storage latency buckets, received %i",
+			 STORAGE_LATENCY_BUCKETS, bucket_count);
+
+	LWLockAcquire(shared_state->lock, LW_EXCLUSIVE);
+
+	for (i = 0; i < STORAGE_LATENCY_BUCKETS; i++)
+	{
+		shared_state->storage_latency[probe].counts[i] = counts_nulls[i] ? 0 : DatumGetInt64(counts[i]);
+	}
+
+	shared_state->storage_latency[probe].samples = samples;
+	shared_state->storage_latency[probe].max_us = max_us;
+	shared_state->storage_degraded[probe] = degraded;
+	shared_state->storage_latency_updated = GetCurrentTimestamp();
+
+	LWLockRelease(shared_state->lock);
+
+	PG_RETURN_VOID();
+}
+
+
+/*
+ * Return one row per storage probe, summarising the latency histogram
+ * reported by repmgrd. No rows are returned if repmgrd has not reported
+ * any latencies since the server started.
+ */
+Datum
+get_storage_latency(PG_FUNCTION_ARGS)
+{
+	TupleDesc	tupdesc;
+	Tuplestorestate *tupstore = _init_materialized_srf(fcinfo, &tupdesc);
+	StorageLatencyHistogram storage_latency[STORAGE_PROBE_TYPES];
+	bool		storage_degraded[STORAGE_PROBE_TYPES];
+	TimestampTz storage_latency_updated;
+	int			probe;
+
+	if (!shared_state)
+		return (Datum) 0;
+
+	LWLockAcquire(shared_state->lock, LW_SHARED);
+	memcpy(storage_latency, shared_state->storage_latency, sizeof(storage_latency));
+	memcpy(storage_degraded, shared_state->storage_degraded, sizeof(storage_degraded));
+	storage_latency_updated = shared_state->storage_latency_updated;
+	LWLockRelease(shared_state->lock);
+
+	if (storage_latency_updated == 0)
+		return (Datum) 0;
+
+	for (probe = 0; probe < STORAGE_PROBE_TYPES; probe++)
+	{
+		Datum		values[7];
+		bool		nulls[7];
+		StorageLatencyHistogram *histogram = &storage_latency[probe];
+
+		memset(nulls, 0, sizeof(nulls));
+
+		values[0] = CStringGetTextDatum(storage_probe_name(probe));
+		values[1] = Int64GetDatum(histogram->samples);
+
+		if (histogram->samples > 0)
+		{
+			values[2] = Int64GetDatum(storage_latency_percentile_us(histogram, 50));
+			values[3] = Int64GetDatum(storage_latency_percentile_us(histogram, 99));
+			values[4] = Int64GetDatum(histogram->max_us);
+		}
+		else
+		{
+			nulls[2] = nulls[3] = nulls[4] = true;
+		}
+
+		values[5] = BoolGetDatum(storage_degraded[probe]);
+		values[6] = TimestampTzGetDatum(storage_latency_updated);
+
+		tuplestore_putvalues(tupstore, tupdesc, values, nulls);
+	}
+
+	return (Datum) 0;
+}
+
+
+/*
+ * Return the non-empty buckets of the storage latency histograms reported
+ * by repmgrd; "upper_us" is NULL for the bucket holding the largest values.
+ */
+Datum
+get_storage_latency_histogram(PG_FUNCTION_ARGS)
+{
+	TupleDesc	tupdesc;
+	Tuplestorestate *tupstore = _init_materialized_srf(fcinfo, &tupdesc);
+	StorageLatencyHistogram storage_latency[STORAGE_PROBE_TYPES];
+	int			probe;
+
+	if (!shared_state)
+		return (Datum) 0;
+
+	LWLockAcquire(shared_state->lock, LW_SHARED);
+	memcpy(storage_latency, shared_state->storage_latency, sizeof(storage_latency));
+	LWLockRelease(shared_state->lock);
+
+	for (probe = 0; probe < STORAGE_PROBE_TYPES; probe++)
+	{
+		int			i;
+
+		for (i = 0; i < STORAGE_LATENCY_BUCKETS; i++)
+		{
+			Datum		values[4];
+			bool		nulls[4];
+
+			if (storage_latency[probe].counts[i] == 0)
+				continue;
+
+			memset(nulls, 0, sizeof(nulls));
+
+			values[0] = CStringGetTextDatum(storage_probe_name(probe));
+			values[1] = Int64GetDatum(storage_latency_bucket_lower_us(i));
+
+			if (i == STORAGE_LATENCY_BUCKETS - 1)
+				nulls[2] = true;
+			else
+				values[2] = Int64GetDatum(storage_latency_bucket_lower_us(i + 1));
+
+			values[3] = Int64GetDatum(storage_latency[probe].counts[i]);
+
+			tuplestore_putvalues(tupstore, tupdesc, values, nulls);
+		}
+	}
+
+	return (Datum) 0;
+}
+
+
+/*
+ * Add a sample of the local standby's replication state to the ring
+ * buffer; called by repmgrd on each monitoring cycle. Returns false if no
+ * sample was recorded because the server is not in recovery.
+ *
+ * "lag_bytes" is the amount of WAL which the upstream has reported as
+ * written but which has not yet been replayed locally.
+ */
+Datum
+record_replication_sample(PG_FUNCTION_ARGS)
+{
+	ReplicationSample sample;
+	ReplicationSampleBuffer *buffer = NULL;
+	XLogRecPtr	latest_wal_end = InvalidXLogRecPtr;
+	TimestampTz upstream_last_seen;
+
+	if (!shared_state)
+		PG_RETURN_BOOL(false);
+
+	if (RecoveryInProgress() == false)
+		PG_RETURN_BOOL(false);
+
+	sample.sample_time = GetCurrentTimestamp();
+
+#if (PG_VERSION_NUM >= 130000)
+	sample.last_wal_receive_lsn = GetWalRcvFlushRecPtr(NULL, NULL);
+#else
+	sample.last_wal_receive_lsn = GetWalRcvWriteRecPtr(NULL, NULL);
+#endif
+	sample.last_wal_replay_lsn = GetXLogReplayRecPtr(NULL);
+
+	SpinLockAcquire(&WalRcv->mutex);
+	latest_wal_end = WalRcv->latestWalEnd;
+	SpinLockRelease(&WalRcv->mutex);
+
+	if (latest_wal_end == InvalidXLogRecPtr)
+		sample.lag_bytes = -1;
+	else if (latest_wal_end > sample.last_wal_replay_lsn)
+		sample.lag_bytes = (int64) (latest_wal_end - sample.last_wal_replay_lsn);
+	else
+		sample.lag_bytes = 0;
+
+	LWLockAcquire(shared_state->lock, LW_SHARED);
+	upstream_last_seen = shared_state->upstream_last_seen;
+	LWLockRelease(shared_state->lock);
+
+	/* see note in get_upstream_last_seen() */
+	if (upstream_last_seen == POSTGRES_EPOCH_JDATE)
+	{
+		sample.upstream_last_seen = -1;
+	}
+	else
+	{
+		long		secs;
+		int			microsecs;
+
+		TimestampDifference(upstream_last_seen, sample.sample_time,
+							&secs, &microsecs);
+		sample.upstream_last_seen = (int) secs;
+	}
+
+	buffer = &shared_state->replication_samples;
+
+	SpinLockAcquire(&buffer->mutex);
+	buffer->samples[buffer->next_sample % REPLICATION_SAMPLE_BUFFER_SIZE] = sample;
+	buffer->next_sample++;
+	SpinLockRelease(&buffer->mutex);
+
+	PG_RETURN_BOOL(true);
+}
+
+
+/*
+ * Return the replication samples currently held in the ring buffer,
+ * oldest first.
+ */
+Datum
+get_replication_samples(PG_FUNCTION_ARGS)
+{
+	TupleDesc	tupdesc;
+	Tuplestorestate *tupstore = _init_materialized_srf(fcinfo, &tupdesc);
+	ReplicationSampleBuffer *buffer = NULL;
+	ReplicationSample *samples = NULL;
+	uint64		first_sample;
+	uint64		end_sample;
+	uint64		end_sample_after_copy;
+	uint64		i;
+
+	if (!shared_state)
+		return (Datum) 0;
+
+	buffer = &shared_state->replication_samples;
+
+	SpinLockAcquire(&buffer->mutex);
+	end_sample = buffer->next_sample;
+	SpinLockRelease(&buffer->mutex);
+
+	samples = (ReplicationSample *) palloc(sizeof(buffer->samples));
+	memcpy(samples, buffer->samples, sizeof(buffer->samples));
+
+	SpinLockAcquire(&buffer->mutex);
+	end_sample_after_copy = buffer->next_sample;
+	SpinLockRelease(&buffer->mutex);
+
+	/* skip any samples overwritten while copying */
+	first_sample = end_sample_after_copy > REPLICATION_SAMPLE_BUFFER_SIZE
+		? end_sample_after_copy - REPLICATION_SAMPLE_BUFFER_SIZE
+		: 0;
+
+	for (i = first_sample; i < end_sample; i++)
+	{
+		ReplicationSample *sample = &samples[i % REPLICATION_SAMPLE_BUFFER_SIZE];
+		Datum		values[5];
+		bool		nulls[5];
+		char		lsn_buf[64];
+
+		memset(nulls, 0, sizeof(nulls));
+
+		values[0] = TimestampTzGetDatum(sample->sample_time);
+
+		snprintf(lsn_buf, sizeof(lsn_buf), "%X/%X",
+				 (uint32) (sample->last_wal_receive_lsn >> 32), (uint32) sample->last_wal_receive_lsn);
+		values[1] = CStringGetTextDatum(lsn_buf);
+
+		snprintf(lsn_buf, sizeof(lsn_buf), "%X/%X",
+				 (uint32) (sample->last_wal_replay_lsn >> 32), (uint32) sample->last_wal_replay_lsn);
+		values[2] = CStringGetTextDatum(lsn_buf);
+
+		if (sample->lag_bytes < 0)
+			nulls[3] = true;
+		else
+			values[3] = Int64GetDatum(sample->lag_bytes);
+
+		if (sample->upstream_last_seen < 0)
+			nulls[4] = true;
+		else
+			values[4] = Int32GetDatum(sample->upstream_last_seen);
+
+		tuplestore_putvalues(tupstore, tupdesc, values, nulls);
+	}
+
+	pfree(samples);
+
+	return (Datum) 0;
+}
+
+
+/*
+ * Set up a set-returning function to return its result in materialize
+ * mode, which is available in all supported PostgreSQL versions.
+ */
+static Tuplestorestate *
+_init_materialized_srf(FunctionCallInfo fcinfo, TupleDesc *tupdesc)
+{
+	ReturnSetInfo *rsinfo = (ReturnSetInfo *) fcinfo->resultinfo;
+	Tuplestorestate *tupstore;
+	MemoryContext oldcontext;
+
+	if (rsinfo == NULL || !IsA(rsinfo, ReturnSetInfo))
+		elog(ERROR, "set-valued function called in context that cannot accept a set");
+
+	if (!(rsinfo->allowedModes & SFRM_Materialize))
+		elog(ERROR, "materialize mode required, but it is not allowed in this context");
+
+	oldcontext = MemoryContextSwitchTo(rsinfo->econtext->ecxt_per_query_memory);
+
+	if (get_call_result_type(fcinfo, NULL, tupdesc) != TYPEFUNC_COMPOSITE)
+		elog(ERROR, "return type must be a row type");
+
+	tupstore = tuplestore_begin_heap(true, false, work_mem);
+
+	rsinfo->returnMode = SFRM_Materialize;
+	rsinfo->setResult = tupstore;
+	rsinfo->setDesc = *tupdesc;
+
+	MemoryContextSwitchTo(oldcontext);
+
+	return tupstore;
+}
+
+
 /* ===================*/
 /* failover functions */
 /* ===================*/
@@ -78,6 +78,7 @@
 #define DEFAULT_RECONNECTION_ATTEMPTS        6	 /* seconds */
 #define DEFAULT_RECONNECTION_INTERVAL        10  /* seconds */
 #define DEFAULT_MONITORING_INTERVAL          2	 /* seconds */
+#define MIN_MONITORING_INTERVAL_MS           100 /* milliseconds */
 #define DEFAULT_ASYNC_QUERY_TIMEOUT          60  /* seconds */
 #define DEFAULT_PRIMARY_NOTIFICATION_TIMEOUT 60  /* seconds */
 #define DEFAULT_PRIMARY_FOLLOW_TIMEOUT       60  /* seconds */
@@ -97,8 +98,15 @@
 #define DEFAULT_WAL_RECEIVE_CHECK_TIMEOUT    30  /* seconds */
 #define DEFAULT_SIBLING_NODES_DISCONNECT_TIMEOUT 30 /* seconds */
 #define DEFAULT_ELECTION_RERUN_INTERVAL      15  /* seconds */
+#define DEFAULT_ELECTION_POLL_TIMEOUT        10  /* seconds */
+#define DEFAULT_PEER_CONNECTION_CHECK_INTERVAL 10 /* seconds */
+#define DEFAULT_MONITORING_HISTORY_FLUSH_INTERVAL 10 /* seconds */
+#define DEFAULT_NODE_LIST_REFRESH_INTERVAL   60  /* seconds */
+#define DEFAULT_EVENT_NOTIFICATION_TIMEOUT   60  /* seconds */
+#define DEFAULT_EVENT_NOTIFICATION_RETRIES   0
 #define DEVICE_CHECK_TIMEOUT                 60  /* seconds */  /* highgo */
 #define DEVICE_CHECK_TIMES                   3   /* times */    /* highgo */
+#define DEVICE_CHECK_LATENCY_THRESHOLD       0   /* milliseconds */ /* highgo */
 #define DEFAULT_STANDBY_WAIT_TIMEOUT         10  /* mins */ /* highgo */
 
 #define WALRECEIVER_DISABLE_TIMEOUT_VALUE    86400000 /* milliseconds */
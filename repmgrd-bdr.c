@@ -69,6 +69,7 @@ monitor_bdr(void)
 	RecordStatus record_status;
 	NodeInfoListCell *cell;
 	instr_time	log_status_interval_start;
+	t_monitor_schedule schedule = T_MONITOR_SCHEDULE_INITIALIZER;
 
 	/* sanity check local database */
 	log_info(_("connecting to local database \"%s\""),
@@ -332,14 +333,14 @@ loop:
 						fprintf(stderr, "error reopening stderr to \"%s\": %s",
 								config_file_options.log_file, strerror(errno));
 					}
+
+					logger_reopen(config_file_options.log_file);
 				}
 			}
 			got_SIGHUP = false;
 		}
 
-		log_verbose(LOG_DEBUG, "sleeping %i seconds (\"monitor_interval_secs\")",
-					config_file_options.monitor_interval_secs);
-		sleep(config_file_options.monitor_interval_secs);
+		monitor_schedule_wait(&schedule);
 	}
 
 	return;
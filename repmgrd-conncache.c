@@ -0,0 +1,356 @@
+/*
+ * repmgrd-conncache.c - cache of connections to peer nodes for repmgrd
+ *
+ * Copyright (c) 2009-2020, HighGo Software Co.,Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * repmgrd keeps connections to known peer nodes open between monitoring
+ * cycles, so that time-critical operations such as a failover election
+ * do not need to begin by (re)connecting to every node.
+ *
+ * Connections are lent out with conn_cache_take() and handed back with
+ * conn_cache_return(); while lent out the caller owns the connection and
+ * may close it, in which case it will simply be reopened at the next
+ * maintenance cycle.
+ */
+
+#include "repmgr.h"
+#include "repmgrd.h"
+#include "repmgrd-conncache.h"
+
+
+typedef struct ConnCacheEntry
+{
+	int			node_id;
+	char		conninfo[MAXLEN];
+	PGconn	   *conn;
+	struct ConnCacheEntry *next;
+} ConnCacheEntry;
+
+static ConnCacheEntry *conn_cache = NULL;
+static instr_time last_maintenance;
+static bool maintenance_started = false;
+
+static ConnCacheEntry *_find_entry(int node_id);
+static void _add_entry(t_node_info *node_info, PGconn *conn);
+static void _remove_entry(ConnCacheEntry *entry);
+
+
+/*
+ * Indicate whether "peer_connection_check_interval" has elapsed since the
+ * cache was last maintained.
+ */
+bool
+conn_cache_maintenance_due(void)
+{
+	if (config_file_options.peer_connection_check_interval <= 0)
+		return conn_cache != NULL;
+
+	if (maintenance_started == false)
+		return true;
+
+	return calculate_elapsed(last_maintenance) >= config_file_options.peer_connection_check_interval;
+}
+
+
+/*
+ * Bring the cache into line with the provided list of peer nodes:
+ * connections to nodes no longer in the list are closed, cached
+ * connections are checked with a ping, and connections to any peers
+ * not yet cached are opened. Pings and connections are each made
+ * concurrently, waiting at most "monitor_interval" for each, so an
+ * unresponsive peer cannot stall the monitoring loop.
+ */
+void
+conn_cache_maintain(NodeInfoList *peer_nodes)
+{
+	ConnCacheEntry *entry = NULL;
+	ConnCacheEntry *next_entry = NULL;
+	NodeInfoList cached_nodes = T_NODE_INFO_LIST_INITIALIZER;
+	NodeInfoList missing_nodes = T_NODE_INFO_LIST_INITIALIZER;
+	NodeInfoListCell *cell = NULL;
+	NodeInfoListCell *next_cell = NULL;
+
+	if (config_file_options.peer_connection_check_interval <= 0)
+	{
+		conn_cache_clear();
+		return;
+	}
+
+	INSTR_TIME_SET_CURRENT(last_maintenance);
+	maintenance_started = true;
+
+	/* discard connections to departed peers */
+	for (entry = conn_cache; entry; entry = next_entry)
+	{
+		NodeInfoListCell *cached_cell = NULL;
+		t_node_info *node_info = NULL;
+
+		next_entry = entry->next;
+
+		for (cell = peer_nodes->head; cell; cell = cell->next)
+		{
+			if (cell->node_info->node_id == entry->node_id &&
+				strncmp(cell->node_info->conninfo, entry->conninfo, MAXLEN) == 0)
+				break;
+		}
+
+		if (cell == NULL)
+		{
+			log_debug("conn_cache_maintain(): node %i no longer a peer", entry->node_id);
+			_remove_entry(entry);
+			continue;
+		}
+
+		/* the caller may be using the node record's own connection */
+		node_info = (t_node_info *) pg_malloc0(sizeof(t_node_info));
+		node_info->node_id = cell->node_info->node_id;
+		strncpy(node_info->node_name, cell->node_info->node_name, sizeof(node_info->node_name) - 1);
+		node_info->type = cell->node_info->type;
+		node_info->conn = entry->conn;
+
+		cached_cell = (NodeInfoListCell *) pg_malloc0(sizeof(NodeInfoListCell));
+		cached_cell->node_info = node_info;
+
+		if (cached_nodes.tail)
+			cached_nodes.tail->next = cached_cell;
+		else
+			cached_nodes.head = cached_cell;
+
+		cached_nodes.tail = cached_cell;
+		cached_nodes.node_count++;
+	}
+
+	/* ping the remaining cached connections, and discard any which have failed */
+	ping_nodes_concurrently(&cached_nodes, config_file_options.monitor_interval_ms);
+
+	for (cell = cached_nodes.head; cell; cell = next_cell)
+	{
+		next_cell = cell->next;
+		entry = _find_entry(cell->node_info->node_id);
+
+		/* a connection which timed out has been closed */
+		entry->conn = cell->node_info->conn;
+
+		if (cell->ping_ok == false || PQstatus(entry->conn) != CONNECTION_OK)
+		{
+			log_debug("conn_cache_maintain(): connection to node %i has failed", entry->node_id);
+			_remove_entry(entry);
+		}
+
+		pfree(cell->node_info);
+		pfree(cell);
+	}
+
+	/* collate peers which need a new connection */
+	for (cell = peer_nodes->head; cell; cell = cell->next)
+	{
+		NodeInfoListCell *missing_cell = NULL;
+
+		if (cell->node_info->node_id == config_file_options.node_id)
+			continue;
+
+		if (_find_entry(cell->node_info->node_id) != NULL)
+			continue;
+
+		missing_cell = (NodeInfoListCell *) pg_malloc0(sizeof(NodeInfoListCell));
+		missing_cell->node_info = cell->node_info;
+
+		if (missing_nodes.tail)
+			missing_nodes.tail->next = missing_cell;
+		else
+			missing_nodes.head = missing_cell;
+
+		missing_nodes.tail = missing_cell;
+		missing_nodes.node_count++;
+	}
+
+	if (missing_nodes.node_count == 0)
+		return;
+
+	log_debug("conn_cache_maintain(): connecting to %i peer(s)", missing_nodes.node_count);
+
+	/* don't delay the monitoring loop by more than one cycle */
+	establish_db_connections_concurrently(&missing_nodes,
+										  config_file_options.monitor_interval_ms);
+
+	/* the node records belong to the caller, so only the cells are freed here */
+	for (cell = missing_nodes.head; cell; cell = next_cell)
+	{
+		next_cell = cell->next;
+
+		if (PQstatus(cell->node_info->conn) == CONNECTION_OK)
+			_add_entry(cell->node_info, cell->node_info->conn);
+		else
+			close_connection(&cell->node_info->conn);
+
+		cell->node_info->conn = NULL;
+		pfree(cell);
+	}
+}
+
+
+/*
+ * Remove the cached connection for the specified node and hand it to the
+ * caller; returns NULL if no usable connection is cached.
+ */
+PGconn *
+conn_cache_take(t_node_info *node_info)
+{
+	ConnCacheEntry *entry = _find_entry(node_info->node_id);
+	PGconn	   *conn = NULL;
+
+	if (entry == NULL)
+		return NULL;
+
+	if (strncmp(node_info->conninfo, entry->conninfo, MAXLEN) != 0 ||
+		PQstatus(entry->conn) != CONNECTION_OK)
+	{
+		_remove_entry(entry);
+		return NULL;
+	}
+
+	conn = entry->conn;
+	entry->conn = NULL;
+	_remove_entry(entry);
+
+	log_verbose(LOG_DEBUG, "conn_cache_take(): using cached connection to node %i",
+				node_info->node_id);
+
+	return conn;
+}
+
+
+/*
+ * Hand a connection back to the cache; if it is not in a reusable state,
+ * or caching is disabled, it is closed. "*conn" is set to NULL either way.
+ */
+void
+conn_cache_return(t_node_info *node_info, PGconn **conn)
+{
+	if (*conn == NULL)
+		return;
+
+	if (config_file_options.peer_connection_check_interval <= 0 ||
+		node_info->node_id == config_file_options.node_id ||
+		PQstatus(*conn) != CONNECTION_OK ||
+		PQtransactionStatus(*conn) != PQTRANS_IDLE ||
+		_find_entry(node_info->node_id) != NULL)
+	{
+		close_connection(conn);
+		return;
+	}
+
+	_add_entry(node_info, *conn);
+	*conn = NULL;
+}
+
+
+/*
+ * Populate the connection of each node in the list which does not
+ * already have one from the cache, where possible.
+ */
+void
+conn_cache_take_node_list(NodeInfoList *node_list)
+{
+	NodeInfoListCell *cell = NULL;
+
+	for (cell = node_list->head; cell; cell = cell->next)
+	{
+		PGconn	   *conn = NULL;
+
+		if (PQstatus(cell->node_info->conn) == CONNECTION_OK)
+			continue;
+
+		conn = conn_cache_take(cell->node_info);
+
+		if (conn == NULL)
+			continue;
+
+		close_connection(&cell->node_info->conn);
+		cell->node_info->conn = conn;
+	}
+}
+
+
+/*
+ * Hand back the connections of all nodes in the list; call this before
+ * clear_node_info_list() to keep the connections open.
+ */
+void
+conn_cache_return_node_list(NodeInfoList *node_list)
+{
+	NodeInfoListCell *cell = NULL;
+
+	for (cell = node_list->head; cell; cell = cell->next)
+	{
+		conn_cache_return(cell->node_info, &cell->node_info->conn);
+	}
+}
+
+
+void
+conn_cache_clear(void)
+{
+	while (conn_cache != NULL)
+		_remove_entry(conn_cache);
+}
+
+
+static ConnCacheEntry *
+_find_entry(int node_id)
+{
+	ConnCacheEntry *entry = NULL;
+
+	for (entry = conn_cache; entry; entry = entry->next)
+	{
+		if (entry->node_id == node_id)
+			return entry;
+	}
+
+	return NULL;
+}
+
+
+static void
+_add_entry(t_node_info *node_info, PGconn *conn)
+{
+	ConnCacheEntry *entry = (ConnCacheEntry *) pg_malloc0(sizeof(ConnCacheEntry));
+
+	entry->node_id = node_info->node_id;
+	strncpy(entry->conninfo, node_info->conninfo, MAXLEN);
+	entry->conn = conn;
+	entry->next = conn_cache;
+
+	conn_cache = entry;
+}
+
+
+static void
+_remove_entry(ConnCacheEntry *entry)
+{
+	ConnCacheEntry **link = &conn_cache;
+
+	while (*link != NULL && *link != entry)
+		link = &(*link)->next;
+
+	if (*link == NULL)
+		return;
+
+	*link = entry->next;
+
+	close_connection(&entry->conn);
+	pfree(entry);
+}
@@ -0,0 +1,30 @@
+/*
+ * repmgrd-conncache.h
+ * Copyright (c) 2009-2020, HighGo Software Co.,Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _REPMGRD_CONNCACHE_H_
+#define _REPMGRD_CONNCACHE_H_
+
+bool		conn_cache_maintenance_due(void);
+void		conn_cache_maintain(NodeInfoList *peer_nodes);
+PGconn	   *conn_cache_take(t_node_info *node_info);
+void		conn_cache_return(t_node_info *node_info, PGconn **conn);
+void		conn_cache_take_node_list(NodeInfoList *node_list);
+void		conn_cache_return_node_list(NodeInfoList *node_list);
+void		conn_cache_clear(void);
+
+#endif							/* _REPMGRD_CONNCACHE_H_ */
@@ -0,0 +1,474 @@
+/*
+ * repmgrd-diskcheck.c - data directory write probe for repmgrd
+ *
+ * Copyright (c) 2009-2020, HighGo Software Co.,Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * To determine whether the storage holding the data directory is working,
+ * a small block is written to a file in the data directory and flushed
+ * with fdatasync(). The WAL directory, which may be located on different
+ * storage, is also flushed with fsync().
+ *
+ * As I/O to failed storage can block indefinitely, the probe is carried
+ * out by a dedicated thread, and the monitoring loop waits for it with a
+ * deadline. A probe which is still blocked is not restarted; subsequent
+ * calls wait on the same probe, with the deadline counted from when it
+ * started.
+ *
+ * The latency of each probe is recorded in a histogram covering the last
+ * DISK_PROBE_HISTOGRAM_PERIOD to 2 * DISK_PROBE_HISTOGRAM_PERIOD seconds.
+ *
+ * The probe thread must not call any of the logging functions; all
+ * reporting is done by the caller.
+ */
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "repmgr.h"
+#include "repmgrd.h"
+#include "repmgrd-diskcheck.h"
+
+#define DISK_PROBE_FILE			"hg_repmgr_test"
+
+
+static pthread_mutex_t probe_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t probe_requested_cond;
+static pthread_cond_t probe_completed_cond;
+static bool probe_thread_started = false;
+
+/* the following are protected by "probe_lock" */
+static char probe_data_directory[MAXPGPATH] = "";
+static bool probe_requested = false;
+static bool probe_in_progress = false;
+static struct timespec probe_start;
+static uint64 probes_completed = 0;
+static int	last_probe_errno = 0;
+static int64 last_probe_latency_us = 0;
+static int64 window_latencies_us[STORAGE_PROBE_TYPES][DISK_PROBE_WINDOW];
+static int	window_samples[STORAGE_PROBE_TYPES];
+static StorageLatencyHistogram histogram_current[STORAGE_PROBE_TYPES];
+static StorageLatencyHistogram histogram_previous[STORAGE_PROBE_TYPES];
+static struct timespec histogram_rotated;
+
+/* only accessed by the probe thread (or the caller, if no thread) */
+static int	probe_fd[STORAGE_PROBE_TYPES] = {-1, -1};
+
+static bool _start_probe_thread(void);
+static void *_probe_thread_main(void *arg);
+static int	_probe(const char *data_directory, int64 *latency_us);
+static int	_probe_data_directory(const char *data_directory);
+static int	_probe_wal_directory(const char *data_directory);
+static void _record_latency(int64 *latency_us);
+static int64 _timespec_diff_us(struct timespec *end, struct timespec *start);
+static int	_compare_latency(const void *a, const void *b);
+
+
+/*
+ * Write to and flush the probe file in the data directory, waiting at
+ * most "timeout_ms" milliseconds from the start of the probe.
+ *
+ * On return, "latency_us" contains the duration of the probe, or the time
+ * waited so far if it timed out; "probe_errno" is set if the probe failed.
+ */
+DiskProbeResult
+disk_probe_run(const char *data_directory, int timeout_ms, int64 *latency_us, int *probe_errno)
+{
+	struct timespec deadline;
+	struct timespec now;
+	uint64		target_probe;
+	DiskProbeResult result = DISK_PROBE_OK;
+
+	*latency_us = 0;
+	*probe_errno = 0;
+
+	if (probe_thread_started == false && _start_probe_thread() == false)
+	{
+		int64		probe_latency_us[STORAGE_PROBE_TYPES];
+
+		/* fall back to probing synchronously */
+		clock_gettime(CLOCK_MONOTONIC, &probe_start);
+		*probe_errno = _probe(data_directory, probe_latency_us);
+		clock_gettime(CLOCK_MONOTONIC, &now);
+		*latency_us = _timespec_diff_us(&now, &probe_start);
+
+		if (*probe_errno == 0)
+			_record_latency(probe_latency_us);
+
+		return *probe_errno == 0 ? DISK_PROBE_OK : DISK_PROBE_ERROR;
+	}
+
+	pthread_mutex_lock(&probe_lock);
+
+	if (probe_in_progress == false && probe_requested == false)
+	{
+		strncpy(probe_data_directory, data_directory, MAXPGPATH);
+		clock_gettime(CLOCK_MONOTONIC, &probe_start);
+		probe_requested = true;
+		pthread_cond_signal(&probe_requested_cond);
+	}
+
+	target_probe = probes_completed + 1;
+
+	deadline = probe_start;
+	deadline.tv_sec += timeout_ms / 1000;
+	deadline.tv_nsec += (long) (timeout_ms % 1000) * 1000000;
+	if (deadline.tv_nsec >= 1000000000)
+	{
+		deadline.tv_sec++;
+		deadline.tv_nsec -= 1000000000;
+	}
+
+	while (probes_completed < target_probe)
+	{
+		if (pthread_cond_timedwait(&probe_completed_cond, &probe_lock, &deadline) == ETIMEDOUT)
+			break;
+	}
+
+	if (probes_completed < target_probe)
+	{
+		clock_gettime(CLOCK_MONOTONIC, &now);
+		*latency_us = _timespec_diff_us(&now, &probe_start);
+		result = DISK_PROBE_TIMEOUT;
+	}
+	else
+	{
+		*latency_us = last_probe_latency_us;
+		*probe_errno = last_probe_errno;
+		result = last_probe_errno == 0 ? DISK_PROBE_OK : DISK_PROBE_ERROR;
+	}
+
+	pthread_mutex_unlock(&probe_lock);
+
+	return result;
+}
+
+
+/*
+ * Once DISK_PROBE_WINDOW probes have completed since the last call which
+ * returned true, populate "stats" with their latency percentiles and
+ * return true; otherwise return false.
+ */
+bool
+disk_probe_window_complete(StorageProbeType probe, t_disk_probe_stats *stats)
+{
+	int64		latencies_us[DISK_PROBE_WINDOW];
+	int			samples;
+
+	pthread_mutex_lock(&probe_lock);
+
+	samples = window_samples[probe];
+
+	if (samples < DISK_PROBE_WINDOW)
+	{
+		pthread_mutex_unlock(&probe_lock);
+		return false;
+	}
+
+	memcpy(latencies_us, window_latencies_us[probe], sizeof(latencies_us));
+	window_samples[probe] = 0;
+
+	pthread_mutex_unlock(&probe_lock);
+
+	qsort(latencies_us, samples, sizeof(int64), _compare_latency);
+
+	stats->samples = samples;
+	stats->p50_us = latencies_us[(samples - 1) * 50 / 100];
+	stats->p99_us = latencies_us[(samples - 1) * 99 / 100];
+	stats->max_us = latencies_us[samples - 1];
+
+	return true;
+}
+
+
+/*
+ * Return the latency histogram for the specified probe, covering the last
+ * DISK_PROBE_HISTOGRAM_PERIOD to 2 * DISK_PROBE_HISTOGRAM_PERIOD seconds.
+ */
+void
+disk_probe_get_histogram(StorageProbeType probe, StorageLatencyHistogram *histogram)
+{
+	int			i;
+
+	pthread_mutex_lock(&probe_lock);
+
+	*histogram = histogram_current[probe];
+
+	for (i = 0; i < STORAGE_LATENCY_BUCKETS; i++)
+		histogram->counts[i] += histogram_previous[probe].counts[i];
+
+	histogram->samples += histogram_previous[probe].samples;
+
+	if (histogram_previous[probe].max_us > histogram->max_us)
+		histogram->max_us = histogram_previous[probe].max_us;
+
+	pthread_mutex_unlock(&probe_lock);
+}
+
+
+static bool
+_start_probe_thread(void)
+{
+	pthread_condattr_t condattr;
+	pthread_attr_t attr;
+	pthread_t	thread;
+	int			r;
+
+	pthread_condattr_init(&condattr);
+	pthread_condattr_setclock(&condattr, CLOCK_MONOTONIC);
+	pthread_cond_init(&probe_requested_cond, &condattr);
+	pthread_cond_init(&probe_completed_cond, &condattr);
+	pthread_condattr_destroy(&condattr);
+
+	pthread_attr_init(&attr);
+	pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+
+	r = pthread_create(&thread, &attr, _probe_thread_main, NULL);
+
+	pthread_attr_destroy(&attr);
+
+	if (r != 0)
+	{
+		log_warning(_("unable to start disk check thread; disk will be checked without a timeout"));
+		log_detail("%s", strerror(r));
+		return false;
+	}
+
+	probe_thread_started = true;
+
+	return true;
+}
+
+
+static void *
+_probe_thread_main(void *arg)
+{
+	sigset_t	sigs;
+	char		data_directory[MAXPGPATH];
+
+	/* leave signal handling to the main thread */
+	sigfillset(&sigs);
+	pthread_sigmask(SIG_BLOCK, &sigs, NULL);
+
+	for (;;)
+	{
+		struct timespec end;
+		int			probe_errno;
+		int64		latency_us;
+		int64		probe_latency_us[STORAGE_PROBE_TYPES];
+
+		pthread_mutex_lock(&probe_lock);
+
+		while (probe_requested == false)
+			pthread_cond_wait(&probe_requested_cond, &probe_lock);
+
+		probe_requested = false;
+		probe_in_progress = true;
+		strncpy(data_directory, probe_data_directory, MAXPGPATH);
+
+		pthread_mutex_unlock(&probe_lock);
+
+		probe_errno = _probe(data_directory, probe_latency_us);
+
+		pthread_mutex_lock(&probe_lock);
+
+		clock_gettime(CLOCK_MONOTONIC, &end);
+		latency_us = _timespec_diff_us(&end, &probe_start);
+
+		last_probe_errno = probe_errno;
+		last_probe_latency_us = latency_us;
+
+		if (probe_errno == 0)
+			_record_latency(probe_latency_us);
+
+		probe_in_progress = false;
+		probes_completed++;
+
+		pthread_cond_broadcast(&probe_completed_cond);
+		pthread_mutex_unlock(&probe_lock);
+	}
+
+	return NULL;
+}
+
+
+/*
+ * Probe the data directory and WAL directory in turn, storing the duration
+ * of each in "latency_us". Returns 0 on success, otherwise the errno of
+ * the failed operation.
+ */
+static int
+_probe(const char *data_directory, int64 *latency_us)
+{
+	struct timespec start;
+	struct timespec end;
+	int			probe_errno;
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	probe_errno = _probe_data_directory(data_directory);
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	latency_us[STORAGE_PROBE_DATA_DIRECTORY] = _timespec_diff_us(&end, &start);
+
+	if (probe_errno != 0)
+		return probe_errno;
+
+	start = end;
+	probe_errno = _probe_wal_directory(data_directory);
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	latency_us[STORAGE_PROBE_WAL_DIRECTORY] = _timespec_diff_us(&end, &start);
+
+	return probe_errno;
+}
+
+
+/*
+ * The probe file is kept open between probes, and reopened after any
+ * failure.
+ */
+static int
+_probe_data_directory(const char *data_directory)
+{
+	int		   *fd = &probe_fd[STORAGE_PROBE_DATA_DIRECTORY];
+	char		buf[512];
+	struct timespec now;
+
+	if (*fd == -1)
+	{
+		char		path[MAXPGPATH];
+
+		snprintf(path, MAXPGPATH, "%s/%s", data_directory, DISK_PROBE_FILE);
+
+		*fd = open(path, O_WRONLY | O_CREAT | O_CLOEXEC, S_IRUSR | S_IWUSR);
+
+		if (*fd == -1)
+			return errno;
+	}
+
+	clock_gettime(CLOCK_REALTIME, &now);
+	memset(buf, 0, sizeof(buf));
+	snprintf(buf, sizeof(buf), "%li.%09li\n", (long) now.tv_sec, now.tv_nsec);
+
+	errno = 0;
+
+	if (pwrite(*fd, buf, sizeof(buf), 0) != sizeof(buf) || fdatasync(*fd) != 0)
+	{
+		int			probe_errno = errno != 0 ? errno : EIO;
+
+		close(*fd);
+		*fd = -1;
+
+		return probe_errno;
+	}
+
+	return 0;
+}
+
+
+/*
+ * The WAL directory itself is flushed, to avoid creating files in it;
+ * "pg_xlog" is used if "pg_wal" does not exist (PostgreSQL 9.6 and earlier).
+ */
+static int
+_probe_wal_directory(const char *data_directory)
+{
+	int		   *fd = &probe_fd[STORAGE_PROBE_WAL_DIRECTORY];
+
+	if (*fd == -1)
+	{
+		char		path[MAXPGPATH];
+		struct stat statbuf;
+
+		snprintf(path, MAXPGPATH, "%s/pg_wal", data_directory);
+
+		if (stat(path, &statbuf) != 0 && errno == ENOENT)
+			snprintf(path, MAXPGPATH, "%s/pg_xlog", data_directory);
+
+		*fd = open(path, O_RDONLY | O_CLOEXEC);
+
+		if (*fd == -1)
+			return errno;
+	}
+
+	if (fsync(*fd) != 0)
+	{
+		int			probe_errno = errno;
+
+		close(*fd);
+		*fd = -1;
+
+		return probe_errno;
+	}
+
+	return 0;
+}
+
+
+/*
+ * Add the latencies of a successful probe to the current window and to the
+ * histograms. Caller must hold "probe_lock" if the probe thread is running.
+ */
+static void
+_record_latency(int64 *latency_us)
+{
+	struct timespec now;
+	int			probe;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	if (histogram_rotated.tv_sec == 0)
+	{
+		histogram_rotated = now;
+	}
+	else if (now.tv_sec - histogram_rotated.tv_sec >= DISK_PROBE_HISTOGRAM_PERIOD)
+	{
+		memcpy(histogram_previous, histogram_current, sizeof(histogram_previous));
+		memset(histogram_current, 0, sizeof(histogram_current));
+		histogram_rotated = now;
+	}
+
+	for (probe = 0; probe < STORAGE_PROBE_TYPES; probe++)
+	{
+		if (window_samples[probe] == DISK_PROBE_WINDOW)
+			window_samples[probe] = 0;
+
+		window_latencies_us[probe][window_samples[probe]++] = latency_us[probe];
+
+		storage_latency_add(&histogram_current[probe], latency_us[probe]);
+	}
+}
+
+
+static int64
+_timespec_diff_us(struct timespec *end, struct timespec *start)
+{
+	return (int64) (end->tv_sec - start->tv_sec) * 1000000 +
+		(end->tv_nsec - start->tv_nsec) / 1000;
+}
+
+
+static int
+_compare_latency(const void *a, const void *b)
+{
+	int64		la = *(const int64 *) a;
+	int64		lb = *(const int64 *) b;
+
+	if (la < lb)
+		return -1;
+
+	return la > lb ? 1 : 0;
+}
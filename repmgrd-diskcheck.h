@@ -0,0 +1,49 @@
+/*
+ * repmgrd-diskcheck.h
+ * Copyright (c) 2009-2020, HighGo Software Co.,Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _REPMGRD_DISKCHECK_H_
+#define _REPMGRD_DISKCHECK_H_
+
+#include "storagelatency.h"
+
+/* number of probes over which latency percentiles are calculated */
+#define DISK_PROBE_WINDOW		30
+
+/* the latency histogram covers between one and two of these periods */
+#define DISK_PROBE_HISTOGRAM_PERIOD	300 /* seconds */
+
+typedef enum
+{
+	DISK_PROBE_OK = 0,
+	DISK_PROBE_ERROR,
+	DISK_PROBE_TIMEOUT
+} DiskProbeResult;
+
+typedef struct
+{
+	int			samples;
+	int64		p50_us;
+	int64		p99_us;
+	int64		max_us;
+} t_disk_probe_stats;
+
+DiskProbeResult disk_probe_run(const char *data_directory, int timeout_ms, int64 *latency_us, int *probe_errno);
+bool		disk_probe_window_complete(StorageProbeType probe, t_disk_probe_stats *stats);
+void		disk_probe_get_histogram(StorageProbeType probe, StorageLatencyHistogram *histogram);
+
+#endif							/* _REPMGRD_DISKCHECK_H_ */
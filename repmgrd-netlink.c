@@ -0,0 +1,288 @@
+/*
+ * repmgrd-netlink.c - network link state monitoring for repmgrd
+ *
+ * Copyright (c) 2009-2020, HighGo Software Co.,Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Rather than reading /sys/class/net/<card>/carrier in every monitoring
+ * cycle, repmgrd subscribes to the kernel's link notifications
+ * (RTMGRP_LINK) on a netlink socket and caches the carrier state of the
+ * monitored network card. The initial state is read from sysfs once.
+ *
+ * The socket is non-blocking; the monitoring loop waits on it with
+ * link_monitor_fd(), so a loss of carrier can be acted on immediately
+ * rather than at the next scheduled cycle. If the socket cannot be
+ * opened, the carrier state is read from sysfs whenever it is requested.
+ */
+
+#include <unistd.h>
+#include <net/if.h>
+#include <sys/socket.h>
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
+
+#include "repmgr.h"
+#include "repmgrd.h"
+#include "repmgrd-netlink.h"
+
+/* not exposed by <net/if.h> */
+#ifndef IFF_LOWER_UP
+#define IFF_LOWER_UP			0x10000
+#endif
+
+/* large enough for a burst of RTM_NEWLINK messages */
+#define LINK_MONITOR_BUFSIZE	16384
+
+
+static int	link_socket = -1;
+static char link_name[IF_NAMESIZE] = "";
+static unsigned int link_index = 0;
+static bool link_up = true;
+
+static bool _read_sysfs_carrier(const char *ifname);
+static void _close_socket(void);
+
+
+/*
+ * Begin monitoring the named network card; any card previously
+ * monitored is forgotten.
+ *
+ * Returns false if the netlink socket could not be opened, in which case
+ * the carrier state will be read from sysfs on each request.
+ */
+bool
+link_monitor_start(const char *ifname)
+{
+	struct sockaddr_nl addr;
+
+	link_monitor_stop();
+
+	strncpy(link_name, ifname, IF_NAMESIZE - 1);
+	link_name[IF_NAMESIZE - 1] = '\0';
+
+	/* may be zero if the card does not (yet) exist; see link_monitor_process() */
+	link_index = if_nametoindex(link_name);
+
+	link_socket = socket(AF_NETLINK, SOCK_RAW | SOCK_NONBLOCK | SOCK_CLOEXEC, NETLINK_ROUTE);
+
+	if (link_socket < 0)
+	{
+		log_warning(_("unable to open netlink socket"));
+		log_detail("%s", strerror(errno));
+		log_hint(_("network card status will be checked via sysfs"));
+
+		link_up = _read_sysfs_carrier(link_name);
+		return false;
+	}
+
+	memset(&addr, 0, sizeof(addr));
+	addr.nl_family = AF_NETLINK;
+	addr.nl_groups = RTMGRP_LINK;
+
+	if (bind(link_socket, (struct sockaddr *) &addr, sizeof(addr)) < 0)
+	{
+		log_warning(_("unable to bind netlink socket"));
+		log_detail("%s", strerror(errno));
+		log_hint(_("network card status will be checked via sysfs"));
+
+		_close_socket();
+		link_up = _read_sysfs_carrier(link_name);
+		return false;
+	}
+
+	/* subscribe before reading, so no change can be missed */
+	link_up = _read_sysfs_carrier(link_name);
+
+	log_info(_("monitoring link state of network card \"%s\""), link_name);
+	log_detail(_("carrier is %s"), link_up ? "UP" : "DOWN");
+
+	return true;
+}
+
+
+/*
+ * Return the netlink socket, to be waited on for readability,
+ * or -1 if none is open.
+ */
+int
+link_monitor_fd(void)
+{
+	return link_socket;
+}
+
+
+/*
+ * Consume all pending link notifications and update the cached carrier
+ * state of the monitored card.
+ *
+ * Returns true if the carrier state has changed, or if the netlink socket
+ * has failed (and been closed), so the caller should reassess the link.
+ */
+bool
+link_monitor_process(void)
+{
+	char		buf[LINK_MONITOR_BUFSIZE];
+	bool		prev_link_up = link_up;
+
+	if (link_socket < 0)
+		return false;
+
+	for (;;)
+	{
+		ssize_t		len = recv(link_socket, buf, sizeof(buf), 0);
+		struct nlmsghdr *nh = NULL;
+
+		if (len < 0)
+		{
+			if (errno == EINTR)
+				continue;
+
+			if (errno == EAGAIN || errno == EWOULDBLOCK)
+				break;
+
+			/* notifications were dropped - resynchronise from sysfs */
+			if (errno == ENOBUFS)
+			{
+				log_debug("link_monitor_process(): netlink receive buffer overflowed");
+				link_index = if_nametoindex(link_name);
+				link_up = _read_sysfs_carrier(link_name);
+				continue;
+			}
+
+			log_warning(_("unable to read from netlink socket"));
+			log_detail("%s", strerror(errno));
+			log_hint(_("network card status will be checked via sysfs"));
+
+			_close_socket();
+			link_up = _read_sysfs_carrier(link_name);
+
+			return true;
+		}
+
+		for (nh = (struct nlmsghdr *) buf; NLMSG_OK(nh, (unsigned int) len); nh = NLMSG_NEXT(nh, len))
+		{
+			struct ifinfomsg *ifi = NULL;
+
+			if (nh->nlmsg_type != RTM_NEWLINK && nh->nlmsg_type != RTM_DELLINK)
+				continue;
+
+			ifi = (struct ifinfomsg *) NLMSG_DATA(nh);
+
+			/* card not known at startup - match by name and remember its index */
+			if (link_index == 0 && nh->nlmsg_type == RTM_NEWLINK)
+			{
+				struct rtattr *rta = IFLA_RTA(ifi);
+				int			rta_len = IFLA_PAYLOAD(nh);
+
+				for (; RTA_OK(rta, rta_len); rta = RTA_NEXT(rta, rta_len))
+				{
+					if (rta->rta_type == IFLA_IFNAME &&
+						strncmp((char *) RTA_DATA(rta), link_name, IF_NAMESIZE) == 0)
+					{
+						link_index = ifi->ifi_index;
+						break;
+					}
+				}
+			}
+
+			if (link_index == 0 || (unsigned int) ifi->ifi_index != link_index)
+				continue;
+
+			if (nh->nlmsg_type == RTM_DELLINK)
+			{
+				link_index = 0;
+				link_up = false;
+			}
+			else
+			{
+				/* IFF_LOWER_UP is what sysfs reports as "carrier" */
+				link_up = (ifi->ifi_flags & IFF_UP) && (ifi->ifi_flags & IFF_LOWER_UP);
+			}
+		}
+	}
+
+	if (link_up == prev_link_up)
+		return false;
+
+	log_verbose(LOG_DEBUG, "link_monitor_process(): carrier of network card \"%s\" is now %s",
+				link_name, link_up ? "UP" : "DOWN");
+
+	return true;
+}
+
+
+/*
+ * Indicate whether the monitored network card has carrier. As before
+ * the introduction of link monitoring, a card whose state cannot be
+ * determined is reported as up.
+ */
+bool
+link_monitor_link_up(void)
+{
+	if (link_name[0] == '\0')
+		return true;
+
+	if (link_socket < 0)
+		return _read_sysfs_carrier(link_name);
+
+	return link_up;
+}
+
+
+void
+link_monitor_stop(void)
+{
+	_close_socket();
+
+	link_name[0] = '\0';
+	link_index = 0;
+	link_up = true;
+}
+
+
+static bool
+_read_sysfs_carrier(const char *ifname)
+{
+	char		path[MAXPGPATH] = "";
+	FILE	   *fp = NULL;
+	int			c;
+
+	maxpath_snprintf(path, "/sys/class/net/%s/carrier", ifname);
+
+	fp = fopen(path, "r");
+
+	if (fp == NULL)
+	{
+		log_warning(_("unable to open file \"%s\""), path);
+		return true;
+	}
+
+	/* the read fails with EINVAL if the card is administratively down */
+	c = fgetc(fp);
+	fclose(fp);
+
+	return c == '1';
+}
+
+
+static void
+_close_socket(void)
+{
+	if (link_socket >= 0)
+	{
+		close(link_socket);
+		link_socket = -1;
+	}
+}
@@ -0,0 +1,195 @@
+/*
+ * repmgrd-nodecache.c - cache of node records for repmgrd
+ *
+ * Copyright (c) 2009-2020, HighGo Software Co.,Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * The node records change rarely, but repmgrd's monitoring loops need
+ * them on every cycle. Rather than rereading "repmgr.nodes" each time,
+ * a copy is kept here, and reread only when the node record version
+ * counter maintained by the repmgr extension changes, or at the latest
+ * after "node_list_refresh_interval" seconds.
+ *
+ * The version counter is held in shared memory on the node where the
+ * records were modified, i.e. the primary, so callers must pass a
+ * connection to the primary. Where no primary connection is available,
+ * callers must call node_cache_invalidate() first, so the records are
+ * reread rather than compared against a counter which never changes.
+ * The cache must also be invalidated when the primary changes, as each
+ * node's counter is independent.
+ *
+ * This cache is only intended for the monitoring loops; failover code
+ * must always read the current node records.
+ */
+
+#include "repmgr.h"
+#include "repmgrd.h"
+#include "repmgrd-nodecache.h"
+
+
+static NodeInfoList cached_node_list = T_NODE_INFO_LIST_INITIALIZER;
+static int64 cached_version = -1;
+static instr_time last_refresh;
+static bool cache_valid = false;
+
+static void _append_node_record(NodeInfoList *node_list, t_node_info *node_info);
+
+
+/*
+ * Reread the node records via "conn" if they are known to have changed,
+ * or if "node_list_refresh_interval" has elapsed; returns true if the
+ * records were reread.
+ *
+ * If the records cannot be reread, any previously cached records are
+ * retained.
+ */
+bool
+node_cache_refresh(PGconn *conn)
+{
+	int64		version = -1;
+	NodeInfoList node_list = T_NODE_INFO_LIST_INITIALIZER;
+
+	if (PQstatus(conn) != CONNECTION_OK)
+		return false;
+
+	version = get_node_records_version(conn);
+
+	if (cache_valid == true && config_file_options.node_list_refresh_interval > 0)
+	{
+		bool		interval_elapsed = calculate_elapsed(last_refresh) >= config_file_options.node_list_refresh_interval;
+
+		if (version != -1 && version == cached_version && interval_elapsed == false)
+			return false;
+
+		/* version counter not available - fall back to interval */
+		if (version == -1 && interval_elapsed == false)
+			return false;
+	}
+
+	/* read into a separate list, so the cached records survive a failure */
+	if (get_all_node_records(conn, &node_list) == false)
+	{
+		log_warning(_("unable to refresh node records"));
+
+		if (cache_valid == true)
+			log_detail(_("continuing with node records read %i seconds ago"),
+					   calculate_elapsed(last_refresh));
+
+		clear_node_info_list(&node_list);
+		return false;
+	}
+
+	clear_node_info_list(&cached_node_list);
+	cached_node_list = node_list;
+
+	log_verbose(LOG_DEBUG, "node_cache_refresh(): %i node records read (version " INT64_FORMAT ")",
+				cached_node_list.node_count, version);
+
+	cached_version = version;
+	INSTR_TIME_SET_CURRENT(last_refresh);
+	cache_valid = true;
+
+	return true;
+}
+
+
+/*
+ * Copy all cached node records into "node_list", refreshing the cache
+ * via "conn" first if necessary. Any existing contents of "node_list"
+ * are discarded.
+ */
+void
+node_cache_get_all_node_records(PGconn *conn, NodeInfoList *node_list)
+{
+	(void) node_cache_refresh(conn);
+
+	node_cache_copy_all_node_records(node_list);
+}
+
+
+/*
+ * Copy all cached node records into "node_list" without checking whether
+ * they are current; for use directly after node_cache_refresh(). Any
+ * existing contents of "node_list" are discarded.
+ */
+void
+node_cache_copy_all_node_records(NodeInfoList *node_list)
+{
+	NodeInfoListCell *cell = NULL;
+
+	clear_node_info_list(node_list);
+
+	for (cell = cached_node_list.head; cell; cell = cell->next)
+	{
+		_append_node_record(node_list, cell->node_info);
+	}
+}
+
+
+/*
+ * Cached equivalent of get_active_sibling_node_records().
+ */
+void
+node_cache_get_active_sibling_node_records(PGconn *conn, int node_id, int upstream_node_id, NodeInfoList *node_list)
+{
+	NodeInfoListCell *cell = NULL;
+
+	(void) node_cache_refresh(conn);
+
+	clear_node_info_list(node_list);
+
+	for (cell = cached_node_list.head; cell; cell = cell->next)
+	{
+		if (cell->node_info->upstream_node_id != upstream_node_id)
+			continue;
+
+		if (cell->node_info->node_id == node_id)
+			continue;
+
+		if (cell->node_info->active == false)
+			continue;
+
+		_append_node_record(node_list, cell->node_info);
+	}
+}
+
+
+/*
+ * Force the node records to be reread on next use, e.g. after a failover.
+ */
+void
+node_cache_invalidate(void)
+{
+	cache_valid = false;
+}
+
+
+static void
+_append_node_record(NodeInfoList *node_list, t_node_info *node_info)
+{
+	NodeInfoListCell *cell = (NodeInfoListCell *) pg_malloc0(sizeof(NodeInfoListCell));
+
+	cell->node_info = pg_malloc0(sizeof(t_node_info));
+	*cell->node_info = *node_info;
+	cell->node_info->conn = NULL;
+
+	if (node_list->tail)
+		node_list->tail->next = cell;
+	else
+		node_list->head = cell;
+
+	node_list->tail = cell;
+	node_list->node_count++;
+}
@@ -0,0 +1,28 @@
+/*
+ * repmgrd-nodecache.h
+ * Copyright (c) 2009-2020, HighGo Software Co.,Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _REPMGRD_NODECACHE_H_
+#define _REPMGRD_NODECACHE_H_
+
+bool		node_cache_refresh(PGconn *conn);
+void		node_cache_get_all_node_records(PGconn *conn, NodeInfoList *node_list);
+void		node_cache_copy_all_node_records(NodeInfoList *node_list);
+void		node_cache_get_active_sibling_node_records(PGconn *conn, int node_id, int upstream_node_id, NodeInfoList *node_list);
+void		node_cache_invalidate(void);
+
+#endif							/* _REPMGRD_NODECACHE_H_ */
@@ -23,6 +23,10 @@
 #include "repmgr.h"
 #include "repmgrd.h"
 #include "repmgrd-physical.h"
+#include "repmgrd-conncache.h"
+#include "repmgrd-nodecache.h"
+#include "repmgrd-diskcheck.h"
+#include "repmgrd-netlink.h"
 
 #include "controldata.h"
 
@@ -78,8 +82,10 @@ typedef enum
 
 static PGconn *upstream_conn = NULL;
 static PGconn *primary_conn = NULL;
-static short touch_label = 0; //highgo
 static instr_time unreachable_sync_standby_start; //highgo
+static bool storage_degraded[STORAGE_PROBE_TYPES]; //highgo
+static bool network_card_resolved = false; //highgo
+static bool network_card_lookup_failed = false; //highgo
 
 static FailoverState failover_state = FAILOVER_STATE_UNKNOWN;
 
@@ -88,8 +94,25 @@ static t_node_info upstream_node_info = T_NODE_INFO_INITIALIZER;
 
 static instr_time last_monitoring_update;
 
+/* monitoring samples not yet written to the primary */
+#define MONITORING_HISTORY_BUFFER_SIZE 256
+
+static t_monitoring_record monitoring_history_buffer[MONITORING_HISTORY_BUFFER_SIZE];
+static int	monitoring_history_buffer_count = 0;
+static instr_time last_monitoring_flush;
+
+/* interval at which a follower checks whether it has been notified of a new primary */
+#define PRIMARY_NOTIFICATION_POLL_INTERVAL_MS 100
+
+/* daily monitoring history partitions are created this many days in advance */
+#define MONITORING_HISTORY_PARTITIONS_AHEAD 3
+#define MONITORING_HISTORY_PARTITION_CHECK_INTERVAL 3600 /* seconds */
+
+static instr_time last_partition_maintenance;
+
 
 static ElectionResult do_election(NodeInfoList *sibling_nodes, int *new_primary_id);
+static void get_sibling_election_states(NodeInfoList *sibling_nodes);
 static const char *_print_election_result(ElectionResult result);
 
 static FailoverState promote_self(void);
@@ -110,6 +133,9 @@ static bool do_upstream_standby_failover(void);
 static bool do_witness_failover(void);
 
 static void update_monitoring_history(void);
+static void buffer_monitoring_record(t_monitoring_record *record);
+static void flush_monitoring_history(void);
+static void maintain_monitoring_history_partitions(void);
 
 static void handle_sighup(PGconn **conn, t_server_type server_type);
 
@@ -119,8 +145,8 @@ static ElectionResult execute_failover_validation_command(t_node_info *node_info
 static void parse_failover_validation_command(const char *template,  t_node_info *node_info, PQExpBufferData *out);
 static bool check_node_can_follow(PGconn *local_conn, XLogRecPtr local_xlogpos, PGconn *follow_target_conn, t_node_info *follow_target_node_info);
 static void check_disk(void); //highgo
-static void signalAlarm(int); //highgo
 static bool check_network_card_status(PGconn *conn, int node_id); //highgo
+static bool link_monitor_wake_handler(void *arg); //highgo
 static bool check_service_status_command(const char *command, PQExpBufferData *outputbuf);//highgo
 static NodeStatus check_service_status_is_shutdown_cleanly(const char *node_status_output, XLogRecPtr *checkPoint);//highgo
 static void exec_node_rejoin_primary(NodeInfoList *my_node_list); //highgo
@@ -264,10 +290,16 @@ void
 monitor_streaming_primary(void)
 {
 	instr_time	log_status_interval_start;
+	t_monitor_schedule schedule = T_MONITOR_SCHEDULE_INITIALIZER;
     NodeInfoList mynodes = T_NODE_INFO_LIST_INITIALIZER;
 
 	reset_node_voting_status();
 
+    /* highgo: the network card is looked up again, in case it was changed */
+    network_card_resolved = false;
+
+	INSTR_TIME_SET_ZERO(last_partition_maintenance);
+
     /*
     if((config_file_options.check_brain_split) && is_BS(local_conn,local_node_info.node_id))
     {
@@ -317,12 +349,11 @@ monitor_streaming_primary(void)
 	local_node_info.node_status = NODE_STATUS_UP;
 
     /* highgo: read nodes for auto rejoin */
-    get_all_node_records(local_conn, &mynodes);
+    node_cache_get_all_node_records(local_conn, &mynodes);
 	while (true)
 	{
 		/*
-		 * TODO: cache node list here, refresh at `node_list_refresh_interval`
-		 * also return reason for inavailability so we can log it
+		 * TODO: return reason for inavailability so we can log it
 		 */
 
 		check_connection(&local_node_info, &local_conn);
@@ -458,6 +489,15 @@ monitor_streaming_primary(void)
         else /* highgo: local node is reachable */
         {
             check_sync_async(&mynodes);
+
+            /* keep connections to standbys open for use by check_sync_async() */
+            if (conn_cache_maintenance_due() == true)
+                conn_cache_maintain(&mynodes);
+
+            maintain_monitoring_history_partitions();
+
+            /* write any events recorded while this node was not the primary */
+            replay_event_spool(local_conn);
         }
 
 
@@ -548,12 +588,17 @@ loop:
 		if (got_SIGHUP)
 		{
 			handle_sighup(&local_conn, PRIMARY);
+			network_card_resolved = false;
 		}
 
-        /* highgo: refresh the node_list in case any new node registered or unregistered */
+        /*
+         * highgo: refresh the node_list in case any new node registered or unregistered;
+         * the records are only reread if they have changed
+         */
         if(is_server_available(local_node_info.conninfo) && (local_node_info.node_status == NODE_STATUS_UP))
         {
-            hg_get_all_node_records(local_conn, &mynodes);
+            if (node_cache_refresh(local_conn) == true)
+                node_cache_copy_all_node_records(&mynodes);
 
             if(config_file_options.check_brain_split)
             {
@@ -606,11 +651,15 @@ loop:
             }
         }
    
+		/*
+		 * Wake immediately if the local node goes away; highgo: or if the
+		 * network card loses carrier
+		 */
+		monitor_schedule_clear_wake_fds(&schedule);
+		monitor_schedule_add_wake_conn(&schedule, local_conn);
+		monitor_schedule_add_wake_fd(&schedule, link_monitor_fd(), link_monitor_wake_handler, NULL);
 
-		log_verbose(LOG_DEBUG, "sleeping %i seconds (parameter \"monitor_interval_secs\")",
-					config_file_options.monitor_interval_secs);
-
-		sleep(config_file_options.monitor_interval_secs);
+		monitor_schedule_wait(&schedule);
 	}
 }
 
@@ -830,6 +879,7 @@ monitor_streaming_standby(void)
 {
 	RecordStatus record_status;
 	instr_time	log_status_interval_start;
+	t_monitor_schedule schedule = T_MONITOR_SCHEDULE_INITIALIZER;
 
 	MonitoringState local_monitoring_state = MS_NORMAL;
 	instr_time	local_degraded_monitoring_start;
@@ -841,6 +891,9 @@ monitor_streaming_standby(void)
 
 	reset_node_voting_status();
 
+	/* the upstream (and possibly the primary) may have changed */
+	node_cache_invalidate();
+
 	INSTR_TIME_SET_ZERO(last_monitoring_update);
 
 	/*
@@ -1463,6 +1516,7 @@ DEGRADED_LABEL:
 														&sibling_nodes);
 						notify_followers(&sibling_nodes, local_node_info.node_id);
 
+						conn_cache_return_node_list(&sibling_nodes);
 						clear_node_info_list(&sibling_nodes);
 
 						/* this will restart monitoring in primary mode */
@@ -1501,10 +1555,13 @@ DEGRADED_LABEL:
 				{
 					NodeInfoList sibling_nodes = T_NODE_INFO_LIST_INITIALIZER;
 
-					get_active_sibling_node_records(local_conn,
-													local_node_info.node_id,
-													local_node_info.upstream_node_id,
-													&sibling_nodes);
+					/* no primary to signal changes, so reread the records */
+					node_cache_invalidate();
+
+					node_cache_get_active_sibling_node_records(local_conn,
+															   local_node_info.node_id,
+															   local_node_info.upstream_node_id,
+															   &sibling_nodes);
 
 					if (sibling_nodes.node_count > 0)
 					{
@@ -1524,7 +1581,10 @@ DEGRADED_LABEL:
 								continue;
 							}
 
-							cell->node_info->conn = establish_db_connection(cell->node_info->conninfo, false);
+							cell->node_info->conn = conn_cache_take(cell->node_info);
+
+							if (cell->node_info->conn == NULL)
+								cell->node_info->conn = establish_db_connection(cell->node_info->conninfo, false);
 
 							if (PQstatus(cell->node_info->conn) != CONNECTION_OK)
 							{
@@ -1535,10 +1595,10 @@ DEGRADED_LABEL:
 							if (get_recovery_type(cell->node_info->conn) == RECTYPE_PRIMARY)
 							{
 								follow_node_id = cell->node_info->node_id;
-								close_connection(&cell->node_info->conn);
+								conn_cache_return(cell->node_info, &cell->node_info->conn);
 								break;
 							}
-							close_connection(&cell->node_info->conn);
+							conn_cache_return(cell->node_info, &cell->node_info->conn);
 						}
 
 						if (follow_node_id != UNKNOWN_NODE_ID)
@@ -1798,6 +1858,41 @@ loop:
 
 		refresh_node_record(local_conn, local_node_info.node_id, &local_node_info);
 
+		/* write any events recorded while the primary was not available */
+		replay_event_spool(primary_conn);
+
+		/* keep the values returned by repmgr.get_election_state() current */
+		if (PQstatus(local_conn) == CONNECTION_OK)
+			repmgrd_set_election_state(local_conn, local_node_info.priority);
+
+		/* add to the history available via repmgr.get_replication_samples() */
+		if (PQstatus(local_conn) == CONNECTION_OK)
+			record_replication_sample(local_conn);
+
+		/* keep connections to sibling nodes open for use during failover */
+		if (PQstatus(local_conn) == CONNECTION_OK && conn_cache_maintenance_due() == true)
+		{
+			NodeInfoList sibling_nodes = T_NODE_INFO_LIST_INITIALIZER;
+			PGconn	   *records_conn = primary_conn;
+
+			/*
+			 * Changes to the node records are signalled via the primary; if
+			 * it is not reachable, reread the records from the local node.
+			 */
+			if (PQstatus(primary_conn) != CONNECTION_OK)
+			{
+				records_conn = local_conn;
+				node_cache_invalidate();
+			}
+
+			node_cache_get_active_sibling_node_records(records_conn,
+													   local_node_info.node_id,
+													   local_node_info.upstream_node_id,
+													   &sibling_nodes);
+			conn_cache_maintain(&sibling_nodes);
+			clear_node_info_list(&sibling_nodes);
+		}
+
 		if (local_monitoring_state == MS_NORMAL && last_known_upstream_node_id != local_node_info.upstream_node_id)
         {
             /*
@@ -1830,11 +1925,14 @@ loop:
             }
         }
 
-		log_verbose(LOG_DEBUG, "sleeping %i seconds (parameter \"monitor_interval_secs\")",
-					config_file_options.monitor_interval_secs);
+		/* wake immediately if the upstream, primary or local node goes away */
+		monitor_schedule_clear_wake_fds(&schedule);
+		monitor_schedule_add_wake_conn(&schedule, upstream_conn);
+		if (primary_conn != upstream_conn)
+			monitor_schedule_add_wake_conn(&schedule, primary_conn);
+		monitor_schedule_add_wake_conn(&schedule, local_conn);
 
-
-		sleep(config_file_options.monitor_interval_secs);
+		monitor_schedule_wait(&schedule);
 	}
 }
 
@@ -1843,6 +1941,7 @@ void
 monitor_streaming_witness(void)
 {
 	instr_time	log_status_interval_start;
+	t_monitor_schedule schedule = T_MONITOR_SCHEDULE_INITIALIZER;
 	instr_time	witness_sync_interval_start;
 
 	RecordStatus record_status;
@@ -2112,10 +2211,13 @@ monitor_streaming_witness(void)
 				int			follow_node_id = UNKNOWN_NODE_ID;
 				NodeInfoList sibling_nodes = T_NODE_INFO_LIST_INITIALIZER;
 
-				get_active_sibling_node_records(local_conn,
-												local_node_info.node_id,
-												local_node_info.upstream_node_id,
-												&sibling_nodes);
+				/* no primary to signal changes, so reread the records */
+				node_cache_invalidate();
+
+				node_cache_get_active_sibling_node_records(local_conn,
+														   local_node_info.node_id,
+														   local_node_info.upstream_node_id,
+														   &sibling_nodes);
 
 				if (sibling_nodes.node_count > 0)
 				{
@@ -2325,10 +2427,12 @@ loop:
 			handle_sighup(&local_conn, WITNESS);
 		}
 
-		log_verbose(LOG_DEBUG, "sleeping %i seconds (parameter \"monitor_interval_secs\")",
-					config_file_options.monitor_interval_secs);
+		/* wake immediately if the primary or local node goes away */
+		monitor_schedule_clear_wake_fds(&schedule);
+		monitor_schedule_add_wake_conn(&schedule, primary_conn);
+		monitor_schedule_add_wake_conn(&schedule, local_conn);
 
-		sleep(config_file_options.monitor_interval_secs);
+		monitor_schedule_wait(&schedule);
 	}
 
 	return;
@@ -2344,6 +2448,9 @@ do_primary_failover(void)
 	NodeInfoList sibling_nodes = T_NODE_INFO_LIST_INITIALIZER;
 	int new_primary_id = UNKNOWN_NODE_ID;
 
+	/* node records will change as a result of the failover */
+	node_cache_invalidate();
+
 	/*
 	 * Double-check status of the local connection
 	 */
@@ -2384,6 +2491,8 @@ do_primary_failover(void)
 											local_node_info.upstream_node_id,
 											&check_sibling_nodes);
 
+			conn_cache_take_node_list(&check_sibling_nodes);
+
 			for (i = 0; i < config_file_options.sibling_nodes_disconnect_timeout; i++)
 			{
 				for (cell = check_sibling_nodes.head; cell; cell = cell->next)
@@ -2431,6 +2540,7 @@ do_primary_failover(void)
 						 check_sibling_nodes.node_count);
 			}
 
+			conn_cache_return_node_list(&check_sibling_nodes);
 			clear_node_info_list(&check_sibling_nodes);
 		}
 	}
@@ -2456,6 +2566,7 @@ do_primary_failover(void)
 		if (new_primary_id == UNKNOWN_NODE_ID)
 		{
 			log_notice(_("election cancelled"));
+			conn_cache_return_node_list(&sibling_nodes);
 			clear_node_info_list(&sibling_nodes);
 			return false;
 		}
@@ -2629,6 +2740,7 @@ do_primary_failover(void)
 		case FAILOVER_STATE_ELECTION_RERUN:
 
 			/* we no longer care about our former siblings */
+			conn_cache_return_node_list(&sibling_nodes);
 			clear_node_info_list(&sibling_nodes);
 
 			log_notice(_("rerunning election after %i seconds (\"election_rerun_interval\")"),
@@ -2731,6 +2843,7 @@ do_primary_failover(void)
 	}
 
 	/* we no longer care about our former siblings */
+	conn_cache_return_node_list(&sibling_nodes);
 	clear_node_info_list(&sibling_nodes);
 
 	return final_result;
@@ -2743,6 +2856,7 @@ static void
 update_monitoring_history(void)
 {
 	ReplInfo	replication_info;
+	t_monitoring_record record;
 	XLogRecPtr	primary_last_wal_location = InvalidXLogRecPtr;
 
 	long long unsigned int apply_lag_bytes = 0;
@@ -2817,17 +2931,112 @@ update_monitoring_history(void)
 		replication_lag_bytes = 0;
 	}
 
-	add_monitoring_record(primary_conn,
-						  local_conn,
-						  primary_node_id,
-						  local_node_info.node_id,
-						  replication_info.current_timestamp,
-						  primary_last_wal_location,
-						  replication_info.last_wal_receive_lsn,
-						  replication_info.last_xact_replay_timestamp,
-						  replication_lag_bytes,
-						  apply_lag_bytes);
+	memset(&record, 0, sizeof(record));
+
+	record.primary_node_id = primary_node_id;
+	record.standby_node_id = local_node_info.node_id;
+	strncpy(record.monitor_standby_timestamp,
+			replication_info.current_timestamp,
+			sizeof(record.monitor_standby_timestamp) - 1);
+	record.primary_last_wal_location = primary_last_wal_location;
+	record.last_wal_receive_lsn = replication_info.last_wal_receive_lsn;
+	strncpy(record.last_xact_replay_timestamp,
+			replication_info.last_xact_replay_timestamp,
+			sizeof(record.last_xact_replay_timestamp) - 1);
+	record.replication_lag_bytes = replication_lag_bytes;
+	record.apply_lag_bytes = apply_lag_bytes;
 
+	buffer_monitoring_record(&record);
+
+	set_standby_last_updated(local_conn);
+
+	flush_monitoring_history();
+}
+
+
+/*
+ * On the primary, periodically create the daily monitoring_history
+ * partitions needed over the next few days, so standbys' samples are not
+ * written to the default partition (from which old rows can only be
+ * removed with DELETE).
+ */
+static void
+maintain_monitoring_history_partitions(void)
+{
+	int			partitions_created = 0;
+
+	if (!INSTR_TIME_IS_ZERO(last_partition_maintenance) &&
+		calculate_elapsed(last_partition_maintenance) < MONITORING_HISTORY_PARTITION_CHECK_INTERVAL)
+		return;
+
+	INSTR_TIME_SET_CURRENT(last_partition_maintenance);
+
+	if (is_monitoring_history_partitioned(local_conn) == false)
+		return;
+
+	partitions_created = create_monitoring_history_partitions(local_conn,
+															  MONITORING_HISTORY_PARTITIONS_AHEAD);
+
+	if (partitions_created > 0)
+		log_info(_("created %i monitoring history partition(s)"), partitions_created);
+}
+
+
+/*
+ * Add a sample to the monitoring history buffer; if the buffer is full
+ * (the primary has not been writable for some time), the oldest sample
+ * is discarded.
+ */
+static void
+buffer_monitoring_record(t_monitoring_record *record)
+{
+	if (monitoring_history_buffer_count == MONITORING_HISTORY_BUFFER_SIZE)
+	{
+		log_warning(_("monitoring history buffer full, discarding oldest sample"));
+
+		memmove(&monitoring_history_buffer[0],
+				&monitoring_history_buffer[1],
+				sizeof(t_monitoring_record) * (MONITORING_HISTORY_BUFFER_SIZE - 1));
+		monitoring_history_buffer_count--;
+	}
+
+	monitoring_history_buffer[monitoring_history_buffer_count++] = *record;
+}
+
+
+/*
+ * Write buffered samples to the primary if "monitoring_history_flush_interval"
+ * has elapsed since the last write, or the buffer is full. The first sample
+ * is written immediately, so monitoring history is visible as soon as
+ * repmgrd starts.
+ */
+static void
+flush_monitoring_history(void)
+{
+	if (monitoring_history_buffer_count == 0)
+		return;
+
+	if (config_file_options.monitoring_history_flush_interval > 0 &&
+		monitoring_history_buffer_count < MONITORING_HISTORY_BUFFER_SIZE &&
+		!INSTR_TIME_IS_ZERO(last_monitoring_flush) &&
+		calculate_elapsed(last_monitoring_flush) < config_file_options.monitoring_history_flush_interval)
+		return;
+
+	/*
+	 * Retain the samples until the INSERT is known to have succeeded, and
+	 * retry once "monitoring_history_flush_interval" has elapsed again.
+	 */
+	if (add_monitoring_records(primary_conn,
+							   monitoring_history_buffer,
+							   monitoring_history_buffer_count) == false)
+	{
+		INSTR_TIME_SET_CURRENT(last_monitoring_flush);
+		return;
+	}
+
+	monitoring_history_buffer_count = 0;
+
+	INSTR_TIME_SET_CURRENT(last_monitoring_flush);
 	INSTR_TIME_SET_CURRENT(last_monitoring_update);
 }
 
@@ -3242,12 +3451,19 @@ notify_followers(NodeInfoList *standby_nodes, int follow_node_id)
 	{
 		log_verbose(LOG_DEBUG, "intending to notify node %i...", cell->node_info->node_id);
 
+		if (PQstatus(cell->node_info->conn) != CONNECTION_OK)
+		{
+			close_connection(&cell->node_info->conn);
+			cell->node_info->conn = conn_cache_take(cell->node_info);
+		}
+
 		if (PQstatus(cell->node_info->conn) != CONNECTION_OK)
 		{
 			log_info(_("reconnecting to node \"%s\" (node ID: %i)..."),
 					 cell->node_info->node_name,
 					 cell->node_info->node_id);
 
+			close_connection(&cell->node_info->conn);
 			cell->node_info->conn = establish_db_connection(cell->node_info->conninfo, false);
 		}
 
@@ -3282,21 +3498,40 @@ notify_followers(NodeInfoList *standby_nodes, int follow_node_id)
 static bool
 wait_primary_notification(int *new_primary_id)
 {
-	int			i;
+	instr_time	wait_start;
+	int			elapsed = 0;
+	int			last_logged = -1;
+
+	INSTR_TIME_SET_CURRENT(wait_start);
 
-	for (i = 0; i < config_file_options.primary_notification_timeout; i++)
+	for (;;)
 	{
 		if (get_new_primary(local_conn, new_primary_id) == true)
 		{
 			log_debug("new primary is %i; elapsed: %i seconds",
-					  *new_primary_id, i);
+					  *new_primary_id, calculate_elapsed(wait_start));
 			return true;
 		}
 
-		log_verbose(LOG_DEBUG, "waiting for new primary notification, %i of max %i seconds (\"primary_notification_timeout\")",
-					i, config_file_options.primary_notification_timeout);
+		elapsed = calculate_elapsed(wait_start);
 
-		sleep(1);
+		if (elapsed >= config_file_options.primary_notification_timeout)
+			break;
+
+		if (elapsed != last_logged)
+		{
+			log_verbose(LOG_DEBUG, "waiting for new primary notification, %i of max %i seconds (\"primary_notification_timeout\")",
+						elapsed, config_file_options.primary_notification_timeout);
+			last_logged = elapsed;
+		}
+
+		/*
+		 * The new primary is set in shared memory by notify_follow_primary();
+		 * checking it at a short interval means the node starts following
+		 * almost as soon as it is notified. (LISTEN/NOTIFY cannot be used
+		 * here, as this node is in recovery.)
+		 */
+		pg_usleep(PRIMARY_NOTIFICATION_POLL_INTERVAL_MS * 1000L);
 	}
 
 	log_warning(_("no notification received from new primary after %i seconds"),
@@ -3652,6 +3887,121 @@ _print_election_result(ElectionResult result)
 }
 
 
+/*
+ * Connect to all sibling nodes (where not already connected) and retrieve
+ * their election state concurrently, so the time taken is determined by
+ * the slowest responsive node rather than the sum of all connection
+ * timeouts; any node which has not responded within "election_poll_timeout"
+ * is treated as unreachable.
+ *
+ * A connection which was already open, e.g. one taken from the connection
+ * cache, may have been broken since it was last used, for instance by a
+ * restart of the node's PostgreSQL; if the query fails on such a connection,
+ * the node is reconnected and queried once more in the time remaining.
+ */
+static void
+get_sibling_election_states(NodeInfoList *sibling_nodes)
+{
+	NodeInfoList retry_nodes = T_NODE_INFO_LIST_INITIALIZER;
+	NodeInfoListCell *cell = NULL;
+	NodeInfoListCell *next_cell = NULL;
+	bool	   *reused = NULL;
+	instr_time	poll_start;
+	instr_time	poll_elapsed;
+	int			poll_timeout_ms;
+	int			i;
+
+	if (sibling_nodes->node_count == 0)
+		return;
+
+	INSTR_TIME_SET_CURRENT(poll_start);
+
+	/* use already-open connections where available */
+	conn_cache_take_node_list(sibling_nodes);
+
+	reused = pg_malloc0(sizeof(bool) * sibling_nodes->node_count);
+
+	for (cell = sibling_nodes->head, i = 0; cell; cell = cell->next, i++)
+		reused[i] = PQstatus(cell->node_info->conn) == CONNECTION_OK;
+
+	establish_db_connections_concurrently(sibling_nodes,
+										  config_file_options.election_poll_timeout * 1000);
+
+	INSTR_TIME_SET_CURRENT(poll_elapsed);
+	INSTR_TIME_SUBTRACT(poll_elapsed, poll_start);
+	poll_timeout_ms = config_file_options.election_poll_timeout * 1000 - (int) INSTR_TIME_GET_MILLISEC(poll_elapsed);
+
+	get_election_state_concurrently(sibling_nodes, poll_timeout_ms);
+
+	/* collate nodes whose reused connection turned out to be broken */
+	for (cell = sibling_nodes->head, i = 0; cell; cell = cell->next, i++)
+	{
+		NodeInfoListCell *retry_cell = NULL;
+
+		if (reused[i] == false || cell->election_state_valid == true ||
+			PQstatus(cell->node_info->conn) == CONNECTION_OK)
+			continue;
+
+		log_info(_("existing connection to node \"%s\" (ID: %i) has failed, reconnecting"),
+				 cell->node_info->node_name,
+				 cell->node_info->node_id);
+
+		close_connection(&cell->node_info->conn);
+
+		retry_cell = (NodeInfoListCell *) pg_malloc0(sizeof(NodeInfoListCell));
+		retry_cell->node_info = cell->node_info;
+
+		if (retry_nodes.tail)
+			retry_nodes.tail->next = retry_cell;
+		else
+			retry_nodes.head = retry_cell;
+
+		retry_nodes.tail = retry_cell;
+		retry_nodes.node_count++;
+	}
+
+	pfree(reused);
+
+	if (retry_nodes.node_count == 0)
+		return;
+
+	INSTR_TIME_SET_CURRENT(poll_elapsed);
+	INSTR_TIME_SUBTRACT(poll_elapsed, poll_start);
+	poll_timeout_ms = config_file_options.election_poll_timeout * 1000 - (int) INSTR_TIME_GET_MILLISEC(poll_elapsed);
+
+	if (poll_timeout_ms > 0)
+	{
+		establish_db_connections_concurrently(&retry_nodes, poll_timeout_ms);
+
+		INSTR_TIME_SET_CURRENT(poll_elapsed);
+		INSTR_TIME_SUBTRACT(poll_elapsed, poll_start);
+		poll_timeout_ms = config_file_options.election_poll_timeout * 1000 - (int) INSTR_TIME_GET_MILLISEC(poll_elapsed);
+
+		get_election_state_concurrently(&retry_nodes, poll_timeout_ms);
+	}
+
+	/* the retry list's cells share the sibling list's node records */
+	for (cell = retry_nodes.head; cell; cell = next_cell)
+	{
+		NodeInfoListCell *sibling_cell = NULL;
+
+		next_cell = cell->next;
+
+		for (sibling_cell = sibling_nodes->head; sibling_cell; sibling_cell = sibling_cell->next)
+		{
+			if (sibling_cell->node_info != cell->node_info)
+				continue;
+
+			sibling_cell->election_state = cell->election_state;
+			sibling_cell->election_state_valid = cell->election_state_valid;
+			break;
+		}
+
+		pfree(cell);
+	}
+}
+
+
 /*
  * Failover decision for nodes attached to the current primary.
  *
@@ -3824,15 +4174,13 @@ do_election(NodeInfoList *sibling_nodes, int *new_primary_id)
 
 	initPQExpBuffer(&nodes_with_primary_visible);
 
+	get_sibling_election_states(sibling_nodes);
+
 	for (cell = sibling_nodes->head; cell; cell = cell->next)
 	{
-		ReplInfo	sibling_replication_info;
-
 		/* assume the worst case */
 		cell->node_info->node_status = NODE_STATUS_UNKNOWN;
 
-		cell->node_info->conn = establish_db_connection(cell->node_info->conninfo, false);
-
 		if (PQstatus(cell->node_info->conn) != CONNECTION_OK)
 		{
 			continue;
@@ -3855,24 +4203,37 @@ do_election(NodeInfoList *sibling_nodes, int *new_primary_id)
 		}
 
 		/*
-		 * check if repmgrd running - skip if not
-		 *
-		 * TODO: include pid query in replication info query?
-		 *
-		 * NOTE: from Pg12 we could execute "pg_promote()" from a running repmgrd;
-		 * here we'll need to find a way of ensuring only one repmgrd does this
+		 * The node's repmgr extension may predate repmgr.get_election_state();
+		 * fall back to querying its state individually, so a node which may
+		 * be a better candidate is not silently disregarded.
 		 */
-		if (repmgrd_get_pid(cell->node_info->conn) == UNKNOWN_PID)
+		if (cell->election_state_valid == false)
 		{
-			log_warning(_("repmgrd not running on node \"%s\" (ID: %i), skipping"),
+			log_debug("unable to retrieve election state for node %i via repmgr.get_election_state(), querying individually",
+					  cell->node_info->node_id);
+
+			cell->election_state_valid = get_election_state_by_node_queries(cell->node_info->conn,
+																			cell->node_info->type,
+																			&cell->election_state);
+		}
+
+		if (cell->election_state_valid == false)
+		{
+			log_warning(_("unable to retrieve election state for node \"%s\" (ID: %i), skipping"),
 						cell->node_info->node_name,
 						cell->node_info->node_id);
 			continue;
 		}
 
-		if (get_replication_info(cell->node_info->conn, cell->node_info->type, &sibling_replication_info) == false)
+		/*
+		 * check if repmgrd running - skip if not
+		 *
+		 * NOTE: from Pg12 we could execute "pg_promote()" from a running repmgrd;
+		 * here we'll need to find a way of ensuring only one repmgrd does this
+		 */
+		if (cell->election_state.repmgrd_pid == UNKNOWN_PID)
 		{
-			log_warning(_("unable to retrieve replication information for node \"%s\" (ID: %i), skipping"),
+			log_warning(_("repmgrd not running on node \"%s\" (ID: %i), skipping"),
 						cell->node_info->node_name,
 						cell->node_info->node_id);
 			continue;
@@ -3884,7 +4245,7 @@ do_election(NodeInfoList *sibling_nodes, int *new_primary_id)
 		 * to follow it.
 		 */
 
-		if (sibling_replication_info.in_recovery == false)
+		if (cell->election_state.in_recovery == false)
 		{
 			bool can_follow;
 
@@ -3914,13 +4275,13 @@ do_election(NodeInfoList *sibling_nodes, int *new_primary_id)
 		}
 
 		/* check if WAL replay on node is paused */
-		if (sibling_replication_info.wal_replay_paused == true)
+		if (cell->election_state.wal_replay_paused == true)
 		{
 			/*
 			 * Theoretically the repmgrd on the node should have resumed WAL play
 			 * at this point.
 			 */
-			if (sibling_replication_info.last_wal_receive_lsn > sibling_replication_info.last_wal_replay_lsn)
+			if (cell->election_state.last_wal_receive_lsn > cell->election_state.last_wal_replay_lsn)
 			{
 				log_warning(_("WAL replay on node \"%s\" (ID: %i) is paused and WAL is pending replay"),
 							cell->node_info->node_name,
@@ -3935,23 +4296,23 @@ do_election(NodeInfoList *sibling_nodes, int *new_primary_id)
 		 * configurable.
 		 */
 
-		if (sibling_replication_info.upstream_last_seen >= 0 && sibling_replication_info.upstream_last_seen < (config_file_options.monitor_interval_secs * 2))
+		if (cell->election_state.upstream_last_seen >= 0 && cell->election_state.upstream_last_seen < (config_file_options.monitor_interval_secs * 2))
 		{
 			nodes_with_primary_still_visible++;
 			log_notice(_("node %i last saw primary node %i second(s) ago, considering primary still visible"),
 					   cell->node_info->node_id,
-					   sibling_replication_info.upstream_last_seen);
+					   cell->election_state.upstream_last_seen);
 			appendPQExpBuffer(&nodes_with_primary_visible,
 							  " - node \"%s\" (ID: %i): %i second(s) ago\n",
 							  cell->node_info->node_name,
 							  cell->node_info->node_id,
-							  sibling_replication_info.upstream_last_seen);
+							  cell->election_state.upstream_last_seen);
 		}
 		else
 		{
 			log_info(_("node %i last saw primary node %i second(s) ago"),
 					 cell->node_info->node_id,
-					 sibling_replication_info.upstream_last_seen);
+					 cell->election_state.upstream_last_seen);
 		}
 
 
@@ -3973,7 +4334,7 @@ do_election(NodeInfoList *sibling_nodes, int *new_primary_id)
 
 
 		/* get node's last receive LSN - if "higher" than current winner, current node is candidate */
-		cell->node_info->last_wal_receive_lsn = sibling_replication_info.last_wal_receive_lsn;
+		cell->node_info->last_wal_receive_lsn = cell->election_state.last_wal_receive_lsn;
 
 		log_info(_("last receive LSN for sibling node \"%s\" (ID: %i) is: %X/%X"),
 				 cell->node_info->node_name,
@@ -4332,6 +4693,8 @@ handle_sighup(PGconn **conn, t_server_type server_type)
 			fprintf(stderr, "error reopening stderr to \"%s\": %s",
 					config_file_options.log_file, strerror(errno));
 		}
+
+		logger_reopen(config_file_options.log_file);
 	}
 
 	got_SIGHUP = false;
@@ -4644,55 +5007,168 @@ check_node_can_follow(PGconn *local_conn, XLogRecPtr local_xlogpos, PGconn *foll
  * highgo:
  * check if the data directory is writable
  * if not, kill the db process
+ *
+ * Also detect if the storage has become slow, i.e. the 99th percentile
+ * latency of the data or WAL directory probes over the last window exceeds
+ * "device_check_latency_threshold"; a "storage_degraded" event is created
+ * when this first happens. The latency histograms are published via the
+ * repmgr extension at the end of each window.
  */
 static
 void check_disk(void)
 {
-    PQExpBufferData disk_check_command_str;
-    int	r = -1;
-    int 	i;
+    DiskProbeResult result = DISK_PROBE_OK;
+    int64       latency_us = 0;
+    int         probe_errno = 0;
+    int         attempts = Max(config_file_options.device_check_times, 1);
+    int         i;
+    int         probe;
+    bool        window_complete = false;
+    bool        probe_window_complete[STORAGE_PROBE_TYPES] = {false};
+    bool        latency_exceeded[STORAGE_PROBE_TYPES] = {false};
+    bool        newly_degraded = false;
+    PQExpBufferData latency_details;
+
+    for (i = 0; i < attempts; i++)
+    {
+        result = disk_probe_run(config_file_options.data_directory,
+                                config_file_options.device_check_timeout * 1000,
+                                &latency_us,
+                                &probe_errno);
+
+        /* retrying is pointless if the probe is blocked */
+        if (result != DISK_PROBE_ERROR)
+            break;
 
-    initPQExpBuffer(&disk_check_command_str);
-    appendPQExpBuffer(&disk_check_command_str,
-            "touch %s/hg_repmgr_test", config_file_options.data_directory);
+        log_warning(_("unable to write to data directory \"%s\" (attempt %i of %i)"),
+                    config_file_options.data_directory, i + 1, attempts);
+        log_detail("%s", strerror(probe_errno));
 
-    /* use SIGALRM to handle the touch cmd hunging case */
-    signal(SIGALRM, signalAlarm);
-    alarm(config_file_options.device_check_timeout);
+        if (i + 1 < attempts)
+            sleep(config_file_options.device_check_timeout);
+    }
 
-    for(i = 0; i < config_file_options.device_check_times; i++)
+    initPQExpBuffer(&latency_details);
+
+    for (probe = 0; probe < STORAGE_PROBE_TYPES; probe++)
     {
-        r = system(disk_check_command_str.data);
+        t_disk_probe_stats stats;
 
-//        if (config_file_options.log_switch)
-//            log_notice("%d times try, result is %d... ", i + 1, r);
+        if (disk_probe_window_complete(probe, &stats) == false)
+            continue;
 
-        if (r != 0)
+        window_complete = true;
+        probe_window_complete[probe] = true;
+
+        log_verbose(LOG_DEBUG, "%s check latency over last %i probes: p50 %.3f ms, p99 %.3f ms, max %.3f ms",
+                    storage_probe_name(probe),
+                    stats.samples,
+                    (double) stats.p50_us / 1000,
+                    (double) stats.p99_us / 1000,
+                    (double) stats.max_us / 1000);
+
+        if (config_file_options.device_check_latency_threshold > 0 &&
+            stats.p99_us > (int64) config_file_options.device_check_latency_threshold * 1000)
         {
-            alarm(0);
-            sleep(config_file_options.device_check_timeout);
-            alarm(config_file_options.device_check_timeout);
-            continue;
+            latency_exceeded[probe] = true;
+
+            if (storage_degraded[probe] == false)
+                newly_degraded = true;
+
+            appendPQExpBuffer(&latency_details,
+                              _("%s%s p99 latency %.3f ms (p50 %.3f ms, max %.3f ms)"),
+                              latency_details.data[0] != '\0' ? "; " : "",
+                              storage_probe_name(probe),
+                              (double) stats.p99_us / 1000,
+                              (double) stats.p50_us / 1000,
+                              (double) stats.max_us / 1000);
         }
-        else
-            break;
     }
-    termPQExpBuffer(&disk_check_command_str);
 
-    if (0 == touch_label)
-        alarm(0);
-/*
-    if (config_file_options.log_switch)
+    if (window_complete == true)
     {
-        log_notice("timeout == %d, times == %d", config_file_options.device_check_timeout, config_file_options.device_check_times);
-        log_notice("r == %d, touch_label == %d", r, touch_label);
+        bool        event_recorded = true;
+
+        if (latency_details.data[0] != '\0')
+        {
+            log_warning(_("storage is slow: latency exceeds \"device_check_latency_threshold\" (%i ms)"),
+                        config_file_options.device_check_latency_threshold);
+            log_detail("%s", latency_details.data);
+        }
+
+        /* the event is created once, when any probe first exceeds the threshold */
+        if (newly_degraded == true)
+        {
+            PQExpBufferData event_details;
+
+            initPQExpBuffer(&event_details);
+            appendPQExpBuffer(&event_details,
+                              _("storage latency exceeds \"device_check_latency_threshold\" (%i ms): %s"),
+                              config_file_options.device_check_latency_threshold,
+                              latency_details.data);
+
+            if (PQstatus(local_conn) == CONNECTION_OK)
+            {
+                event_recorded = create_event_notification(local_conn,
+                                                           &config_file_options,
+                                                           config_file_options.node_id,
+                                                           "storage_degraded",
+                                                           true,
+                                                           event_details.data);
+            }
+            else
+            {
+                event_recorded = false;
+            }
+
+            /* the state is left unchanged, so the event is retried at the end of the next window */
+            if (event_recorded == false)
+                log_warning(_("unable to record \"storage_degraded\" event, will retry"));
+
+            termPQExpBuffer(&event_details);
+        }
+
+        for (probe = 0; probe < STORAGE_PROBE_TYPES; probe++)
+        {
+            /* only probes with a completed window have a new state */
+            if (probe_window_complete[probe] == false)
+                continue;
+
+            if (latency_exceeded[probe] == false && storage_degraded[probe] == true)
+            {
+                log_notice(_("%s latency is now below \"device_check_latency_threshold\" (%i ms)"),
+                           storage_probe_name(probe),
+                           config_file_options.device_check_latency_threshold);
+                storage_degraded[probe] = false;
+            }
+            else if (latency_exceeded[probe] == true && event_recorded == true)
+            {
+                storage_degraded[probe] = true;
+            }
+        }
+
+        if (PQstatus(local_conn) == CONNECTION_OK)
+        {
+            for (probe = 0; probe < STORAGE_PROBE_TYPES; probe++)
+            {
+                StorageLatencyHistogram histogram;
+
+                disk_probe_get_histogram(probe, &histogram);
+                repmgrd_set_storage_latency(local_conn, probe, &histogram, storage_degraded[probe]);
+            }
+        }
     }
-*/
-    if (r != 0 || 1 == touch_label)
+
+    termPQExpBuffer(&latency_details);
+
+    if (result != DISK_PROBE_OK)
     {	
         PQExpBufferData stop_service_command_str;
         int rt;
-        touch_label = 0;
+
+        if (result == DISK_PROBE_TIMEOUT)
+            log_warning(_("write to data directory has not completed after %.3f seconds"),
+                        (double) latency_us / 1000000);
 
         log_warning(_("PGDATA in which storage is not working"));			
         /*stop locale primary service*/
@@ -4714,72 +5190,76 @@ void check_disk(void)
     return;
 }
 
-/*
- * highgo: alarm called func
- */
-static void 
-signalAlarm(int signum)
-{
-	touch_label = 1;
-}
-
 /* 
  * check network card status
  * UP return 1, DOWN return 0
+ *
+ * The network card is looked up in the node record once, after which
+ * its carrier state is tracked via netlink (see repmgrd-netlink.c).
  * tianbing
  */
 static bool
 check_network_card_status(PGconn *conn, int node_id)
 {
-	FILE *pf = NULL;
 	char    network_card[MAXLEN] = "";
-	PQExpBufferData str;
-	int value;
 
-	if(NULL == conn)
+	if (network_card_resolved == false)
 	{
-		log_notice(_("end check_network_card_status, conn is null"));
-		return true;
-	}
-
-	if (get_network_card(conn, node_id, network_card))
-	{
-		initPQExpBuffer(&str);
-		appendPQExpBuffer(&str, "/sys/class/net/%s/carrier", network_card);
-        	
-		pf = fopen(str.data, "r");
-                termPQExpBuffer(&str);
-
-		if(!pf)
+		if(NULL == conn)
 		{
-			log_warning(_("can not open file:%s"), str.data);
+			log_notice(_("end check_network_card_status, conn is null"));
 			return true;
 		}
 
-		value = fgetc(pf) - 48;
-		
-		fclose(pf);
-
-		if (value == 1)
-		{
-			//if (config_file_options.log_switch)
-	//			log_debug(_("end check_network_card_status, return true"));
-			return true;
-		}
-		else
+		switch (get_network_card_record(conn, node_id, network_card))
 		{
-			log_warning(_("end check network card,return false, value:%d, status is DOWN "), value);
-			return false;
+			case RECORD_FOUND:
+				(void) link_monitor_start(network_card);
+				network_card_resolved = true;
+				network_card_lookup_failed = false;
+				break;
+
+			case RECORD_NOT_FOUND:
+				log_info(_("no network card configured for node %i, network card status will not be monitored"),
+						 node_id);
+				link_monitor_stop();
+				network_card_resolved = true;
+				network_card_lookup_failed = false;
+				break;
+
+			case RECORD_ERROR:
+				/* retry on the next monitoring cycle, warning only once */
+				if (network_card_lookup_failed == false)
+				{
+					log_warning(_("unable to determine network card for node %i, network card status is not being monitored"),
+								node_id);
+					log_hint(_("the lookup will be retried on each monitoring cycle"));
+					network_card_lookup_failed = true;
+				}
+				break;
 		}
-		
 	}
-	else
-	{
-	//	if (config_file_options.log_switch)
-	//		log_debug(_("didn't get network card, return true "));
 
-		return true;
+	/* pick up any change not yet seen by the monitoring loop */
+	(void) link_monitor_process();
+
+	if (link_monitor_link_up() == false)
+	{
+		log_warning(_("end check network card, return false, status is DOWN"));
+		return false;
 	}
+
+	return true;
+}
+
+/*
+ * highgo: end the wait for the next monitoring cycle if the carrier state
+ * of the network card has changed
+ */
+static bool
+link_monitor_wake_handler(void *arg)
+{
+	return link_monitor_process();
 }
 
 /*
@@ -5070,7 +5550,10 @@ check_sync_async(NodeInfoList *my_node_list)
 
             for (mycell = my_node_list->head; mycell; mycell = mycell->next)
             {
-                mycell->node_info->conn = establish_db_connection(mycell->node_info->conninfo, false);
+                mycell->node_info->conn = conn_cache_take(mycell->node_info);
+
+                if (mycell->node_info->conn == NULL)
+                    mycell->node_info->conn = establish_db_connection(mycell->node_info->conninfo, false);
 
                 if (get_recovery_type(mycell->node_info->conn) != RECTYPE_PRIMARY)
                 {
@@ -5099,7 +5582,7 @@ check_sync_async(NodeInfoList *my_node_list)
                         }
                     }
                 }
-                PQfinish(mycell->node_info->conn);
+                conn_cache_return(mycell->node_info, &mycell->node_info->conn);
             }
         }
     }
@@ -20,6 +20,7 @@
 
 #include <stdio.h>
 #include <signal.h>
+#include <poll.h>
 #include <stdlib.h>
 #include <sys/stat.h>
 
@@ -28,6 +29,7 @@
 #include "repmgrd.h"
 #include "repmgrd-physical.h"
 #include "repmgrd-bdr.h"
+#include "repmgrd-conncache.h"
 #include "configfile.h"
 #include "voting.h"
 
@@ -68,6 +70,8 @@ static void daemonize_process(void);
 static void check_and_create_pid_file(const char *pid_file);
 
 static void start_monitoring(void);
+static bool _conn_wake_handler(void *arg);
+static const char *_log_monitoring_state(void);
 
 
 #ifndef WIN32
@@ -351,6 +355,7 @@ main(int argc, char **argv)
 	}
 
 	logger_init(&config_file_options, progname());
+	logger_set_state_callback(_log_monitoring_state);
 
 	log_notice(_("repmgrd (%s %s) starting up"), progname(), REPMGR_VERSION);
 
@@ -541,6 +546,18 @@ main(int argc, char **argv)
 
 	repmgrd_set_pid(local_conn, getpid(), pid_file);
 
+	/* from here on, logging must not block monitoring */
+	logger_start_writer();
+
+	/*
+	 * started unconditionally, as "event_notification_command" may be set
+	 * by a configuration reload; notification scripts must not hold up
+	 * monitoring or failover
+	 */
+	event_notification_dispatcher_start();
+
+	if (config_file_options.repmgrd_event_spool_file[0] != '\0')
+		open_event_spool(config_file_options.repmgrd_event_spool_file);
 
 #ifndef WIN32
 	setup_event_handlers();
@@ -1017,6 +1034,202 @@ calculate_elapsed(instr_time start_time)
 }
 
 
+/*
+ * Wait until the next monitoring cycle is due.
+ *
+ * Cycles are scheduled at fixed multiples of "monitor_interval" on the
+ * monotonic clock, so the time taken by the work done in each cycle does
+ * not delay the following cycles. If a cycle overruns, any cycles which
+ * were missed are skipped rather than run back-to-back.
+ *
+ * If any descriptors have been registered with monitor_schedule_add_wake_fd(),
+ * the wait ends early when one becomes readable and its handler returns
+ * true; a handler must consume whatever made the descriptor readable. A
+ * cycle run early in this way does not affect the schedule.
+ *
+ * A signal interrupts the wait, so e.g. SIGHUP is handled promptly; the
+ * schedule itself is unaffected.
+ */
+void
+monitor_schedule_wait(t_monitor_schedule *schedule)
+{
+	struct timespec now;
+	int64		interval_ns = (int64) config_file_options.monitor_interval_ms * 1000000;
+	int64		now_ns;
+	int64		next_ns;
+
+	/* reap (or restart) the event notification worker, should it have exited */
+	event_notification_dispatcher_reap();
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	now_ns = (int64) now.tv_sec * 1000000000 + now.tv_nsec;
+
+	if (schedule->started == false)
+	{
+		next_ns = now_ns;
+		schedule->started = true;
+	}
+	else
+	{
+		next_ns = (int64) schedule->next_tick.tv_sec * 1000000000 + schedule->next_tick.tv_nsec;
+	}
+
+	/*
+	 * Normally the deadline just passed is advanced by one interval; if the
+	 * previous wait ended early, the deadline is still in the future and
+	 * remains unchanged.
+	 */
+	if (next_ns <= now_ns)
+	{
+		int64		intervals = (now_ns - next_ns) / interval_ns + 1;
+
+		if (intervals > 1)
+		{
+			log_verbose(LOG_DEBUG, "monitoring cycle overran by " INT64_FORMAT " ms; skipping " INT64_FORMAT " cycle(s)",
+						(now_ns - next_ns) / 1000000,
+						intervals - 1);
+		}
+
+		next_ns += intervals * interval_ns;
+	}
+
+	schedule->next_tick.tv_sec = next_ns / 1000000000;
+	schedule->next_tick.tv_nsec = next_ns % 1000000000;
+
+	log_verbose(LOG_DEBUG, "sleeping " INT64_FORMAT " ms (parameter \"monitor_interval\")",
+				(next_ns - now_ns) / 1000000);
+
+	if (schedule->wake_fd_count == 0)
+	{
+		(void) clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &schedule->next_tick, NULL);
+		return;
+	}
+
+	while (now_ns < next_ns)
+	{
+		struct pollfd wake_pollfds[MONITOR_SCHEDULE_MAX_WAKE_FDS];
+		int			i;
+		int			r;
+
+		for (i = 0; i < schedule->wake_fd_count; i++)
+		{
+			wake_pollfds[i].fd = schedule->wake_fds[i].fd;
+			wake_pollfds[i].events = POLLIN;
+			wake_pollfds[i].revents = 0;
+		}
+
+		/* round up, so as not to wake before the deadline */
+		r = poll(wake_pollfds, schedule->wake_fd_count, (int) ((next_ns - now_ns + 999999) / 1000000));
+
+		if (r < 0)
+		{
+			if (errno != EINTR)
+			{
+				log_warning(_("monitor_schedule_wait(): poll() returned with error"));
+				log_detail("%s", strerror(errno));
+				(void) clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &schedule->next_tick, NULL);
+			}
+
+			return;
+		}
+
+		for (i = 0; r > 0 && i < schedule->wake_fd_count; i++)
+		{
+			t_monitor_wake_fd *wake_fd = &schedule->wake_fds[i];
+
+			if (wake_pollfds[i].revents == 0)
+				continue;
+
+			if (wake_fd->handler == NULL || wake_fd->handler(wake_fd->arg) == true)
+			{
+				log_verbose(LOG_DEBUG, "monitor_schedule_wait(): woken before next scheduled cycle");
+				return;
+			}
+
+			/* a descriptor which has failed would otherwise wake us continually */
+			if (wake_pollfds[i].revents & POLLNVAL)
+				wake_fd->fd = -1;
+		}
+
+		clock_gettime(CLOCK_MONOTONIC, &now);
+		now_ns = (int64) now.tv_sec * 1000000000 + now.tv_nsec;
+	}
+}
+
+
+/*
+ * Forget all descriptors registered with monitor_schedule_add_wake_fd();
+ * as these will typically change between cycles, the monitoring loops
+ * register them afresh before each wait.
+ */
+void
+monitor_schedule_clear_wake_fds(t_monitor_schedule *schedule)
+{
+	schedule->wake_fd_count = 0;
+}
+
+
+/*
+ * Register a descriptor whose readability should end the current wait;
+ * "handler" may be NULL, in which case any readability ends the wait.
+ */
+void
+monitor_schedule_add_wake_fd(t_monitor_schedule *schedule, int fd, bool (*handler) (void *arg), void *arg)
+{
+	t_monitor_wake_fd *wake_fd = NULL;
+
+	if (fd < 0)
+		return;
+
+	if (schedule->wake_fd_count >= MONITOR_SCHEDULE_MAX_WAKE_FDS)
+	{
+		log_warning(_("unable to register more than %i descriptors with monitoring schedule"),
+					MONITOR_SCHEDULE_MAX_WAKE_FDS);
+		return;
+	}
+
+	wake_fd = &schedule->wake_fds[schedule->wake_fd_count++];
+
+	wake_fd->fd = fd;
+	wake_fd->handler = handler;
+	wake_fd->arg = arg;
+}
+
+
+/*
+ * Register a database connection, so that the wait ends as soon as the
+ * server closes it or the network connection is reset, rather than this
+ * only being noticed at the next monitoring cycle.
+ */
+void
+monitor_schedule_add_wake_conn(t_monitor_schedule *schedule, PGconn *conn)
+{
+	if (PQstatus(conn) != CONNECTION_OK)
+		return;
+
+	monitor_schedule_add_wake_fd(schedule, PQsocket(conn), _conn_wake_handler, conn);
+}
+
+
+/*
+ * Any data arriving on an otherwise idle connection is read here; if the
+ * connection turns out to have failed, the wait is ended.
+ */
+static bool
+_conn_wake_handler(void *arg)
+{
+	PGconn	   *conn = (PGconn *) arg;
+
+	if (PQconsumeInput(conn) == 0)
+	{
+		log_debug("_conn_wake_handler(): connection to server lost");
+		return true;
+	}
+
+	return PQstatus(conn) != CONNECTION_OK;
+}
+
+
 const char *
 print_monitoring_state(MonitoringState monitoring_state)
 {
@@ -1034,12 +1247,25 @@ print_monitoring_state(MonitoringState monitoring_state)
 }
 
 
+static const char *
+_log_monitoring_state(void)
+{
+	return print_monitoring_state(monitoring_state);
+}
+
+
 void
 terminate(int retval)
 {
 	if (PQstatus(local_conn)  == CONNECTION_OK)
 		repmgrd_set_pid(local_conn, UNKNOWN_PID, NULL);
 
+	conn_cache_clear();
+
+	event_notification_dispatcher_stop();
+
+	close_event_spool();
+
 	logger_shutdown();
 
 	if (pid_file[0] != '\0')
@@ -13,6 +13,34 @@
 #define OPT_NO_PID_FILE                  1000
 #define OPT_DAEMONIZE                    1001
 
+#define MONITOR_SCHEDULE_MAX_WAKE_FDS	4
+
+/*
+ * Descriptor which ends the wait for the next monitoring cycle early
+ * when it becomes readable and "handler" returns true; see
+ * monitor_schedule_wait()
+ */
+typedef struct t_monitor_wake_fd
+{
+	int			fd;
+	bool		(*handler) (void *arg);
+	void	   *arg;
+} t_monitor_wake_fd;
+
+/*
+ * Deadline of the next monitoring cycle, on the monotonic clock; see
+ * monitor_schedule_wait()
+ */
+typedef struct t_monitor_schedule
+{
+	struct timespec next_tick;
+	bool		started;
+	int			wake_fd_count;
+	t_monitor_wake_fd wake_fds[MONITOR_SCHEDULE_MAX_WAKE_FDS];
+} t_monitor_schedule;
+
+#define T_MONITOR_SCHEDULE_INITIALIZER { { 0, 0 }, false, 0, { { -1, NULL, NULL } } }
+
 extern volatile sig_atomic_t got_SIGHUP;
 extern MonitoringState monitoring_state;
 extern instr_time degraded_monitoring_start;
@@ -27,6 +55,10 @@ bool		check_upstream_connection(PGconn **conn, const char *conninfo);
 void		try_reconnect(PGconn **conn, t_node_info *node_info);
 
 int			calculate_elapsed(instr_time start_time);
+void		monitor_schedule_wait(t_monitor_schedule *schedule);
+void		monitor_schedule_clear_wake_fds(t_monitor_schedule *schedule);
+void		monitor_schedule_add_wake_fd(t_monitor_schedule *schedule, int fd, bool (*handler) (void *arg), void *arg);
+void		monitor_schedule_add_wake_conn(t_monitor_schedule *schedule, PGconn *conn);
 const char *print_monitoring_state(MonitoringState monitoring_state);
 
 void		update_registration(PGconn *conn);
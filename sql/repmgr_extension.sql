@@ -19,10 +19,21 @@ SELECT * FROM repmgr.show_nodes;
 -- functions
 SELECT repmgr.am_bdr_failover_handler(-1);
 SELECT repmgr.am_bdr_failover_handler(NULL);
+SELECT repmgr.bump_node_records_version();
+SELECT * FROM repmgr.get_election_state();
 SELECT repmgr.get_new_primary();
+SELECT repmgr.get_node_records_version();
+SELECT * FROM repmgr.get_replication_samples();
+SELECT * FROM repmgr.get_storage_latency();
+SELECT * FROM repmgr.get_storage_latency_histogram();
+SELECT repmgr.monitoring_history_create_partitions(0);
+SELECT repmgr.monitoring_history_drop_partitions(0);
+SELECT repmgr.monitoring_history_is_partitioned();
 SELECT repmgr.notify_follow_primary(-1);
 SELECT repmgr.notify_follow_primary(NULL);
+SELECT repmgr.record_replication_sample();
 SELECT repmgr.reset_voting_status();
+SELECT repmgr.set_election_state(1, 100);
 SELECT repmgr.set_local_node_id(-1);
 SELECT repmgr.set_local_node_id(NULL);
 SELECT repmgr.standby_get_last_updated();
@@ -0,0 +1,145 @@
+/*
+ * storagelatency.h
+ * Copyright (c) 2009-2020, HighGo Software Co.,Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Storage latency histogram, shared between repmgrd (which collects it)
+ * and the repmgr extension (which makes it available via SQL).
+ *
+ * Buckets are log-linear, as in an HDR histogram: each power of two
+ * between STORAGE_LATENCY_MIN_EXP and STORAGE_LATENCY_MAX_EXP microseconds
+ * is divided into STORAGE_LATENCY_SUB_BUCKETS equal buckets, so the
+ * relative error of a reported value is at most 1/STORAGE_LATENCY_SUB_BUCKETS.
+ * The first bucket holds all values below the lowest power of two, and the
+ * last all values above the highest.
+ */
+#ifndef _STORAGELATENCY_H_
+#define _STORAGELATENCY_H_
+
+#define STORAGE_LATENCY_MIN_EXP			6	/* 64us */
+#define STORAGE_LATENCY_MAX_EXP			25	/* ~33.5s */
+#define STORAGE_LATENCY_SUB_BUCKET_BITS	2
+#define STORAGE_LATENCY_SUB_BUCKETS		(1 << STORAGE_LATENCY_SUB_BUCKET_BITS)
+#define STORAGE_LATENCY_BUCKETS \
+	((STORAGE_LATENCY_MAX_EXP - STORAGE_LATENCY_MIN_EXP) * STORAGE_LATENCY_SUB_BUCKETS + 2)
+
+typedef enum
+{
+	STORAGE_PROBE_DATA_DIRECTORY = 0,
+	STORAGE_PROBE_WAL_DIRECTORY
+} StorageProbeType;
+
+#define STORAGE_PROBE_TYPES 2
+
+typedef struct StorageLatencyHistogram
+{
+	int64		counts[STORAGE_LATENCY_BUCKETS];
+	int64		samples;
+	int64		max_us;
+} StorageLatencyHistogram;
+
+
+static inline const char *
+storage_probe_name(int probe)
+{
+	return probe == STORAGE_PROBE_DATA_DIRECTORY ? "data_directory" : "wal_directory";
+}
+
+
+static inline int
+storage_latency_bucket(int64 latency_us)
+{
+	int			exp = STORAGE_LATENCY_MIN_EXP;
+
+	if (latency_us < (INT64CONST(1) << STORAGE_LATENCY_MIN_EXP))
+		return 0;
+
+	if (latency_us >= (INT64CONST(1) << STORAGE_LATENCY_MAX_EXP))
+		return STORAGE_LATENCY_BUCKETS - 1;
+
+	while (latency_us >= (INT64CONST(1) << (exp + 1)))
+		exp++;
+
+	return 1 + (exp - STORAGE_LATENCY_MIN_EXP) * STORAGE_LATENCY_SUB_BUCKETS
+		+ (int) ((latency_us - (INT64CONST(1) << exp)) >> (exp - STORAGE_LATENCY_SUB_BUCKET_BITS));
+}
+
+
+/* inclusive lower bound of a bucket */
+static inline int64
+storage_latency_bucket_lower_us(int bucket)
+{
+	int			exp;
+	int			sub;
+
+	if (bucket <= 0)
+		return 0;
+
+	if (bucket >= STORAGE_LATENCY_BUCKETS - 1)
+		return INT64CONST(1) << STORAGE_LATENCY_MAX_EXP;
+
+	exp = STORAGE_LATENCY_MIN_EXP + (bucket - 1) / STORAGE_LATENCY_SUB_BUCKETS;
+	sub = (bucket - 1) % STORAGE_LATENCY_SUB_BUCKETS;
+
+	return (INT64CONST(1) << exp) + ((int64) sub << (exp - STORAGE_LATENCY_SUB_BUCKET_BITS));
+}
+
+
+static inline void
+storage_latency_add(StorageLatencyHistogram *histogram, int64 latency_us)
+{
+	histogram->counts[storage_latency_bucket(latency_us)]++;
+	histogram->samples++;
+
+	if (latency_us > histogram->max_us)
+		histogram->max_us = latency_us;
+}
+
+
+/*
+ * Return the upper bound of the bucket containing the specified percentile,
+ * capped at the largest recorded value; -1 if the histogram is empty.
+ */
+static inline int64
+storage_latency_percentile_us(const StorageLatencyHistogram *histogram, int percentile)
+{
+	int64		target;
+	int64		cumulative = 0;
+	int			i;
+
+	if (histogram->samples == 0)
+		return -1;
+
+	target = (histogram->samples * percentile + 99) / 100;
+
+	if (target < 1)
+		target = 1;
+
+	for (i = 0; i < STORAGE_LATENCY_BUCKETS - 1; i++)
+	{
+		cumulative += histogram->counts[i];
+
+		if (cumulative >= target)
+		{
+			int64		upper_us = storage_latency_bucket_lower_us(i + 1);
+
+			return upper_us < histogram->max_us ? upper_us : histogram->max_us;
+		}
+	}
+
+	return histogram->max_us;
+}
+
+#endif							/* _STORAGELATENCY_H_ */
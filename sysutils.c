@@ -17,11 +17,50 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <fcntl.h>
+#include <poll.h>
 #include <signal.h>
+#include <time.h>
+#include <sys/socket.h>
 
 #include "repmgr.h"
 
 static bool _local_command(const char *command, PQExpBufferData *outputbuf, bool simple, int *return_value);
+static void _build_ssh_command(PQExpBufferData *ssh_command, const char *host, const char *user, const char *command, const char *ssh_options);
+static bool _start_command(t_remote_command *command, const char *shell_command);
+static void _finish_command(t_remote_command *command, bool completed);
+static void _event_notification_worker(int sock);
+static void _reap_retired_dispatchers(void);
+
+/* repmgrd's end of the socket to the event notification worker, if running */
+static int	dispatcher_socket = -1;
+static pid_t dispatcher_pid = -1;
+
+/* workers which have been stopped, but may still be executing queued commands */
+#define MAX_RETIRED_DISPATCHERS 8
+
+static pid_t retired_dispatcher_pids[MAX_RETIRED_DISPATCHERS];
+static int	retired_dispatcher_count = 0;
+
+/* maximum number of event notification commands the worker runs at once */
+#define EVENT_NOTIFICATION_PARALLELISM 4
+
+typedef struct t_event_notification_message
+{
+	int			timeout;
+	int			retries;
+	char		command[MAXPGPATH];
+} t_event_notification_message;
+
+/* an event notification command being executed, or awaiting a retry */
+typedef struct t_event_notification_job
+{
+	bool		in_use;
+	t_event_notification_message message;
+	t_remote_command command;
+	int			attempt;
+	struct timespec retry_at;	/* valid if not running */
+} t_event_notification_job;
 
 
 /*
@@ -116,27 +155,11 @@ remote_command(const char *host, const char *user, const char *command, const ch
 {
 	FILE	   *fp;
 	PQExpBufferData ssh_command;
-	PQExpBufferData ssh_host;
 
 	char		output[MAXLEN] = "";
 
-	initPQExpBuffer(&ssh_host);
-
-	if (*user != '\0')
-	{
-		appendPQExpBuffer(&ssh_host, "%s@", user);
-	}
-
-	appendPQExpBufferStr(&ssh_host, host);
-
-    initPQExpBuffer(&ssh_command);
-    appendPQExpBuffer(&ssh_command,
-                     "ssh -o Batchmode=yes %s %s %s",
-                     ssh_options,
-                     ssh_host.data,
-                     command);
-
-	termPQExpBuffer(&ssh_host);
+	initPQExpBuffer(&ssh_command);
+	_build_ssh_command(&ssh_command, host, user, command, ssh_options);
 
 	log_debug("remote_command():\n  %s", ssh_command.data);
 
@@ -184,6 +207,789 @@ remote_command(const char *host, const char *user, const char *command, const ch
 }
 
 
+/*
+ * Execute a set of commands, each either via ssh on a remote host or
+ * locally, with up to REMOTE_COMMAND_PARALLELISM commands running at once,
+ * so the total time taken is determined by the slowest host rather than
+ * the number of hosts.
+ *
+ * Each command's output is collected in its "output" buffer (initialised
+ * here; the caller must free it). As soon as a command finishes, or has
+ * not finished within "timeout" seconds and has been killed, the
+ * command's "completed" flag is set accordingly and "completed_callback"
+ * (if provided) is called, so results can be processed as they arrive.
+ * A "timeout" of zero or less means commands are never killed.
+ *
+ * If a command has an "output_callback", it is called whenever further
+ * output has been read, and may consume the output buffer's contents.
+ */
+void
+remote_commands_parallel(t_remote_command *commands, int count, const char *user, const char *ssh_options, int timeout,
+						 void (*completed_callback) (t_remote_command *command))
+{
+	remote_commands_parallel_bounded(commands, count, REMOTE_COMMAND_PARALLELISM,
+									 user, ssh_options, timeout, completed_callback);
+}
+
+
+/*
+ * As remote_commands_parallel(), but with at most "max_active" commands
+ * (itself limited to REMOTE_COMMAND_PARALLELISM) running at once; commands
+ * are started in array order.
+ */
+void
+remote_commands_parallel_bounded(t_remote_command *commands, int count, int max_active,
+								 const char *user, const char *ssh_options, int timeout,
+								 void (*completed_callback) (t_remote_command *command))
+{
+	struct pollfd *poll_fds = NULL;
+	int		   *poll_index = NULL;
+	int			next = 0;
+	int			active = 0;
+	int			i;
+
+	if (count == 0)
+		return;
+
+	if (max_active < 1 || max_active > REMOTE_COMMAND_PARALLELISM)
+		max_active = REMOTE_COMMAND_PARALLELISM;
+
+	poll_fds = pg_malloc0(sizeof(struct pollfd) * count);
+	poll_index = pg_malloc0(sizeof(int) * count);
+
+	for (i = 0; i < count; i++)
+	{
+		initPQExpBuffer(&commands[i].output);
+		commands[i].completed = false;
+		commands[i].exit_status = -1;
+		commands[i].pid = -1;
+		commands[i].fd = -1;
+	}
+
+	while (next < count || active > 0)
+	{
+		struct timespec now;
+		int			nfds = 0;
+		int			wait_ms = timeout > 0 ? timeout * 1000 : -1;
+		int			ret;
+
+		/* start as many further commands as we're allowed to */
+		while (next < count && active < max_active)
+		{
+			t_remote_command *command = &commands[next++];
+			PQExpBufferData shell_command;
+
+			initPQExpBuffer(&shell_command);
+
+			if (command->host == NULL)
+				appendPQExpBufferStr(&shell_command, command->command);
+			else
+				_build_ssh_command(&shell_command, command->host, user, command->command, ssh_options);
+
+			log_debug("remote_commands_parallel():\n  %s", shell_command.data);
+
+			if (_start_command(command, shell_command.data) == true)
+			{
+				active++;
+			}
+			else
+			{
+				log_error(_("unable to execute command:\n  %s"), shell_command.data);
+				log_detail("%s", strerror(errno));
+
+				if (completed_callback != NULL)
+					completed_callback(command);
+			}
+
+			termPQExpBuffer(&shell_command);
+		}
+
+		if (active == 0)
+			continue;
+
+		clock_gettime(CLOCK_MONOTONIC, &now);
+
+		/* kill any commands which have timed out, and find the next deadline */
+		for (i = 0; i < next; i++)
+		{
+			t_remote_command *command = &commands[i];
+			int			elapsed_ms;
+
+			if (command->fd < 0)
+				continue;
+
+			elapsed_ms = (int) ((now.tv_sec - command->start_time.tv_sec) * 1000 +
+								(now.tv_nsec - command->start_time.tv_nsec) / 1000000);
+
+			if (timeout > 0 && elapsed_ms >= timeout * 1000)
+			{
+				log_warning(_("command on host \"%s\" did not complete within %i seconds"),
+							command->host == NULL ? "localhost" : command->host,
+							timeout);
+
+				kill(-command->pid, SIGKILL);
+				_finish_command(command, false);
+				active--;
+
+				if (completed_callback != NULL)
+					completed_callback(command);
+
+				continue;
+			}
+
+			if (timeout > 0 && timeout * 1000 - elapsed_ms < wait_ms)
+				wait_ms = timeout * 1000 - elapsed_ms;
+
+			poll_fds[nfds].fd = command->fd;
+			poll_fds[nfds].events = POLLIN;
+			poll_fds[nfds].revents = 0;
+			poll_index[nfds] = i;
+			nfds++;
+		}
+
+		if (nfds == 0)
+			continue;
+
+		ret = poll(poll_fds, nfds, wait_ms);
+
+		if (ret < 0)
+		{
+			if (errno == EINTR)
+				continue;
+
+			log_warning(_("remote_commands_parallel(): poll() returned with error"));
+			log_detail("%s", strerror(errno));
+			break;
+		}
+
+		for (i = 0; i < nfds; i++)
+		{
+			t_remote_command *command = &commands[poll_index[i]];
+			char		buf[MAXLEN];
+			ssize_t		len;
+
+			if (poll_fds[i].revents == 0)
+				continue;
+
+			len = read(command->fd, buf, sizeof(buf));
+
+			if (len < 0 && (errno == EAGAIN || errno == EINTR))
+				continue;
+
+			if (len > 0)
+			{
+				appendBinaryPQExpBuffer(&command->output, buf, len);
+
+				if (command->output_callback != NULL)
+					command->output_callback(command);
+				continue;
+			}
+
+			/* end of output */
+			_finish_command(command, true);
+			active--;
+
+			if (command->output.data[0] != '\0')
+				log_verbose(LOG_DEBUG, "remote_commands_parallel(): output returned was:\n%s", command->output.data);
+			else
+				log_verbose(LOG_DEBUG, "remote_commands_parallel(): no output returned");
+
+			if (completed_callback != NULL)
+				completed_callback(command);
+		}
+	}
+
+	/* only reached with commands still running if poll() failed */
+	for (i = 0; i < next; i++)
+	{
+		if (commands[i].fd < 0)
+			continue;
+
+		kill(-commands[i].pid, SIGKILL);
+		_finish_command(&commands[i], false);
+
+		if (completed_callback != NULL)
+			completed_callback(&commands[i]);
+	}
+
+	pfree(poll_fds);
+	pfree(poll_index);
+}
+
+
+static void
+_build_ssh_command(PQExpBufferData *ssh_command, const char *host, const char *user, const char *command, const char *ssh_options)
+{
+	appendPQExpBufferStr(ssh_command, "ssh -o Batchmode=yes ");
+	appendPQExpBufferStr(ssh_command, ssh_options);
+	appendPQExpBufferChar(ssh_command, ' ');
+
+	if (*user != '\0')
+	{
+		appendPQExpBuffer(ssh_command, "%s@", user);
+	}
+
+	appendPQExpBuffer(ssh_command, "%s %s", host, command);
+}
+
+
+/*
+ * Start "shell_command" with its standard output connected to a
+ * non-blocking pipe. The command is placed in its own process group, so
+ * it can be killed together with any processes it has started.
+ */
+static bool
+_start_command(t_remote_command *command, const char *shell_command)
+{
+	int			pipe_fds[2];
+	pid_t		pid;
+
+	if (pipe(pipe_fds) != 0)
+		return false;
+
+	pid = fork();
+
+	if (pid < 0)
+	{
+		close(pipe_fds[0]);
+		close(pipe_fds[1]);
+		return false;
+	}
+
+	if (pid == 0)
+	{
+		int			devnull = open("/dev/null", O_RDONLY);
+
+		(void) setpgid(0, 0);
+
+		/* commands running in parallel must not compete for our stdin */
+		if (devnull >= 0)
+			dup2(devnull, STDIN_FILENO);
+
+		dup2(pipe_fds[1], STDOUT_FILENO);
+		close(pipe_fds[0]);
+		close(pipe_fds[1]);
+
+		execl("/bin/sh", "sh", "-c", shell_command, (char *) NULL);
+		_exit(127);
+	}
+
+	/* also set here, so the process group exists before we might kill it */
+	(void) setpgid(pid, pid);
+
+	close(pipe_fds[1]);
+	(void) fcntl(pipe_fds[0], F_SETFL, O_NONBLOCK);
+	(void) fcntl(pipe_fds[0], F_SETFD, FD_CLOEXEC);
+
+	command->pid = pid;
+	command->fd = pipe_fds[0];
+	clock_gettime(CLOCK_MONOTONIC, &command->start_time);
+
+	return true;
+}
+
+
+static void
+_finish_command(t_remote_command *command, bool completed)
+{
+	int			status;
+
+	close(command->fd);
+	command->fd = -1;
+
+	if (waitpid(command->pid, &status, 0) == command->pid &&
+		completed == true && WIFEXITED(status))
+		command->exit_status = WEXITSTATUS(status);
+
+	command->pid = -1;
+
+	command->completed = completed;
+}
+
+
+/*
+ * Start a worker process which executes event notification commands on
+ * behalf of repmgrd, so that a slow or hanging notification script cannot
+ * delay operations such as a failover.
+ *
+ * Commands are passed to the worker over a socket pair; the kernel's socket
+ * buffer acts as a bounded queue. The worker executes up to
+ * EVENT_NOTIFICATION_PARALLELISM commands at once, in the order received,
+ * and exits once repmgrd has closed its end of the socket and all queued
+ * commands have been executed.
+ *
+ * Returns false if the worker could not be started, in which case
+ * event_notification_dispatch() will execute commands synchronously.
+ */
+bool
+event_notification_dispatcher_start(void)
+{
+	int			sock_fds[2];
+	pid_t		pid;
+
+	if (dispatcher_socket >= 0)
+		return true;
+
+	if (socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, sock_fds) != 0)
+	{
+		log_warning(_("unable to create socket for event notification worker"));
+		log_detail("%s", strerror(errno));
+		return false;
+	}
+
+	/* ensure nothing buffered is written twice */
+	fflush(NULL);
+
+	pid = fork();
+
+	if (pid < 0)
+	{
+		log_warning(_("unable to start event notification worker"));
+		log_detail("%s", strerror(errno));
+
+		close(sock_fds[0]);
+		close(sock_fds[1]);
+		return false;
+	}
+
+	if (pid == 0)
+	{
+		close(sock_fds[0]);
+		logger_detach_writer();
+		_event_notification_worker(sock_fds[1]);
+	}
+
+	close(sock_fds[1]);
+	(void) fcntl(sock_fds[0], F_SETFL, O_NONBLOCK);
+
+	dispatcher_socket = sock_fds[0];
+	dispatcher_pid = pid;
+
+	log_debug("event_notification_dispatcher_start(): worker started with PID %i", (int) pid);
+
+	return true;
+}
+
+
+/*
+ * Close the socket to the event notification worker; the worker will
+ * execute any commands still queued, then exit. repmgrd does not wait
+ * for it, but reaps it via event_notification_dispatcher_reap() once it
+ * has exited.
+ */
+void
+event_notification_dispatcher_stop(void)
+{
+	if (dispatcher_socket < 0)
+		return;
+
+	close(dispatcher_socket);
+	dispatcher_socket = -1;
+
+	_reap_retired_dispatchers();
+
+	if (waitpid(dispatcher_pid, NULL, WNOHANG) == 0)
+	{
+		if (retired_dispatcher_count < MAX_RETIRED_DISPATCHERS)
+			retired_dispatcher_pids[retired_dispatcher_count++] = dispatcher_pid;
+		else
+			log_warning(_("unable to track event notification worker with PID %i"),
+						(int) dispatcher_pid);
+	}
+
+	dispatcher_pid = -1;
+}
+
+
+/*
+ * Reap any event notification workers which have exited; to be called
+ * regularly by repmgrd. If the current worker has exited unexpectedly,
+ * a new one is started.
+ */
+void
+event_notification_dispatcher_reap(void)
+{
+	int			status;
+
+	_reap_retired_dispatchers();
+
+	if (dispatcher_pid < 0)
+		return;
+
+	if (waitpid(dispatcher_pid, &status, WNOHANG) != dispatcher_pid)
+		return;
+
+	log_warning(_("event notification worker with PID %i exited unexpectedly"),
+				(int) dispatcher_pid);
+
+	if (WIFEXITED(status))
+		log_detail(_("exit code was %i"), WEXITSTATUS(status));
+	else if (WIFSIGNALED(status))
+		log_detail(_("terminated by signal %i"), WTERMSIG(status));
+
+	close(dispatcher_socket);
+	dispatcher_socket = -1;
+	dispatcher_pid = -1;
+
+	(void) event_notification_dispatcher_start();
+}
+
+
+static void
+_reap_retired_dispatchers(void)
+{
+	int			i = 0;
+
+	while (i < retired_dispatcher_count)
+	{
+		pid_t		pid = retired_dispatcher_pids[i];
+
+		/* still running */
+		if (waitpid(pid, NULL, WNOHANG) == 0)
+		{
+			i++;
+			continue;
+		}
+
+		log_verbose(LOG_DEBUG, "_reap_retired_dispatchers(): event notification worker with PID %i has exited",
+					(int) pid);
+
+		retired_dispatcher_pids[i] = retired_dispatcher_pids[--retired_dispatcher_count];
+	}
+}
+
+
+/*
+ * Execute an event notification command.
+ *
+ * If the event notification worker is running, the command is queued
+ * for execution with the provided timeout (in seconds) and number of
+ * retries, and this function returns immediately; if the queue is full,
+ * the notification is discarded. Otherwise the command is executed
+ * synchronously.
+ *
+ * Returns false if the command could not be queued, or was executed
+ * synchronously and failed.
+ */
+bool
+event_notification_dispatch(const char *command, int timeout, int retries)
+{
+	t_event_notification_message message;
+	size_t		message_len;
+	int			r;
+
+	if (dispatcher_socket >= 0)
+	{
+		memset(&message, 0, sizeof(message));
+		message.timeout = timeout;
+		message.retries = retries;
+		strncpy(message.command, command, sizeof(message.command) - 1);
+
+		/* only send as much of the command buffer as is needed */
+		message_len = offsetof(t_event_notification_message, command) + strlen(message.command) + 1;
+
+		if (send(dispatcher_socket, &message, message_len, MSG_DONTWAIT | MSG_NOSIGNAL) == (ssize_t) message_len)
+		{
+			log_verbose(LOG_DEBUG, "event_notification_dispatch(): command queued");
+			return true;
+		}
+
+		if (errno == EAGAIN || errno == EWOULDBLOCK)
+		{
+			log_warning(_("event notification queue is full, discarding notification"));
+			log_detail(_("event notification command was:\n  %s"), command);
+			return false;
+		}
+
+		log_warning(_("unable to queue event notification command"));
+		log_detail("%s", strerror(errno));
+		log_hint(_("event notification commands will now be executed synchronously"));
+
+		event_notification_dispatcher_stop();
+	}
+
+	r = system(command);
+
+	return r == 0;
+}
+
+
+static bool
+_start_event_notification_job(t_event_notification_job *job)
+{
+	memset(&job->command, 0, sizeof(job->command));
+	job->command.host = NULL;
+	job->command.command = job->message.command;
+	job->command.pid = -1;
+	job->command.fd = -1;
+	job->command.exit_status = -1;
+	initPQExpBuffer(&job->command.output);
+
+	log_debug("_start_event_notification_job():\n  %s", job->message.command);
+
+	if (_start_command(&job->command, job->message.command) == false)
+	{
+		log_error(_("unable to execute command:\n  %s"), job->message.command);
+		log_detail("%s", strerror(errno));
+		return false;
+	}
+
+	return true;
+}
+
+
+/*
+ * Called once a job's command has finished or been killed; logs its
+ * output, and either schedules a retry or releases the job.
+ */
+static void
+_end_event_notification_job(t_event_notification_job *job, const struct timespec *now)
+{
+	bool		success = job->command.completed == true && job->command.exit_status == 0;
+
+	/* the output would otherwise be lost, as the command's stdout is a pipe */
+	if (job->command.output.data[0] != '\0')
+	{
+		log_info(_("output from event notification command:\n%s"), job->command.output.data);
+	}
+
+	termPQExpBuffer(&job->command.output);
+
+	if (success == true)
+	{
+		job->in_use = false;
+		return;
+	}
+
+	log_warning(_("event notification command failed (attempt %i of %i)"),
+				job->attempt + 1, job->message.retries + 1);
+	log_detail(_("event notification command was:\n  %s"), job->message.command);
+
+	if (job->attempt >= job->message.retries)
+	{
+		job->in_use = false;
+		return;
+	}
+
+	/* back off before retrying, but not indefinitely */
+	job->retry_at = *now;
+	job->retry_at.tv_sec += job->attempt < 5 ? 1 << job->attempt : 30;
+	job->attempt++;
+}
+
+
+static int
+_timespec_diff_ms(const struct timespec *a, const struct timespec *b)
+{
+	return (int) ((a->tv_sec - b->tv_sec) * 1000 + (a->tv_nsec - b->tv_nsec) / 1000000);
+}
+
+
+static void
+_event_notification_worker(int sock)
+{
+	t_event_notification_job jobs[EVENT_NOTIFICATION_PARALLELISM];
+	struct pollfd poll_fds[EVENT_NOTIFICATION_PARALLELISM + 1];
+	int			poll_index[EVENT_NOTIFICATION_PARALLELISM + 1];
+	bool		sock_open = true;
+	int			i;
+
+	/* repmgrd's handlers must not be executed here */
+	pqsignal(SIGHUP, SIG_IGN);
+	pqsignal(SIGINT, SIG_DFL);
+	pqsignal(SIGTERM, SIG_DFL);
+
+	memset(jobs, 0, sizeof(jobs));
+
+	for (;;)
+	{
+		struct timespec now;
+		int			nfds = 0;
+		int			wait_ms = -1;
+		int			active = 0;
+		bool		slot_free = false;
+		int			ret;
+
+		clock_gettime(CLOCK_MONOTONIC, &now);
+
+		/*
+		 * Start any retries which are due, kill any commands which have
+		 * timed out, and determine how long to wait for.
+		 */
+		for (i = 0; i < EVENT_NOTIFICATION_PARALLELISM; i++)
+		{
+			t_event_notification_job *job = &jobs[i];
+			int			remaining_ms;
+
+			if (job->in_use == false)
+			{
+				slot_free = true;
+				continue;
+			}
+
+			if (job->command.fd < 0)
+			{
+				/* awaiting retry */
+				remaining_ms = _timespec_diff_ms(&job->retry_at, &now);
+
+				if (remaining_ms > 0)
+				{
+					if (wait_ms < 0 || remaining_ms < wait_ms)
+						wait_ms = remaining_ms;
+					active++;
+					continue;
+				}
+
+				if (_start_event_notification_job(job) == false)
+				{
+					job->command.completed = false;
+					_end_event_notification_job(job, &now);
+					continue;
+				}
+			}
+
+			remaining_ms = job->message.timeout * 1000 - _timespec_diff_ms(&now, &job->command.start_time);
+
+			if (job->message.timeout > 0 && remaining_ms <= 0)
+			{
+				log_warning(_("event notification command did not complete within %i seconds"),
+							job->message.timeout);
+
+				kill(-job->command.pid, SIGKILL);
+				_finish_command(&job->command, false);
+				_end_event_notification_job(job, &now);
+
+				if (job->in_use == false)
+					slot_free = true;
+				else
+					active++;
+				continue;
+			}
+
+			if (job->message.timeout > 0 && (wait_ms < 0 || remaining_ms < wait_ms))
+				wait_ms = remaining_ms;
+
+			poll_fds[nfds].fd = job->command.fd;
+			poll_fds[nfds].events = POLLIN;
+			poll_fds[nfds].revents = 0;
+			poll_index[nfds] = i;
+			nfds++;
+			active++;
+		}
+
+		/* repmgrd has closed its end of the socket, and everything queued is done */
+		if (sock_open == false && active == 0)
+			break;
+
+		/* further commands are only accepted while a job slot is free */
+		if (sock_open == true && slot_free == true)
+		{
+			poll_fds[nfds].fd = sock;
+			poll_fds[nfds].events = POLLIN;
+			poll_fds[nfds].revents = 0;
+			poll_index[nfds] = -1;
+			nfds++;
+		}
+
+		ret = poll(poll_fds, nfds, wait_ms);
+
+		if (ret < 0)
+		{
+			if (errno == EINTR)
+				continue;
+
+			log_warning(_("_event_notification_worker(): poll() returned with error"));
+			log_detail("%s", strerror(errno));
+			break;
+		}
+
+		clock_gettime(CLOCK_MONOTONIC, &now);
+
+		for (i = 0; i < nfds; i++)
+		{
+			t_event_notification_job *job = NULL;
+			char		buf[MAXLEN];
+			ssize_t		len;
+
+			if (poll_fds[i].revents == 0)
+				continue;
+
+			if (poll_index[i] == -1)
+			{
+				int			j;
+
+				for (j = 0; j < EVENT_NOTIFICATION_PARALLELISM; j++)
+				{
+					if (jobs[j].in_use == false)
+					{
+						job = &jobs[j];
+						break;
+					}
+				}
+
+				len = recv(sock, &job->message, sizeof(job->message) - 1, 0);
+
+				if (len < 0 && errno == EINTR)
+					continue;
+
+				/* repmgrd has closed its end of the socket */
+				if (len <= 0)
+				{
+					sock_open = false;
+					continue;
+				}
+
+				if (len <= (ssize_t) offsetof(t_event_notification_message, command))
+					continue;
+
+				((char *) &job->message)[len] = '\0';
+
+				job->in_use = true;
+				job->attempt = 0;
+
+				if (_start_event_notification_job(job) == false)
+				{
+					job->command.completed = false;
+					_end_event_notification_job(job, &now);
+				}
+				continue;
+			}
+
+			job = &jobs[poll_index[i]];
+
+			len = read(job->command.fd, buf, sizeof(buf));
+
+			if (len < 0 && (errno == EAGAIN || errno == EINTR))
+				continue;
+
+			if (len > 0)
+			{
+				appendBinaryPQExpBuffer(&job->command.output, buf, len);
+				continue;
+			}
+
+			/* end of output */
+			_finish_command(&job->command, true);
+			_end_event_notification_job(job, &now);
+		}
+	}
+
+	/* only reached with commands still running if poll() failed */
+	for (i = 0; i < EVENT_NOTIFICATION_PARALLELISM; i++)
+	{
+		if (jobs[i].in_use == false || jobs[i].command.fd < 0)
+			continue;
+
+		kill(-jobs[i].command.pid, SIGKILL);
+		_finish_command(&jobs[i].command, false);
+	}
+
+	close(sock);
+
+	/* the inherited database connections belong to repmgrd */
+	_exit(SUCCESS);
+}
+
 pid_t
 disable_wal_receiver(PGconn *conn)
 {
@@ -23,7 +23,37 @@ extern bool local_command(const char *command, PQExpBufferData *outputbuf);
 extern bool local_command_return_value(const char *command, PQExpBufferData *outputbuf, int *return_value);
 extern bool local_command_simple(const char *command, PQExpBufferData *outputbuf);
 
+/* maximum number of commands executed at once by remote_commands_parallel() */
+#define REMOTE_COMMAND_PARALLELISM 32
+
+typedef struct t_remote_command
+{
+	/* set by caller */
+	const char *host;			/* NULL to execute locally */
+	const char *command;
+	void	   *arg;
+	void		(*output_callback) (struct t_remote_command *command);	/* optional */
+	/* set by remote_commands_parallel() */
+	PQExpBufferData output;
+	bool		completed;		/* false if timed out or not started */
+	int			exit_status;	/* -1 unless completed and exited normally */
+	/* internal use */
+	pid_t		pid;
+	int			fd;
+	struct timespec start_time;
+} t_remote_command;
+
 extern bool remote_command(const char *host, const char *user, const char *command, const char *ssh_options, PQExpBufferData *outputbuf);
+extern void remote_commands_parallel(t_remote_command *commands, int count, const char *user, const char *ssh_options, int timeout,
+									 void (*completed_callback) (t_remote_command *command));
+extern void remote_commands_parallel_bounded(t_remote_command *commands, int count, int max_active,
+											 const char *user, const char *ssh_options, int timeout,
+											 void (*completed_callback) (t_remote_command *command));
+
+extern bool event_notification_dispatcher_start(void);
+extern void event_notification_dispatcher_stop(void);
+extern void event_notification_dispatcher_reap(void);
+extern bool event_notification_dispatch(const char *command, int timeout, int retries);
 
 extern pid_t disable_wal_receiver(PGconn *conn);
 extern pid_t enable_wal_receiver(PGconn *conn, bool wait_startup);